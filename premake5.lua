@@ -8,12 +8,34 @@ project "bcalc"
     targetdir "bin/%{cfg.buildcfg}"
 
     files {
+		"src/Batch.cpp",
+		"src/Bytecode.cpp",
+		"src/Cancellation.cpp",
+		"src/DependencyGraph.cpp",
+		"src/Differentiate.cpp",
+		"src/FastMath.cpp",
+		"src/History.cpp",
+		"src/Interpreter.cpp",
 		"src/Lexer.cpp",
+		"src/Linear.cpp",
+		"src/LinearEvaluate.cpp",
         "src/main.cpp",
+		"src/Multiprecision.cpp",
+		"src/MultiprecisionMath.cpp",
+		"src/Parallel.cpp",
 		"src/Parser.cpp",
+		"src/Preview.cpp",
 		"src/Program.cpp",
+		"src/Quadrature.cpp",
+		"src/Random.cpp",
+		"src/ResultCache.cpp",
+		"src/Solve.cpp",
+		"src/Statistics.cpp",
+		"src/Summation.cpp",
+		"src/Table.cpp",
 		"src/Token.cpp",
 		"src/TokenNode.cpp",
+		"src/Workspace.cpp",
     }
 
     includedirs "src"
@@ -27,3 +49,78 @@ project "bcalc"
 
     filter "configurations:Release"
         optimize "On"
+
+-- Checks src/Static.h against the runtime evaluator, build and run bin/<config>/static_test
+project "static_test"
+    kind "ConsoleApp"
+    language "C++"
+	cppdialect "C++20"
+    targetdir "bin/%{cfg.buildcfg}"
+
+    files {
+		"src/*.cpp",
+		"tests/Static.cpp",
+    }
+    removefiles "src/main.cpp"
+
+    includedirs "src"
+
+	links {
+		"ncurses"
+	}
+
+    filter "configurations:Debug"  
+        symbols "On"
+
+    filter "configurations:Release"
+        optimize "On"
+
+-- Regression checks of Program::Process, build and run bin/<config>/program_test
+project "program_test"
+    kind "ConsoleApp"
+    language "C++"
+	cppdialect "C++20"
+    targetdir "bin/%{cfg.buildcfg}"
+
+    files {
+		"src/*.cpp",
+		"tests/Program.cpp",
+    }
+    removefiles "src/main.cpp"
+
+    includedirs "src"
+
+	links {
+		"ncurses"
+	}
+
+    filter "configurations:Debug"  
+        symbols "On"
+
+    filter "configurations:Release"
+        optimize "On"
+
+-- Checks the error bounds of src/FastMath.h, build and run bin/<config>/fastmath_test
+project "fastmath_test"
+    kind "ConsoleApp"
+    language "C++"
+	cppdialect "C++20"
+    targetdir "bin/%{cfg.buildcfg}"
+
+    files {
+		"src/*.cpp",
+		"tests/FastMath.cpp",
+    }
+    removefiles "src/main.cpp"
+
+    includedirs "src"
+
+	links {
+		"ncurses"
+	}
+
+    filter "configurations:Debug"  
+        symbols "On"
+
+    filter "configurations:Release"
+        optimize "On"
@@ -0,0 +1,423 @@
+// Vectorizes the register loops below, see Vectorize.h
+#include "Vectorize.h"
+
+#include "Batch.h"
+
+#include "FastMath.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace bcalc
+{
+
+	using Op = Batch::Op;
+
+	// Argument sets evaluated together, registers of this many doubles stay in cache for typical functions
+	static constexpr std::size_t s_lanes = 256;
+
+	// Deeper calls are treated as recursion, larger functions are left to the interpreter
+	static constexpr std::size_t s_max_inline_depth = 16;
+	static constexpr std::size_t s_max_instructions = 1 << 12;
+
+	// Integer powers up to this are multiplied out
+	static constexpr double s_max_multiplied_power = 64;
+
+	class BatchCompiler
+	{
+	public:
+		BatchCompiler(Batch& batch, const VariableList& variables, const FunctionList& functions)
+			: m_batch(batch)
+			, m_variables(variables)
+			, m_functions(functions)
+		{}
+
+		// 'scope' maps parameter names of the function being compiled to their registers
+		bool CompileNode(const TokenNode* node, const std::unordered_map<std::string, uint32_t>& scope, std::size_t depth, uint32_t& out)
+		{
+			const Token& token = node->GetToken();
+			const auto& nodes = node->GetNodes();
+
+			switch (token.Type())
+			{
+				case TokenType::Value:
+					if (token.GetValue().imag() != 0)
+						return false;
+					return LoadConstant(static_cast<double>(token.GetValue().real()), out);
+
+				case TokenType::Constant:
+				{
+					auto value = EvaluateConstant(token.GetConstant());
+					if (value.imag() != 0)
+						return false;
+					return LoadConstant(static_cast<double>(value.real()), out);
+				}
+
+				case TokenType::String:
+				{
+					const std::string& name = token.GetString();
+
+					if (nodes.empty())
+					{
+						if (auto it = scope.find(name); it != scope.end())
+						{
+							out = it->second;
+							return true;
+						}
+						if (auto it = m_variables.find(name); it != m_variables.end())
+						{
+							if (it->second.imag() != 0)
+								return false;
+							return LoadConstant(static_cast<double>(it->second.real()), out);
+						}
+					}
+
+					// Calls see only their own parameters, as in the interpreter
+					const UserFunction* function = FindFunction(m_functions, name, nodes.size());
+					if (!function || depth >= s_max_inline_depth)
+						return false;
+
+					std::unordered_map<std::string, uint32_t> parameters;
+					for (std::size_t i = 0; i < nodes.size(); i++)
+						if (!CompileNode(nodes[i], scope, depth, parameters[function->parameters[i]]))
+							return false;
+					return CompileNode(function->expression, parameters, depth + 1, out);
+				}
+
+				case TokenType::BuiltinFunction:
+				{
+					FunctionType function = token.GetBuiltinFunction();
+
+					std::vector<uint32_t> inputs(nodes.size());
+					for (std::size_t i = 0; i < nodes.size(); i++)
+						if (!CompileNode(nodes[i], scope, depth, inputs[i]))
+							return false;
+
+					// Both branches are evaluated, neither can fail or recurse
+					if (function == FunctionType::If)
+						return inputs.size() == 3 && Emit(Op::Select, inputs[1], inputs[2], inputs[0], out);
+
+					if (inputs.size() != 1)
+						return false;
+
+					switch (function)
+					{
+						case FunctionType::Round:	return Emit(Op::Round, inputs[0], 0, 0, out);
+						case FunctionType::Floor:	return Emit(Op::Floor, inputs[0], 0, 0, out);
+						case FunctionType::Ceil:	return Emit(Op::Ceil, inputs[0], 0, 0, out);
+						default:
+							break;
+					}
+
+					if (!FastMath::HasKernel(function))
+						return false;
+					return Emit(Op::Kernel, inputs[0], 0, 0, out, function);
+				}
+
+				default:
+					break;
+			}
+
+			if (nodes.size() != 2)
+				return false;
+
+			uint32_t lhs, rhs;
+			if (!CompileNode(nodes[0], scope, depth, lhs) || !CompileNode(nodes[1], scope, depth, rhs))
+				return false;
+
+			switch (token.Type())
+			{
+				case TokenType::Add:			return Emit(Op::Add, lhs, rhs, 0, out);
+				case TokenType::Sub:			return Emit(Op::Sub, lhs, rhs, 0, out);
+				case TokenType::Mult:			return Emit(Op::Mul, lhs, rhs, 0, out);
+				case TokenType::Div:			return Emit(Op::Div, lhs, rhs, 0, out);
+				case TokenType::Power:			return Power(lhs, rhs, out);
+				case TokenType::Less:			return Emit(Op::Less, lhs, rhs, 0, out);
+				case TokenType::LessEqual:		return Emit(Op::LessEqual, lhs, rhs, 0, out);
+				case TokenType::Greater:		return Emit(Op::Greater, lhs, rhs, 0, out);
+				case TokenType::GreaterEqual:	return Emit(Op::GreaterEqual, lhs, rhs, 0, out);
+				case TokenType::Equal:			return Emit(Op::Equal, lhs, rhs, 0, out);
+				case TokenType::NotEqual:		return Emit(Op::NotEqual, lhs, rhs, 0, out);
+				default:
+					return false;
+			}
+		}
+
+		// Computes sin and cos of an argument with one 'SinCos' when both are used
+		void FuseSinCos()
+		{
+			std::map<uint32_t, std::size_t> sines, cosines;
+			for (std::size_t i = 0; i < m_batch.m_code.size(); i++)
+			{
+				const Batch::Instruction& instruction = m_batch.m_code[i];
+				if (instruction.op != Op::Kernel)
+					continue;
+				if (instruction.function == FunctionType::Sin)
+					sines[instruction.a] = i;
+				else if (instruction.function == FunctionType::Cos)
+					cosines[instruction.a] = i;
+			}
+
+			std::vector<bool> removed(m_batch.m_code.size(), false);
+			for (const auto& [argument, sine] : sines)
+			{
+				auto it = cosines.find(argument);
+				if (it == cosines.end())
+					continue;
+
+				// The earlier one computes both, its argument is ready by then
+				const std::size_t first = std::min(sine, it->second);
+				const std::size_t second = std::max(sine, it->second);
+				m_batch.m_code[first] = {
+					.op = Op::SinCos,
+					.out = m_batch.m_code[sine].out,
+					.a = argument,
+					.b = m_batch.m_code[it->second].out,
+				};
+				removed[second] = true;
+			}
+
+			std::size_t count = 0;
+			for (std::size_t i = 0; i < m_batch.m_code.size(); i++)
+				if (!removed[i])
+					m_batch.m_code[count++] = m_batch.m_code[i];
+			m_batch.m_code.resize(count);
+		}
+
+	private:
+		bool LoadConstant(double value, uint32_t& out)
+		{
+			if (!std::isfinite(value))
+				return false;
+
+			// Keyed by bits so 0 and -0 stay apart
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+
+			auto [it, inserted] = m_constants.try_emplace(bits, m_batch.m_registers);
+			if (inserted)
+				m_batch.m_constants.push_back({ static_cast<uint32_t>(m_batch.m_registers++), value });
+			out = it->second;
+			return true;
+		}
+
+		bool Emit(Op op, uint32_t a, uint32_t b, uint32_t c, uint32_t& out, FunctionType function = FunctionType::Count)
+		{
+			// Operands of commutative operations are ordered so 'x + y' and 'y + x' share a register
+			if ((op == Op::Add || op == Op::Mul || op == Op::Equal || op == Op::NotEqual) && a > b)
+				std::swap(a, b);
+
+			auto key = std::make_tuple(op, function, a, b, c);
+			if (auto it = m_numbering.find(key); it != m_numbering.end())
+			{
+				out = it->second;
+				return true;
+			}
+
+			if (m_batch.m_code.size() >= s_max_instructions)
+				return false;
+
+			out = m_batch.m_registers++;
+			m_batch.m_code.push_back({ .op = op, .function = function, .out = out, .a = a, .b = b, .c = c });
+			m_numbering[key] = out;
+			return true;
+		}
+
+		// Constant integer exponents are multiplied out, complex results of others come out as NaN
+		bool Power(uint32_t base, uint32_t exponent, uint32_t& out)
+		{
+			const double* constant = ConstantValue(exponent);
+			if (!constant || *constant != std::round(*constant) || *constant == 0 || std::abs(*constant) > s_max_multiplied_power)
+				return Emit(Op::Pow, base, exponent, 0, out);
+
+			uint64_t n = static_cast<uint64_t>(std::abs(*constant));
+
+			uint32_t result = 0;
+			bool has_result = false;
+			for (uint32_t square = base; n > 0; n >>= 1)
+			{
+				if (n & 1)
+				{
+					if (has_result && !Emit(Op::Mul, result, square, 0, result))
+						return false;
+					if (!has_result)
+						result = square;
+					has_result = true;
+				}
+				if (n > 1 && !Emit(Op::Mul, square, square, 0, square))
+					return false;
+			}
+
+			if (*constant > 0)
+			{
+				out = result;
+				return true;
+			}
+
+			uint32_t one;
+			return LoadConstant(1.0, one) && Emit(Op::Div, one, result, 0, out);
+		}
+
+		const double* ConstantValue(uint32_t reg) const
+		{
+			for (const auto& [constant_reg, value] : m_batch.m_constants)
+				if (constant_reg == reg)
+					return &value;
+			return nullptr;
+		}
+
+	private:
+		Batch& m_batch;
+		const VariableList& m_variables;
+		const FunctionList& m_functions;
+
+		std::map<std::tuple<Op, FunctionType, uint32_t, uint32_t, uint32_t>, uint32_t> m_numbering;
+		std::unordered_map<uint64_t, uint32_t> m_constants;
+	};
+
+	Batch* Batch::Compile(const UserFunction& function, const VariableList& variables, const FunctionList& functions)
+	{
+		Batch* batch = new Batch;
+		batch->m_arity = function.parameters.size();
+		batch->m_registers = batch->m_arity;
+
+		std::unordered_map<std::string, uint32_t> scope;
+		for (std::size_t i = 0; i < function.parameters.size(); i++)
+			scope[function.parameters[i]] = i;
+
+		BatchCompiler compiler(*batch, variables, functions);
+		if (!compiler.CompileNode(function.expression, scope, 0, batch->m_result))
+		{
+			delete batch;
+			return nullptr;
+		}
+		compiler.FuseSinCos();
+
+		return batch;
+	}
+
+	// NaN for overflowed values, a later operation could otherwise turn them into wrong finite results
+	[[gnu::always_inline]] static inline double Finite(double value)
+	{
+		return value - value == 0 ? value : std::numeric_limits<double>::quiet_NaN();
+	}
+
+	[[gnu::always_inline]] static inline double Truth(bool value, double lhs, double rhs)
+	{
+		return lhs == lhs && rhs == rhs ? static_cast<double>(value) : std::numeric_limits<double>::quiet_NaN();
+	}
+
+	// Runs 'code' over 'lanes' lanes of every register
+	BCALC_VECTOR_TARGETS
+	static void Run(const std::vector<Batch::Instruction>& code, double* registers, std::size_t lanes)
+	{
+		for (const Batch::Instruction& instruction : code)
+		{
+			double* __restrict out = registers + instruction.out * s_lanes;
+			const double* a = registers + instruction.a * s_lanes;
+			const double* b = registers + instruction.b * s_lanes;
+			const double* c = registers + instruction.c * s_lanes;
+
+			switch (instruction.op)
+			{
+				case Op::Kernel:
+					FastMath::Apply(instruction.function, a, out, lanes);
+					break;
+				case Op::SinCos:
+					FastMath::SinCos(a, out, registers + instruction.b * s_lanes, lanes);
+					break;
+				case Op::Round:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = std::round(a[i]);
+					break;
+				case Op::Floor:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = std::floor(a[i]);
+					break;
+				case Op::Ceil:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = std::ceil(a[i]);
+					break;
+				case Op::Add:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Finite(a[i] + b[i]);
+					break;
+				case Op::Sub:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Finite(a[i] - b[i]);
+					break;
+				case Op::Mul:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Finite(a[i] * b[i]);
+					break;
+				case Op::Div:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Finite(a[i] / b[i]);
+					break;
+				case Op::Pow:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Finite(std::pow(a[i], b[i]));
+					break;
+				case Op::Less:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] < b[i], a[i], b[i]);
+					break;
+				case Op::LessEqual:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] <= b[i], a[i], b[i]);
+					break;
+				case Op::Greater:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] > b[i], a[i], b[i]);
+					break;
+				case Op::GreaterEqual:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] >= b[i], a[i], b[i]);
+					break;
+				case Op::Equal:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] == b[i], a[i], b[i]);
+					break;
+				case Op::NotEqual:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = Truth(a[i] != b[i], a[i], b[i]);
+					break;
+				case Op::Select:
+					for (std::size_t i = 0; i < lanes; i++)
+						out[i] = c[i] == 0 ? b[i] : (c[i] == c[i] ? a[i] : std::numeric_limits<double>::quiet_NaN());
+					break;
+			}
+		}
+	}
+
+	bool Batch::Evaluate(const double* const* arguments, double* out, std::size_t count) const
+	{
+		std::vector<double> registers(m_registers * s_lanes);
+		for (const auto& [reg, value] : m_constants)
+			std::fill_n(registers.data() + reg * s_lanes, s_lanes, value);
+
+		for (std::size_t first = 0; first < count; first += s_lanes)
+		{
+			const std::size_t lanes = std::min(s_lanes, count - first);
+
+			if (!Cancellation::Checkpoint(lanes * (m_code.size() + 1)))
+				return false;
+
+			for (std::size_t j = 0; j < m_arity; j++)
+				memcpy(registers.data() + j * s_lanes, arguments[j] + first, lanes * sizeof(double));
+
+			Run(m_code, registers.data(), lanes);
+
+			// Anything non-finite is left to the exact path
+			const double* result = registers.data() + m_result * s_lanes;
+			for (std::size_t i = 0; i < lanes; i++)
+				out[first + i] = Finite(result[i]);
+		}
+
+		return true;
+	}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "TokenNode.h"
+
+#include <cstddef>
+
+namespace bcalc
+{
+
+	// A user function compiled for fast math mode into straight-line code over double registers, each holding
+	// the value of one subexpression for many argument sets at once. Equal subexpressions share a register,
+	// calls of other functions are inlined, 'if' selects between both branches and sin and cos of the same
+	// argument are computed together. Builtins use the vectorized kernels of FastMath.h.
+	class Batch
+	{
+	public:
+		// Returns nullptr if 'function' uses anything besides real constants and variables, its parameters,
+		// arithmetic, comparisons, 'if', rounding, builtins with kernels and calls of such functions.
+		// Variables are read now, the result must not be used after they change.
+		static Batch* Compile(const UserFunction& function, const VariableList& variables, const FunctionList& functions);
+
+		std::size_t Arity() const { return m_arity; }
+
+		// Evaluates 'count' argument sets, 'arguments[j][i]' being parameter j of set i. Sets whose result
+		// isn't a finite real number in double (complex, overflowing or outside of a kernel's range) get NaN,
+		// they have to be evaluated exactly. Returns false if the current evaluation was stopped.
+		bool Evaluate(const double* const* arguments, double* out, std::size_t count) const;
+
+	public:
+		enum class Op : uint8_t
+		{
+			Kernel,		// out = kernel 'function' of a
+			SinCos,		// out = sin a, b = cos a
+			Round,
+			Floor,
+			Ceil,
+			Add,		// out = a + b
+			Sub,
+			Mul,
+			Div,
+			Pow,
+			Less,		// out = a < b, NaN if either is NaN
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			Equal,
+			NotEqual,
+			Select,		// out = c != 0 ? a : b, NaN if c is NaN
+		};
+
+		struct Instruction
+		{
+			Op				op;
+			FunctionType	function = FunctionType::Count;
+			uint32_t		out = 0;
+			uint32_t		a = 0;
+			uint32_t		b = 0;
+			uint32_t		c = 0;
+		};
+
+	private:
+		friend class BatchCompiler;
+
+		// Registers [0, arity) hold the parameters, constants are loaded into theirs before running 'm_code'
+		std::size_t									m_arity			= 0;
+		std::size_t									m_registers		= 0;
+		std::vector<std::pair<uint32_t, double>>	m_constants;
+		std::vector<Instruction>					m_code;
+		uint32_t									m_result		= 0;
+	};
+
+}
@@ -0,0 +1,153 @@
+#include "Bytecode.h"
+
+#include <algorithm>
+
+namespace bcalc
+{
+
+	using Op = Bytecode::Op;
+
+	static uint32_t AddName(Bytecode& bytecode, const std::string& name)
+	{
+		auto it = std::find(bytecode.names.begin(), bytecode.names.end(), name);
+		if (it != bytecode.names.end())
+			return it - bytecode.names.begin();
+		bytecode.names.push_back(name);
+		return bytecode.names.size() - 1;
+	}
+
+	static void Emit(Bytecode& bytecode, Op op, uint32_t a = 0, uint32_t b = 0)
+	{
+		bytecode.code.push_back({ .op = op, .a = a, .b = b });
+	}
+
+	static void EmitConstant(Bytecode& bytecode, std::complex<value_type> value)
+	{
+		bytecode.constants.push_back(value);
+		Emit(bytecode, Op::Constant, bytecode.constants.size() - 1);
+	}
+
+	// 'tail' is true when the value of 'node' is returned directly from the function
+	static bool CompileNode(const TokenNode* node, bool tail, Bytecode& bytecode)
+	{
+		const Token& token = node->GetToken();
+		const auto& nodes = node->GetNodes();
+
+		switch (token.Type())
+		{
+			case TokenType::Value:
+				EmitConstant(bytecode, token.GetValue());
+				return true;
+
+			case TokenType::Constant:
+				EmitConstant(bytecode, EvaluateConstant(token.GetConstant()));
+				return true;
+
+			case TokenType::String:
+			{
+				const std::string name = token.GetString();
+
+				if (auto it = std::find(bytecode.parameters.begin(), bytecode.parameters.end(), name); it != bytecode.parameters.end())
+				{
+					Emit(bytecode, Op::LoadLocal, it - bytecode.parameters.begin());
+					return true;
+				}
+
+				if (nodes.empty())
+				{
+					Emit(bytecode, Op::LoadGlobal, AddName(bytecode, name));
+					return true;
+				}
+
+				for (const TokenNode* input : nodes)
+					if (!CompileNode(input, false, bytecode))
+						return false;
+				Emit(bytecode, tail ? Op::TailCall : Op::Call, AddName(bytecode, name), nodes.size());
+				return true;
+			}
+
+			case TokenType::BuiltinFunction:
+			{
+				FunctionType function = token.GetBuiltinFunction();
+
+				// Arguments besides the function name are values of the current call
+				if (IsHigherOrder(function))
+				{
+					if (nodes.empty() || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+						return false;
+
+					for (std::size_t i = 1; i < nodes.size(); i++)
+						if (!CompileNode(nodes[i], false, bytecode))
+							return false;
+
+					bytecode.higher_order.emplace_back(function, nodes[0]->GetToken().GetString());
+					Emit(bytecode, Op::HigherOrder, bytecode.higher_order.size() - 1, nodes.size() - 1);
+					return true;
+				}
+
+				if (function == FunctionType::If)
+				{
+					if (nodes.size() != 3 || !CompileNode(nodes[0], false, bytecode))
+						return false;
+
+					std::size_t jump_to_else = bytecode.code.size();
+					Emit(bytecode, Op::JumpIfFalse);
+
+					if (!CompileNode(nodes[1], tail, bytecode))
+						return false;
+
+					// In tail position both branches return on their own
+					std::size_t jump_to_end = bytecode.code.size();
+					Emit(bytecode, tail ? Op::Return : Op::Jump);
+
+					bytecode.code[jump_to_else].a = bytecode.code.size();
+					if (!CompileNode(nodes[2], tail, bytecode))
+						return false;
+
+					if (!tail)
+						bytecode.code[jump_to_end].a = bytecode.code.size();
+					return true;
+				}
+
+				for (const TokenNode* input : nodes)
+					if (!CompileNode(input, false, bytecode))
+						return false;
+				Emit(bytecode, Op::Builtin, static_cast<uint32_t>(function), nodes.size());
+				return true;
+			}
+
+			// Vectors and matrices are evaluated by Linear.h, the tree evaluator rejects them
+			case TokenType::LBracket:
+				bytecode.fallbacks.push_back(node);
+				Emit(bytecode, Op::Fallback, bytecode.fallbacks.size() - 1);
+				return true;
+
+			default:
+				break;
+		}
+
+		if (nodes.size() != 2)
+			return false;
+
+		if (!CompileNode(nodes[0], false, bytecode) || !CompileNode(nodes[1], false, bytecode))
+			return false;
+		Emit(bytecode, Op::Binary, static_cast<uint32_t>(token.Type()));
+		return true;
+	}
+
+	Bytecode* Compile(const TokenNode* root, const std::vector<std::string>& parameters)
+	{
+		Bytecode* bytecode = new Bytecode;
+		bytecode->parameters = parameters;
+
+		if (!CompileNode(root, true, *bytecode))
+		{
+			delete bytecode;
+			return nullptr;
+		}
+
+		Emit(*bytecode, Op::Return);
+		return bytecode;
+	}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "TokenNode.h"
+
+namespace bcalc
+{
+
+	// Flat stack machine code for one expression or user function body.
+	struct Bytecode
+	{
+		enum class Op : uint8_t
+		{
+			Constant,		// push constants[a]
+			LoadLocal,		// push parameter a of the current call
+			LoadGlobal,		// push variable names[a], or call its zero parameter overload
+			Binary,			// pop rhs and lhs, push 'lhs (TokenType)a rhs'
+			Builtin,		// pop b inputs, push builtin (FunctionType)a
+			JumpIfFalse,	// pop condition, jump to a if it is zero
+			Jump,			// jump to a
+			Call,			// pop b arguments, push result of user function names[a]
+			TailCall,		// like Call, but reuses the current frame
+			HigherOrder,	// pop b inputs, push builtin higher_order[a] applied to the user function it names
+			Fallback,		// push tree evaluation of fallbacks[a] (vector literals, which it rejects)
+			Return,			// return top of the stack to the caller
+		};
+
+		struct Instruction
+		{
+			Op			op;
+			uint32_t	a = 0;
+			uint32_t	b = 0;
+		};
+
+		std::vector<Instruction>				code;
+		std::vector<std::complex<value_type>>	constants;
+		std::vector<std::string>				names;
+		std::vector<std::pair<FunctionType, std::string>>	higher_order;
+		std::vector<const TokenNode*>			fallbacks;
+		std::vector<std::string>				parameters;
+	};
+
+	// Compiles 'root' with 'parameters' bound to local slots. Identifiers that are not parameters are looked up
+	// from global variables and functions when executed. Returns nullptr if the tree can't be compiled.
+	// The result references 'root', so it must not outlive it.
+	Bytecode* Compile(const TokenNode* root, const std::vector<std::string>& parameters = {});
+
+}
@@ -0,0 +1,70 @@
+#include "Cancellation.h"
+
+namespace bcalc
+{
+
+	Cancellation::Cancellation(const Budget& budget, const std::atomic<bool>* cancel)
+		: m_cancel(cancel)
+		, m_deadline(std::chrono::steady_clock::now() + budget.timeout)
+		, m_has_deadline(budget.timeout.count() > 0)
+		, m_max_nodes(budget.max_nodes)
+		, m_previous(s_current)
+	{
+		if (m_previous)
+			m_previous->Flush();
+		s_current = this;
+	}
+
+	Cancellation::~Cancellation()
+	{
+		Flush();
+		s_current = m_previous;
+	}
+
+	Cancellation::Join::Join(Cancellation* cancellation)
+		: m_previous(s_current)
+	{
+		if (m_previous)
+			m_previous->Flush();
+		s_current = cancellation;
+	}
+
+	Cancellation::Join::~Join()
+	{
+		if (s_current)
+			s_current->Flush();
+		s_current = m_previous;
+	}
+
+	void Cancellation::Flush()
+	{
+		m_nodes.fetch_add(s_unchecked, std::memory_order_relaxed);
+		s_unchecked = 0;
+	}
+
+	void Cancellation::Stop(StopReason reason)
+	{
+		// The first reason wins, other threads may hit a limit at the same time
+		StopReason expected = StopReason::None;
+		m_reason.compare_exchange_strong(expected, reason);
+		m_stopped.store(true, std::memory_order_relaxed);
+	}
+
+	bool Cancellation::Check()
+	{
+		Flush();
+
+		if (m_stopped.load(std::memory_order_relaxed))
+			return false;
+
+		if (m_cancel && m_cancel->load(std::memory_order_relaxed))
+			Stop(StopReason::Cancelled);
+		else if (m_max_nodes && m_nodes.load(std::memory_order_relaxed) > m_max_nodes)
+			Stop(StopReason::NodeLimit);
+		else if (m_has_deadline && std::chrono::steady_clock::now() > m_deadline)
+			Stop(StopReason::Timeout);
+
+		return !m_stopped.load(std::memory_order_relaxed);
+	}
+
+}
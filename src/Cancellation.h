@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace bcalc
+{
+
+	// Why an evaluation stopped before finishing
+	enum class StopReason
+	{
+		None,
+		Cancelled,
+		Timeout,
+		NodeLimit,
+	};
+
+	// Limits of a single evaluation, zero means unlimited
+	struct Budget
+	{
+		std::chrono::milliseconds	timeout		{ 0 };
+		uint64_t					max_nodes	= 0;
+	};
+
+	// Cooperative cancellation of the evaluation running on the constructing thread. Evaluators call
+	// Checkpoint() once per node and unwind with an error when it returns false. Threads started by
+	// 'ParallelFor()' and table output join the evaluation of the thread that started them.
+	class Cancellation
+	{
+	public:
+		// 'cancel' may be set from any thread or a signal handler to stop the evaluation
+		Cancellation(const Budget& budget, const std::atomic<bool>* cancel = nullptr);
+		~Cancellation();
+
+		Cancellation(const Cancellation&) = delete;
+		Cancellation& operator=(const Cancellation&) = delete;
+
+		StopReason Reason() const { return m_reason.load(); }
+
+		// Makes 'cancellation' (may be null) current on the calling thread for the lifetime of the object
+		class Join
+		{
+		public:
+			Join(Cancellation* cancellation);
+			~Join();
+
+			Join(const Join&) = delete;
+			Join& operator=(const Join&) = delete;
+
+		private:
+			Cancellation* m_previous;
+		};
+
+		static Cancellation* Current() { return s_current; }
+
+		// Counts 'nodes' evaluated nodes, returns false once the current evaluation has to stop
+		static bool Checkpoint(uint32_t nodes = 1)
+		{
+			Cancellation* current = s_current;
+			if (!current)
+				return true;
+			if ((s_unchecked += nodes) >= s_check_interval)
+				return current->Check();
+			return !current->m_stopped.load(std::memory_order_relaxed);
+		}
+
+		// Returns true if the current evaluation has stopped, without counting a node
+		static bool Stopped()
+		{
+			Cancellation* current = s_current;
+			return current && !current->Check();
+		}
+
+	private:
+		bool Check();
+		void Stop(StopReason reason);
+		void Flush();
+
+	private:
+		// Limits and the cancel flag are only looked at every this many nodes
+		static constexpr uint32_t s_check_interval = 1024;
+
+		static inline thread_local Cancellation*	s_current	= nullptr;
+		static inline thread_local uint32_t			s_unchecked	= 0; // nodes not yet added to 'm_nodes'
+
+		const std::atomic<bool>*				m_cancel;
+		std::chrono::steady_clock::time_point	m_deadline;
+		bool									m_has_deadline;
+		uint64_t								m_max_nodes;
+
+		std::atomic<uint64_t>	m_nodes		= 0;
+		std::atomic<bool>		m_stopped	= false;
+		std::atomic<StopReason>	m_reason	= StopReason::None;
+
+		Cancellation* m_previous;
+	};
+
+}
@@ -0,0 +1,107 @@
+#include "DependencyGraph.h"
+
+namespace bcalc
+{
+
+	void DependencyGraph::SetDependencies(const std::string& name, std::unordered_set<std::string> dependencies)
+	{
+		Remove(name);
+
+		for (const auto& dependency : dependencies)
+			m_dependents[dependency].insert(name);
+
+		if (!dependencies.empty())
+			m_dependencies[name] = std::move(dependencies);
+	}
+
+	void DependencyGraph::Remove(const std::string& name)
+	{
+		auto it = m_dependencies.find(name);
+		if (it == m_dependencies.end())
+			return;
+
+		for (const auto& dependency : it->second)
+		{
+			auto dependents_it = m_dependents.find(dependency);
+			dependents_it->second.erase(name);
+			if (dependents_it->second.empty())
+				m_dependents.erase(dependents_it);
+		}
+
+		m_dependencies.erase(it);
+	}
+
+	bool DependencyGraph::WouldCycle(const std::string& name, const std::unordered_set<std::string>& dependencies) const
+	{
+		if (dependencies.contains(name))
+			return true;
+
+		for (const auto& level : Dependents(name))
+			for (const auto& dependent : level)
+				if (dependencies.contains(dependent))
+					return true;
+
+		return false;
+	}
+
+	std::vector<std::vector<std::string>> DependencyGraph::Dependents(const std::string& changed) const
+	{
+		// Collect everything reachable from 'changed'
+		std::unordered_map<std::string, std::size_t> indegree;
+		std::vector<std::string> stack { changed };
+		while (!stack.empty())
+		{
+			std::string current = std::move(stack.back());
+			stack.pop_back();
+
+			auto it = m_dependents.find(current);
+			if (it == m_dependents.end())
+				continue;
+
+			for (const auto& dependent : it->second)
+				if (dependent != changed && indegree.emplace(dependent, 0).second)
+					stack.push_back(dependent);
+		}
+
+		if (indegree.empty())
+			return {};
+
+		// Kahn's algorithm restricted to the affected names
+		for (auto& [name, count] : indegree)
+			for (const auto& dependency : m_dependencies.at(name))
+				if (dependency != name && indegree.contains(dependency))
+					count++;
+
+		std::vector<std::vector<std::string>> levels;
+
+		std::vector<std::string> current;
+		for (const auto& [name, count] : indegree)
+			if (count == 0)
+				current.push_back(name);
+
+		while (!current.empty())
+		{
+			std::vector<std::string> next;
+			for (const auto& name : current)
+			{
+				indegree.erase(name);
+
+				auto it = m_dependents.find(name);
+				if (it == m_dependents.end())
+					continue;
+				for (const auto& dependent : it->second)
+					if (auto count_it = indegree.find(dependent); dependent != name && count_it != indegree.end() && --count_it->second == 0)
+						next.push_back(dependent);
+			}
+			levels.push_back(std::move(current));
+			current = std::move(next);
+		}
+
+		// Names left over are part of a cycle (e.g. mutually recursive functions), visit them one at a time
+		for (const auto& [name, _] : indegree)
+			levels.push_back({ name });
+
+		return levels;
+	}
+
+}
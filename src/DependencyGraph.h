@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace bcalc
+{
+
+	// Directed graph between names. An edge 'a -> b' means the definition of 'b' reads 'a'.
+	class DependencyGraph
+	{
+	public:
+		void SetDependencies(const std::string& name, std::unordered_set<std::string> dependencies);
+		void Remove(const std::string& name);
+
+		// Returns true if 'name' depending on 'dependencies' would introduce a cycle.
+		bool WouldCycle(const std::string& name, const std::unordered_set<std::string>& dependencies) const;
+
+		// Returns every name that transitively depends on 'changed', grouped into topological levels.
+		// Names within one level do not depend on each other.
+		std::vector<std::vector<std::string>> Dependents(const std::string& changed) const;
+
+	private:
+		std::unordered_map<std::string, std::unordered_set<std::string>> m_dependencies;
+		std::unordered_map<std::string, std::unordered_set<std::string>> m_dependents;
+	};
+
+}
@@ -0,0 +1,358 @@
+#include "Differentiate.h"
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+
+	// Value and derivative of a single argument builtin at 'x'
+	static bool Primitive(FunctionType function, const complex& x, complex& value, complex& derivative)
+	{
+		static_assert(static_cast<int>(FunctionType::Count) == 38);
+
+		auto result = ApplyFunction(function, { x });
+		if (result.has_error)
+			return false;
+		value = result.value;
+
+		const complex one = 1;
+
+		switch (function)
+		{
+			case FunctionType::Sin:		derivative = std::cos(x);								return true;
+			case FunctionType::ArcSin:	derivative = one / std::sqrt(one - x * x);				return true;
+			case FunctionType::Sinh:	derivative = std::cosh(x);								return true;
+			case FunctionType::ArcSinh:	derivative = one / std::sqrt(x * x + one);				return true;
+			case FunctionType::Cos:		derivative = -std::sin(x);								return true;
+			case FunctionType::ArcCos:	derivative = -one / std::sqrt(one - x * x);				return true;
+			case FunctionType::Cosh:	derivative = std::sinh(x);								return true;
+			case FunctionType::ArcCosh:	derivative = one / (std::sqrt(x - one) * std::sqrt(x + one));	return true;
+			case FunctionType::Tan:		derivative = one / (std::cos(x) * std::cos(x));			return true;
+			case FunctionType::ArcTan:	derivative = one / (one + x * x);						return true;
+			case FunctionType::Tanh:	derivative = one - value * value;						return true;
+			case FunctionType::ArcTanh:	derivative = one / (one - x * x);						return true;
+			case FunctionType::Sqrt:	derivative = one / (value_type(2) * value);				return true;
+			case FunctionType::Log:		derivative = one / x;									return true;
+			case FunctionType::Exp:		derivative = value;										return true;
+			case FunctionType::Round:
+			case FunctionType::Floor:
+			case FunctionType::Ceil:	derivative = 0;											return true;
+			case FunctionType::Transpose:
+			case FunctionType::Det:		derivative = 1;											return true;
+			case FunctionType::Inverse:	derivative = -value * value;							return true;
+			default:
+				break;
+		}
+
+		return false;
+	}
+
+	// Value and partial derivatives of 'a ^ b'
+	static void PowPartials(const complex& a, const complex& b, complex& value, complex& da, complex& db)
+	{
+		value = std::pow(a, b);
+		da = (b == complex(0)) ? complex(0) : b * std::pow(a, b - complex(1));
+		db = (a == complex(0)) ? complex(0) : value * std::log(a);
+	}
+
+	// Forward mode
+
+	struct Dual
+	{
+		Dual() = default;
+		Dual(complex value, complex derivative = 0)
+			: value(value), derivative(derivative)
+		{}
+
+		complex value		= 0;
+		complex derivative	= 0;
+	};
+
+	static Dual operator+(const Dual& a, const Dual& b) { return { a.value + b.value, a.derivative + b.derivative }; }
+	static Dual operator-(const Dual& a, const Dual& b) { return { a.value - b.value, a.derivative - b.derivative }; }
+	static Dual operator*(const Dual& a, const Dual& b) { return { a.value * b.value, a.derivative * b.value + a.value * b.derivative }; }
+	static Dual operator/(const Dual& a, const Dual& b) { return { a.value / b.value, (a.derivative * b.value - a.value * b.derivative) / (b.value * b.value) }; }
+
+	static Dual Pow(const Dual& a, const Dual& b)
+	{
+		complex value, da, db;
+		PowPartials(a.value, b.value, value, da, db);
+
+		// Skip terms with zero tangent so infinite partials of constant subexpressions don't produce NaN
+		complex derivative = 0;
+		if (a.derivative != complex(0))
+			derivative += da * a.derivative;
+		if (b.derivative != complex(0))
+			derivative += db * b.derivative;
+		return { value, derivative };
+	}
+
+	static bool Apply(FunctionType function, const Dual& x, Dual& out)
+	{
+		complex value, derivative;
+		if (!Primitive(function, x.value, value, derivative))
+			return false;
+		out = { value, x.derivative == complex(0) ? complex(0) : derivative * x.derivative };
+		return true;
+	}
+
+	// Reverse mode
+
+	static constexpr std::size_t s_no_entry = static_cast<std::size_t>(-1);
+
+	struct Tape
+	{
+		struct Entry
+		{
+			std::size_t	parents[2];
+			complex		partials[2];
+		};
+		std::vector<Entry> entries;
+	};
+
+	static thread_local Tape* s_tape = nullptr;
+
+	struct Var
+	{
+		Var() = default;
+		Var(complex value)
+			: value(value)
+		{}
+
+		complex		value = 0;
+		std::size_t	index = s_no_entry; // constants are not recorded on the tape
+	};
+
+	static Var Record(const complex& value, const Var& a, const complex& da, const Var& b = Var(), const complex& db = 0)
+	{
+		Var result(value);
+		if (a.index == s_no_entry && b.index == s_no_entry)
+			return result;
+
+		result.index = s_tape->entries.size();
+		s_tape->entries.push_back({ { a.index, b.index }, { da, db } });
+		return result;
+	}
+
+	static Var operator+(const Var& a, const Var& b) { return Record(a.value + b.value, a, 1, b, 1); }
+	static Var operator-(const Var& a, const Var& b) { return Record(a.value - b.value, a, 1, b, -1); }
+	static Var operator*(const Var& a, const Var& b) { return Record(a.value * b.value, a, b.value, b, a.value); }
+	static Var operator/(const Var& a, const Var& b) { return Record(a.value / b.value, a, complex(1) / b.value, b, -a.value / (b.value * b.value)); }
+
+	static Var Pow(const Var& a, const Var& b)
+	{
+		complex value, da, db;
+		PowPartials(a.value, b.value, value, da, db);
+		return Record(value, a, da, b, db);
+	}
+
+	static bool Apply(FunctionType function, const Var& x, Var& out)
+	{
+		complex value, derivative;
+		if (!Primitive(function, x.value, value, derivative))
+			return false;
+		out = Record(value, x, derivative);
+		return true;
+	}
+
+	// Evaluation of a tree over any of the number types above
+
+	template<typename T>
+	using LocalList = std::unordered_map<std::string, T>;
+
+	// Recursion of user functions deeper than this is treated as runaway
+	static constexpr std::size_t s_max_depth = 1 << 12;
+
+	template<typename T>
+	static bool Evaluate(const TokenNode* node, const LocalList<T>& locals, const VariableList& variables, const FunctionList& functions, std::size_t depth, T& out)
+	{
+		if (!Cancellation::Checkpoint())
+			return false;
+
+		const Token& token = node->GetToken();
+		const auto& nodes = node->GetNodes();
+
+		switch (token.Type())
+		{
+			case TokenType::Value:
+				out = T(token.GetValue());
+				return true;
+
+			case TokenType::Constant:
+				out = T(EvaluateConstant(token.GetConstant()));
+				return true;
+
+			case TokenType::String:
+			{
+				const std::string& name = token.GetString();
+
+				if (auto it = locals.find(name); it != locals.end())
+				{
+					out = it->second;
+					return true;
+				}
+
+				if (auto it = variables.find(name); it != variables.end())
+				{
+					out = T(it->second);
+					return true;
+				}
+
+				const UserFunction* function = FindFunction(functions, name, nodes.size());
+				if (!function || depth >= s_max_depth)
+					return false;
+
+				// Callees see their own parameters and globals, not the locals of the caller
+				LocalList<T> parameters;
+				for (std::size_t i = 0; i < nodes.size(); i++)
+				{
+					T input;
+					if (!Evaluate(nodes[i], locals, variables, functions, depth, input))
+						return false;
+					parameters[function->parameters[i]] = input;
+				}
+
+				return Evaluate(function->expression, parameters, variables, functions, depth + 1, out);
+			}
+
+			case TokenType::BuiltinFunction:
+			{
+				FunctionType function = token.GetBuiltinFunction();
+				if (IsHigherOrder(function))
+					return false;
+
+				// Only the selected branch of 'if' is evaluated and differentiated
+				if (function == FunctionType::If)
+				{
+					T condition;
+					if (nodes.size() != 3 || !Evaluate(nodes[0], locals, variables, functions, depth, condition))
+						return false;
+					return Evaluate(nodes[condition.value != complex(0) ? 1 : 2], locals, variables, functions, depth, out);
+				}
+
+				std::vector<T> inputs(nodes.size());
+				for (std::size_t i = 0; i < nodes.size(); i++)
+					if (!Evaluate(nodes[i], locals, variables, functions, depth, inputs[i]))
+						return false;
+
+				if (function == FunctionType::Log && inputs.size() == 2)
+				{
+					T numerator, denominator;
+					if (!Apply(function, inputs[0], numerator) || !Apply(function, inputs[1], denominator))
+						return false;
+					out = numerator / denominator;
+					return true;
+				}
+
+				// Products of scalars, see 'ApplyFunction()'
+				if ((function == FunctionType::Dot || function == FunctionType::MatMul) && inputs.size() == 2)
+				{
+					out = inputs[0] * inputs[1];
+					return true;
+				}
+
+				if (inputs.size() != 1)
+					return false;
+				return Apply(function, inputs[0], out);
+			}
+
+			default:
+				break;
+		}
+
+		if (nodes.size() != 2)
+			return false;
+
+		T lhs, rhs;
+		if (!Evaluate(nodes[0], locals, variables, functions, depth, lhs) || !Evaluate(nodes[1], locals, variables, functions, depth, rhs))
+			return false;
+
+		switch (token.Type())
+		{
+			case TokenType::Add:	out = lhs + rhs;		return true;
+			case TokenType::Sub:	out = lhs - rhs;		return true;
+			case TokenType::Mult:	out = lhs * rhs;		return true;
+			case TokenType::Div:	out = lhs / rhs;		return true;
+			case TokenType::Power:	out = Pow(lhs, rhs);	return true;
+			default:
+				break;
+		}
+
+		// Comparisons are piecewise constant
+		if (auto comparison = Compare(token.Type(), lhs.value, rhs.value); comparison >= 0)
+		{
+			out = T(comparison);
+			return true;
+		}
+
+		return false;
+	}
+
+	CalcResult Differentiate::Forward(const UserFunction& function, std::size_t index, const std::vector<complex>& point, const VariableList& variables, const FunctionList& functions, complex* value)
+	{
+		CalcResult error { .has_error = true };
+
+		if (point.size() != function.parameters.size() || index >= point.size())
+			return error;
+
+		LocalList<Dual> parameters;
+		for (std::size_t i = 0; i < point.size(); i++)
+			parameters[function.parameters[i]] = Dual(point[i], i == index ? 1 : 0);
+
+		Dual result;
+		if (!Evaluate(function.expression, parameters, variables, functions, 0, result))
+			return error;
+
+		if (value)
+			*value = result.value;
+		return { .value = result.derivative };
+	}
+
+	std::vector<complex> Differentiate::Reverse(const UserFunction& function, const std::vector<complex>& point, const VariableList& variables, const FunctionList& functions)
+	{
+		if (point.size() != function.parameters.size())
+			return {};
+
+		Tape tape;
+		Tape* previous = s_tape;
+		s_tape = &tape;
+
+		LocalList<Var> parameters;
+		for (std::size_t i = 0; i < point.size(); i++)
+		{
+			Var input(point[i]);
+			input.index = tape.entries.size();
+			tape.entries.push_back({ { s_no_entry, s_no_entry }, { 0, 0 } });
+			parameters[function.parameters[i]] = input;
+		}
+
+		Var result;
+		bool success = Evaluate(function.expression, parameters, variables, functions, 0, result);
+
+		s_tape = previous;
+
+		if (!success)
+			return {};
+
+		std::vector<complex> gradient(point.size(), 0);
+		if (result.index == s_no_entry)
+			return gradient;
+
+		std::vector<complex> adjoints(result.index + 1, 0);
+		adjoints[result.index] = 1;
+		for (std::size_t i = result.index + 1; i-- > 0;)
+		{
+			if (adjoints[i] == complex(0))
+				continue;
+			const auto& entry = tape.entries[i];
+			for (int j = 0; j < 2; j++)
+				if (entry.parents[j] != s_no_entry)
+					adjoints[entry.parents[j]] += adjoints[i] * entry.partials[j];
+		}
+
+		for (std::size_t i = 0; i < point.size(); i++)
+			gradient[i] = adjoints[i];
+		return gradient;
+	}
+
+}
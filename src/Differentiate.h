@@ -0,0 +1,16 @@
+#pragma once
+
+#include "TokenNode.h"
+
+namespace bcalc::Differentiate
+{
+
+	// Derivative of 'function' with respect to parameter 'index' at 'point', computed with forward mode (dual numbers).
+	// The function value computed in the same pass is stored to 'value' if it is not null.
+	CalcResult Forward(const UserFunction& function, std::size_t index, const std::vector<std::complex<value_type>>& point, const VariableList& variables, const FunctionList& functions, std::complex<value_type>* value = nullptr);
+
+	// Gradient of 'function' at 'point', computed with a single reverse mode sweep over a tape.
+	// Returns an empty vector if the function could not be evaluated.
+	std::vector<std::complex<value_type>> Reverse(const UserFunction& function, const std::vector<std::complex<value_type>>& point, const VariableList& variables, const FunctionList& functions);
+
+}
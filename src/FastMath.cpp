@@ -0,0 +1,466 @@
+// The kernels are written without branches so the loops over arrays vectorize, see Vectorize.h
+#include "Vectorize.h"
+
+#include "FastMath.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace bcalc
+{
+
+	static std::atomic<bool> s_enabled = false;
+
+	bool FastMath::Enabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	void FastMath::SetEnabled(bool enabled)
+	{
+		s_enabled = enabled;
+	}
+
+	bool FastMath::HasKernel(FunctionType function)
+	{
+		switch (function)
+		{
+			case FunctionType::Sin:
+			case FunctionType::Cos:
+			case FunctionType::Tan:
+			case FunctionType::Exp:
+			case FunctionType::Log:
+			case FunctionType::Sqrt:
+			case FunctionType::Sinh:
+			case FunctionType::Cosh:
+			case FunctionType::Tanh:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Everything below has to be inlined into the vectorized loops, calls would keep them scalar
+
+	#define BCALC_KERNEL [[gnu::always_inline]] static inline
+
+	template<typename T>
+	struct Traits;
+
+	template<>
+	struct Traits<double>
+	{
+		using Int = int64_t;
+		static constexpr int mantissa_bits	= 52;
+		static constexpr Int exponent_bias	= 1023;
+		// Adding and subtracting rounds to an integer that can be read from the low bits of the sum
+		static constexpr double round_magic	= 0x1.8p52;
+	};
+
+	template<>
+	struct Traits<float>
+	{
+		using Int = int32_t;
+		static constexpr int mantissa_bits	= 23;
+		static constexpr Int exponent_bias	= 127;
+		static constexpr float round_magic	= 0x1.8p23f;
+	};
+
+	template<typename T>
+	static constexpr bool s_double = std::is_same_v<T, double>;
+
+	template<typename T>
+	static constexpr T s_nan = std::numeric_limits<T>::quiet_NaN();
+
+	template<typename To, typename From>
+	BCALC_KERNEL To BitCast(From value)
+	{
+		return __builtin_bit_cast(To, value);
+	}
+
+	// Rounds 'x' to the nearest integer, returned both as T and as an integer
+	template<typename T>
+	BCALC_KERNEL T RoundToInt(T x, typename Traits<T>::Int& n)
+	{
+		using Int = typename Traits<T>::Int;
+		const T sum = x + Traits<T>::round_magic;
+		n = BitCast<Int>(sum) - BitCast<Int>(Traits<T>::round_magic);
+		return sum - Traits<T>::round_magic;
+	}
+
+	// Integer to T without conversion instructions, AVX2 has none for 64 bit integers
+	template<typename T>
+	BCALC_KERNEL T IntToFloat(typename Traits<T>::Int n)
+	{
+		using Int = typename Traits<T>::Int;
+		return BitCast<T>(BitCast<Int>(Traits<T>::round_magic) + n) - Traits<T>::round_magic;
+	}
+
+	// x * 2^n for results in the normal range
+	template<typename T>
+	BCALC_KERNEL T ScalePow2(T x, typename Traits<T>::Int n)
+	{
+		using Int = typename Traits<T>::Int;
+		return BitCast<T>(BitCast<Int>(x) + (n << Traits<T>::mantissa_bits));
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Exp(T x)
+	{
+		using Int = typename Traits<T>::Int;
+
+		// x = k ln2 + r with |r| <= ln2 / 2, 'ln2_hi' has trailing zero bits so 'k * ln2_hi' is exact
+		constexpr T log2e	= 1.44269504088896338700;
+		constexpr T ln2_hi	= s_double<T> ? 6.93147180369123816490e-01 : 0.693359375f;
+		constexpr T ln2_lo	= s_double<T> ? 1.90821492927058770002e-10 : -2.12194440e-4f;
+		constexpr T min		= s_double<T> ? -707.0 : -86.0f;
+		constexpr T max		= s_double<T> ? 709.0 : 88.0f;
+
+		Int n;
+		const T k = RoundToInt(x * log2e, n);
+		const T r = (x - k * ln2_hi) - k * ln2_lo;
+
+		T p;
+		if constexpr (s_double<T>)
+		{
+			// Taylor series up to r^13, the rest is below half an ulp for |r| <= ln2 / 2
+			p = 1.0 / 6227020800.0;
+			p = p * r + 1.0 / 479001600.0;
+			p = p * r + 1.0 / 39916800.0;
+			p = p * r + 1.0 / 3628800.0;
+			p = p * r + 1.0 / 362880.0;
+			p = p * r + 1.0 / 40320.0;
+			p = p * r + 1.0 / 5040.0;
+			p = p * r + 1.0 / 720.0;
+			p = p * r + 1.0 / 120.0;
+			p = p * r + 1.0 / 24.0;
+			p = p * r + 1.0 / 6.0;
+			p = p * r + 0.5;
+			p = p * r * r + r + 1.0;
+		}
+		else
+		{
+			// Minimax polynomial from Cephes
+			p = 1.9875691500e-4f;
+			p = p * r + 1.3981999507e-3f;
+			p = p * r + 8.3334519073e-3f;
+			p = p * r + 4.1665795894e-2f;
+			p = p * r + 1.6666665459e-1f;
+			p = p * r + 5.0000001201e-1f;
+			p = p * r * r + r + 1.0f;
+		}
+
+		const T result = ScalePow2(p, n);
+		return x >= min && x <= max ? result : s_nan<T>;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Log(T x)
+	{
+		using Int = typename Traits<T>::Int;
+		constexpr int mantissa_bits = Traits<T>::mantissa_bits;
+		constexpr Int mantissa_mask = (Int(1) << mantissa_bits) - 1;
+
+		constexpr T ln2_hi	= s_double<T> ? 6.93147180369123816490e-01 : 6.9313812256e-01f;
+		constexpr T ln2_lo	= s_double<T> ? 1.90821492927058770002e-10 : 9.0580006145e-06f;
+		constexpr T sqrt2	= 1.41421356237309504880;
+
+		// x = m 2^e with m in [sqrt(2) / 2, sqrt(2))
+		const Int bits = BitCast<Int>(x);
+		Int e = (bits >> mantissa_bits) - Traits<T>::exponent_bias;
+		T m = BitCast<T>((bits & mantissa_mask) | (Traits<T>::exponent_bias << mantissa_bits));
+		const Int halve = m > sqrt2 ? 1 : 0;
+		m = halve ? m * T(0.5) : m;
+		e += halve;
+
+		// log(m) = f - hfsq + s (hfsq + R) with f = m - 1, s = f / (2 + f), as in fdlibm
+		const T f = m - T(1);
+		const T s = f / (T(2) + f);
+		const T z = s * s;
+		const T w = z * z;
+
+		T R;
+		if constexpr (s_double<T>)
+		{
+			const T t1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+			const T t2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+			R = t1 + t2;
+		}
+		else
+		{
+			const T t1 = w * (0x1.99c264p-2f + w * 0x1.f13c4cp-3f);
+			const T t2 = z * (0x1.555554p-1f + w * 0x1.23d3dcp-2f);
+			R = t1 + t2;
+		}
+
+		const T hfsq = T(0.5) * f * f;
+		const T k = IntToFloat<T>(e);
+		const T result = k * ln2_hi - ((hfsq - (s * (hfsq + R) + k * ln2_lo)) - f);
+
+		// Zero, negatives, subnormals, infinity and NaN are left to the exact path
+		return x >= std::numeric_limits<T>::min() && x <= std::numeric_limits<T>::max() ? result : s_nan<T>;
+	}
+
+	// Sine and cosine of 'x' reduced to |r| <= pi / 4, 'q' is the quadrant
+	template<typename T>
+	BCALC_KERNEL void SinCosReduced(T x, T& sin, T& cos, typename Traits<T>::Int& q)
+	{
+		// pi / 2 in three parts, the first two with 33 bits so their products with 'k' are exact for |k| < 2^20
+		constexpr double two_over_pi	= 0.636619772367581343076;
+		constexpr double pio2_1			= 1.57079632673412561417e+00;
+		constexpr double pio2_2			= 6.07710050630396597660e-11;
+		constexpr double pio2_3			= 2.02226624879595063154e-21;
+
+		// Float arguments are reduced in double, three float parts would lose the result near multiples of pi / 2
+		T r;
+		const T k = RoundToInt(x * T(two_over_pi), q);
+		if constexpr (s_double<T>)
+			r = ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+		else
+			r = static_cast<T>((static_cast<double>(x) - static_cast<double>(k) * pio2_1) - static_cast<double>(k) * pio2_2);
+		const T z = r * r;
+
+		// Polynomials from fdlibm (double) and Cephes (float)
+		T ps, pc;
+		if constexpr (s_double<T>)
+		{
+			ps = -1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10))));
+			pc = 4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 + z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11))));
+		}
+		else
+		{
+			ps = -1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f);
+			pc = 4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f);
+		}
+
+		sin = r + r * z * ps;
+
+		// 1 - z / 2 loses the low bits of z / 2, they are added back separately
+		const T hz = T(0.5) * z;
+		const T w = T(1) - hz;
+		cos = w + (((T(1) - w) - hz) + z * z * pc);
+	}
+
+	template<typename T>
+	BCALC_KERNEL bool InTrigRange(T x)
+	{
+		constexpr T max = s_double<T> ? 1e5 : 8192.0f;
+		return x >= -max && x <= max;
+	}
+
+	template<typename T>
+	BCALC_KERNEL void SinCos(T x, T& sin, T& cos)
+	{
+		typename Traits<T>::Int q;
+		T s, c;
+		SinCosReduced(x, s, c, q);
+
+		// sin(r + q pi / 2) and cos(r + q pi / 2) by quadrant
+		const T sin_abs = (q & 1) ? c : s;
+		const T cos_abs = (q & 1) ? s : c;
+		sin = (q & 2) ? -sin_abs : sin_abs;
+		cos = ((q + 1) & 2) ? -cos_abs : cos_abs;
+
+		const bool valid = InTrigRange(x);
+		sin = valid ? sin : s_nan<T>;
+		cos = valid ? cos : s_nan<T>;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Sin(T x)
+	{
+		T sin, cos;
+		SinCos(x, sin, cos);
+		return sin;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Cos(T x)
+	{
+		T sin, cos;
+		SinCos(x, sin, cos);
+		return cos;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Tan(T x)
+	{
+		typename Traits<T>::Int q;
+		T s, c;
+		SinCosReduced(x, s, c, q);
+
+		// tan(r + pi / 2) = -cot(r)
+		const T result = (q & 1) ? -c / s : s / c;
+		return InTrigRange(x) ? result : s_nan<T>;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Sqrt(T x)
+	{
+		// NaN for negative x
+		if constexpr (s_double<T>)
+			return __builtin_sqrt(x);
+		else
+			return __builtin_sqrtf(x);
+	}
+
+	// Taylor series of sinh for |x| <= 1, where the exponential form cancels
+	template<typename T>
+	BCALC_KERNEL T SinhSmall(T x)
+	{
+		const T z = x * x;
+		T p;
+		if constexpr (s_double<T>)
+			p = 1.0 / 6.0 + z * (1.0 / 120.0 + z * (1.0 / 5040.0 + z * (1.0 / 362880.0 + z * (1.0 / 39916800.0 + z * (1.0 / 6227020800.0 + z * (1.0 / 1307674368000.0 + z * (1.0 / 355687428096000.0)))))));
+		else
+			p = 1.0f / 6.0f + z * (1.0f / 120.0f + z * (1.0f / 5040.0f + z * (1.0f / 362880.0f + z * (1.0f / 39916800.0f))));
+		return x + x * z * p;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Sinh(T x)
+	{
+		const T a = x < 0 ? -x : x;
+		const T e = Exp(a);
+		T large = T(0.5) * e - T(0.5) / e;
+		large = x < 0 ? -large : large;
+		return a <= T(1) ? SinhSmall(x) : large;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Cosh(T x)
+	{
+		const T e = Exp(x < 0 ? -x : x);
+		return T(0.5) * e + T(0.5) / e;
+	}
+
+	template<typename T>
+	BCALC_KERNEL T Tanh(T x)
+	{
+		// Beyond this tanh rounds to +-1
+		constexpr T saturation = s_double<T> ? 22.0 : 9.0f;
+
+		const T a = x < 0 ? -x : x;
+
+		const T s = SinhSmall(x);
+		const T small = s / Sqrt(T(1) + s * s);
+
+		const T e = Exp(T(2) * (a < saturation ? a : saturation));
+		T large = a < saturation ? T(1) - T(2) / (e + T(1)) : T(1);
+		large = x < 0 ? -large : large;
+
+		const T result = a <= T(1) ? small : large;
+		return x == x ? result : s_nan<T>;
+	}
+
+	#undef BCALC_KERNEL
+
+	template<typename T>
+	static T ApplyScalar(FunctionType function, T x)
+	{
+		switch (function)
+		{
+			case FunctionType::Sin:		return Sin(x);
+			case FunctionType::Cos:		return Cos(x);
+			case FunctionType::Tan:		return Tan(x);
+			case FunctionType::Exp:		return Exp(x);
+			case FunctionType::Log:		return Log(x);
+			case FunctionType::Sqrt:	return Sqrt(x);
+			case FunctionType::Sinh:	return Sinh(x);
+			case FunctionType::Cosh:	return Cosh(x);
+			case FunctionType::Tanh:	return Tanh(x);
+			default:					return s_nan<T>;
+		}
+	}
+
+	double FastMath::Apply(FunctionType function, double x)
+	{
+		return ApplyScalar(function, x);
+	}
+
+	float FastMath::Apply(FunctionType function, float x)
+	{
+		return ApplyScalar(function, x);
+	}
+
+	// One loop per kernel, the switch is outside of them so each one vectorizes
+	template<typename T>
+	BCALC_VECTOR_TARGETS
+	static void ApplyArray(FunctionType function, const T* in, T* out, std::size_t count)
+	{
+		switch (function)
+		{
+			case FunctionType::Sin:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Sin(in[i]);
+				break;
+			case FunctionType::Cos:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Cos(in[i]);
+				break;
+			case FunctionType::Tan:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Tan(in[i]);
+				break;
+			case FunctionType::Exp:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Exp(in[i]);
+				break;
+			case FunctionType::Log:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Log(in[i]);
+				break;
+			case FunctionType::Sqrt:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Sqrt(in[i]);
+				break;
+			case FunctionType::Sinh:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Sinh(in[i]);
+				break;
+			case FunctionType::Cosh:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Cosh(in[i]);
+				break;
+			case FunctionType::Tanh:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = Tanh(in[i]);
+				break;
+			default:
+				for (std::size_t i = 0; i < count; i++)
+					out[i] = s_nan<T>;
+				break;
+		}
+	}
+
+	template<typename T>
+	BCALC_VECTOR_TARGETS
+	static void SinCosArray(const T* in, T* sin, T* cos, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; i++)
+			SinCos(in[i], sin[i], cos[i]);
+	}
+
+	void FastMath::Apply(FunctionType function, const double* in, double* out, std::size_t count)
+	{
+		ApplyArray(function, in, out, count);
+	}
+
+	void FastMath::Apply(FunctionType function, const float* in, float* out, std::size_t count)
+	{
+		ApplyArray(function, in, out, count);
+	}
+
+	void FastMath::SinCos(const double* in, double* sin, double* cos, std::size_t count)
+	{
+		SinCosArray(in, sin, cos, count);
+	}
+
+	void FastMath::SinCos(const float* in, float* sin, float* cos, std::size_t count)
+	{
+		SinCosArray(in, sin, cos, count);
+	}
+
+}
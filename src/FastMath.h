@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Token.h"
+
+#include <cstddef>
+
+namespace bcalc::FastMath
+{
+
+	// Opt-in mode where real arguments of the builtins below are evaluated with these kernels in double
+	// instead of 'std::complex<long double>'. Process wide, set through 'Program::SetFastMath()'.
+	bool Enabled();
+	void SetEnabled(bool enabled);
+
+	// Sin, Cos, Tan, Exp, Log (one argument), Sqrt, Sinh, Cosh and Tanh have kernels
+	bool HasKernel(FunctionType function);
+
+	// Kernels return NaN for arguments outside of the range they are accurate in (including every argument
+	// with a complex or non-finite result), the caller evaluates those exactly instead.
+	//
+	// Accurate ranges and error bounds against the long double 'std' functions, in units in the last place of
+	// the result type. tests/FastMath.cpp checks them over 2 * 10^6 random arguments per range:
+	//
+	//                 double range        double      float range         float
+	//   sin, cos      |x| <= 1e5          2.5 ulp     |x| <= 8192         1.6 ulp
+	//   tan           |x| <= 1e5          3.8 ulp     |x| <= 8192         3.2 ulp
+	//   exp           -707 <= x <= 709    1.0 ulp     -86 <= x <= 88      1.0 ulp
+	//   log           normal x > 0        0.9 ulp     normal x > 0        1.6 ulp
+	//   sqrt          x >= 0              0.5 ulp     x >= 0              0.5 ulp
+	//   sinh, cosh    |x| <= 707          1.7 ulp     |x| <= 86           1.6 ulp
+	//   tanh          any x               2.7 ulp     any x               2.7 ulp
+	double Apply(FunctionType function, double x);
+	float Apply(FunctionType function, float x);
+
+	// Applies the kernel of 'function' to 'count' values. Uses the widest vectors of the running CPU,
+	// chosen once at startup: AVX-512, AVX2 with FMA, or SSE2. 'in' and 'out' may be the same array.
+	void Apply(FunctionType function, const double* in, double* out, std::size_t count);
+	void Apply(FunctionType function, const float* in, float* out, std::size_t count);
+
+	// Sine and cosine of the same arguments for the cost of little more than one of them
+	void SinCos(const double* in, double* sin, double* cos, std::size_t count);
+	void SinCos(const float* in, float* sin, float* cos, std::size_t count);
+
+}
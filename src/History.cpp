@@ -0,0 +1,185 @@
+#include "History.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bcalc
+{
+
+	// Entries kept from earlier sessions, older ones are dropped from the file when it is opened
+	static constexpr std::size_t s_max_entries = 10000;
+
+	History::~History()
+	{
+		if (m_mapped)
+			munmap(const_cast<char*>(m_mapped), m_mapped_size);
+		if (m_file != -1)
+			close(m_file);
+	}
+
+	bool History::Open(const std::string& path)
+	{
+		m_file = open(path.c_str(), O_RDWR | O_APPEND | O_CREAT, 0600);
+		if (m_file == -1)
+			return false;
+
+		struct stat st;
+		if (fstat(m_file, &st) == -1 || st.st_size == 0)
+			return true;
+
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (mapped == MAP_FAILED)
+			return true;
+
+		m_mapped = static_cast<const char*>(mapped);
+		m_mapped_size = st.st_size;
+
+		// One entry per line
+		std::vector<std::string_view> entries;
+		const char* current = m_mapped;
+		const char* end = m_mapped + m_mapped_size;
+		while (current < end)
+		{
+			const char* newline = static_cast<const char*>(memchr(current, '\n', end - current));
+			if (!newline)
+				newline = end;
+			if (newline > current)
+				entries.emplace_back(current, static_cast<std::size_t>(newline - current));
+			current = newline + 1;
+		}
+
+		const std::size_t first = entries.size() > s_max_entries ? entries.size() - s_max_entries : 0;
+		for (std::size_t i = first; i < entries.size(); i++)
+			Append(entries[i]);
+
+		if (first > 0)
+			Rewrite(path);
+
+		return true;
+	}
+
+	void History::Rewrite(const std::string& path)
+	{
+		std::string contents;
+		for (std::string_view entry : m_entries)
+		{
+			contents += entry;
+			contents += '\n';
+		}
+
+		// Written beside the file and renamed over it, a failure leaves the old file in place. The mapping
+		// of the old file stays valid after the rename.
+		const std::string temporary = path + ".tmp";
+		int file = open(temporary.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC, 0600);
+		if (file == -1)
+			return;
+
+		if (write(file, contents.data(), contents.size()) != static_cast<ssize_t>(contents.size()) || rename(temporary.c_str(), path.c_str()) == -1)
+		{
+			close(file);
+			unlink(temporary.c_str());
+			return;
+		}
+
+		close(m_file);
+		m_file = file;
+	}
+
+	std::string_view History::Get(std::size_t index) const
+	{
+		if (auto it = m_edits.find(index); it != m_edits.end())
+			return it->second;
+		if (index < m_entries.size())
+			return m_entries[index];
+		return {};
+	}
+
+	std::string& History::Edit(std::size_t index)
+	{
+		auto it = m_edits.find(index);
+		if (it == m_edits.end())
+			it = m_edits.emplace(index, std::string(Get(index))).first;
+		return it->second;
+	}
+
+	void History::Add(std::string_view line)
+	{
+		if (line.empty() || line.find('\n') != std::string_view::npos)
+			return;
+		if (!m_entries.empty() && m_entries.back() == line)
+			return;
+
+		m_session_entries.emplace_back(line);
+		Append(m_session_entries.back());
+
+		if (m_file == -1)
+			return;
+
+		// Stop persisting after a failed write rather than leaving partial lines
+		std::string record = m_session_entries.back() + '\n';
+		if (write(m_file, record.data(), record.size()) != static_cast<ssize_t>(record.size()))
+		{
+			close(m_file);
+			m_file = -1;
+		}
+	}
+
+	uint32_t History::Trigram(std::string_view text, std::size_t position)
+	{
+		return static_cast<uint8_t>(text[position]) << 16 | static_cast<uint8_t>(text[position + 1]) << 8 | static_cast<uint8_t>(text[position + 2]);
+	}
+
+	void History::Append(std::string_view entry)
+	{
+		const uint32_t index = m_entries.size();
+		m_entries.push_back(entry);
+
+		for (std::size_t i = 0; i + 3 <= entry.size(); i++)
+		{
+			auto& postings = m_index[Trigram(entry, i)];
+			if (postings.empty() || postings.back() != index)
+				postings.push_back(index);
+		}
+	}
+
+	std::size_t History::Search(std::string_view query, std::size_t before) const
+	{
+		before = std::min(before, m_entries.size());
+
+		// Short queries have no trigrams to look up
+		if (query.size() < 3)
+		{
+			for (std::size_t i = before; i-- > 0;)
+				if (m_entries[i].find(query) != std::string_view::npos)
+					return i;
+			return m_entries.size();
+		}
+
+		// Candidates come from the rarest trigram of the query, every match contains it
+		const std::vector<uint32_t>* rarest = nullptr;
+		for (std::size_t i = 0; i + 3 <= query.size(); i++)
+		{
+			auto it = m_index.find(Trigram(query, i));
+			if (it == m_index.end())
+				return m_entries.size();
+			if (!rarest || it->second.size() < rarest->size())
+				rarest = &it->second;
+		}
+
+		auto end = std::lower_bound(rarest->begin(), rarest->end(), before);
+		for (auto it = end; it != rarest->begin();)
+		{
+			--it;
+			if (m_entries[*it].find(query) != std::string_view::npos)
+				return *it;
+		}
+		return m_entries.size();
+	}
+
+}
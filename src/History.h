@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bcalc
+{
+
+	// Input history of the TUI. Entries from earlier sessions are read from a memory mapped file, new entries
+	// are appended to it as they are added. Browsing never copies entries: edits to old entries are kept in
+	// an overlay that is dropped when the current line is submitted.
+	class History
+	{
+	public:
+		History() = default;
+		~History();
+
+		History(const History&) = delete;
+		History& operator=(const History&) = delete;
+
+		// Maps 'path' and opens it for appending. A file of too many entries is rewritten with the newest
+		// ones only. Without a file the history lasts for the session only.
+		bool Open(const std::string& path);
+
+		// Number of entries, index Size() is the line being typed
+		std::size_t Size() const { return m_entries.size(); }
+
+		// Entry 'index' with edits applied
+		std::string_view Get(std::size_t index) const;
+		// Mutable copy of entry 'index' in the overlay
+		std::string& Edit(std::size_t index);
+
+		// Adds 'line' as the newest entry unless it repeats the newest one
+		void Add(std::string_view line);
+		void DiscardEdits() { m_edits.clear(); }
+
+		// Returns the newest entry before 'before' containing 'query' or Size() if there is none.
+		// Edits are not searched.
+		std::size_t Search(std::string_view query, std::size_t before) const;
+
+	private:
+		void Append(std::string_view entry);
+		// Replaces the file at 'path' by the entries
+		void Rewrite(const std::string& path);
+
+		static uint32_t Trigram(std::string_view text, std::size_t position);
+
+	private:
+		std::vector<std::string_view>	m_entries;
+		std::deque<std::string>			m_session_entries; // storage for entries added this session, never moves
+
+		std::unordered_map<std::size_t, std::string> m_edits;
+
+		// Trigram to ascending indices of entries containing it
+		std::unordered_map<uint32_t, std::vector<uint32_t>> m_index;
+
+		const char*	m_mapped		= nullptr;
+		std::size_t	m_mapped_size	= 0;
+		int			m_file			= -1;
+	};
+
+}
@@ -0,0 +1,202 @@
+#include "Interpreter.h"
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+	using Op = Bytecode::Op;
+
+	// Non-tail recursion deeper than this is treated as runaway
+	static constexpr std::size_t s_max_frames = 1 << 24;
+
+	struct Frame
+	{
+		const Bytecode*	bytecode;
+		std::size_t		pc;
+		std::size_t		base; // index of the first parameter in 'locals'
+	};
+
+	CalcResult Interpreter::Execute(const Bytecode& bytecode, const std::vector<complex>& arguments, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (arguments.size() != bytecode.parameters.size())
+			return error;
+
+		if (!Cancellation::Checkpoint(bytecode.code.size()))
+			return error;
+
+		std::vector<complex> stack;
+		std::vector<complex> locals = arguments;
+		std::vector<complex> inputs;
+
+		std::vector<Frame> frames;
+		frames.push_back({ .bytecode = &bytecode, .pc = 0, .base = 0 });
+
+		// Calls user function 'name' with the top 'count' values of the stack as arguments
+		auto call = [&](const std::string& name, std::size_t count, bool tail) -> bool
+		{
+			const UserFunction* function = FindFunction(functions, name, count);
+			if (!function || !function->code)
+			{
+				if (function)
+				{
+					auto result = Invoke(*function, { stack.end() - count, stack.end() }, variables, functions);
+					if (result.has_error)
+						return false;
+					stack.resize(stack.size() - count);
+					stack.push_back(result.value);
+					return true;
+				}
+
+				// Same as tree evaluation, variables can be "called"
+				auto it = variables.find(name);
+				if (it == variables.end())
+					return false;
+				stack.resize(stack.size() - count);
+				stack.push_back(it->second);
+				return true;
+			}
+
+			// Code without calls is straight-line, so checking at calls bounds the work between checks.
+			// The body counts as one node per instruction.
+			if (!Cancellation::Checkpoint(function->code->code.size()))
+				return false;
+
+			if (tail)
+			{
+				Frame& frame = frames.back();
+				locals.resize(frame.base);
+				frame.bytecode = function->code;
+				frame.pc = 0;
+			}
+			else
+			{
+				if (frames.size() >= s_max_frames)
+					return false;
+				frames.push_back({ .bytecode = function->code, .pc = 0, .base = locals.size() });
+			}
+
+			locals.insert(locals.end(), stack.end() - count, stack.end());
+			stack.resize(stack.size() - count);
+			return true;
+		};
+
+		while (true)
+		{
+			Frame& frame = frames.back();
+			const Bytecode& current = *frame.bytecode;
+			const Bytecode::Instruction& instruction = current.code[frame.pc++];
+
+			switch (instruction.op)
+			{
+				case Op::Constant:
+					stack.push_back(current.constants[instruction.a]);
+					break;
+
+				case Op::LoadLocal:
+					stack.push_back(locals[frame.base + instruction.a]);
+					break;
+
+				case Op::LoadGlobal:
+				{
+					const std::string& name = current.names[instruction.a];
+					if (auto it = variables.find(name); it != variables.end())
+						stack.push_back(it->second);
+					else if (!call(name, 0, false))
+						return error;
+					break;
+				}
+
+				case Op::Binary:
+				{
+					complex rhs = stack.back();
+					stack.pop_back();
+					auto result = ApplyOperator(static_cast<TokenType>(instruction.a), stack.back(), rhs);
+					if (result.has_error)
+						return error;
+					stack.back() = result.value;
+					break;
+				}
+
+				case Op::Builtin:
+				{
+					inputs.assign(stack.end() - instruction.b, stack.end());
+					stack.resize(stack.size() - instruction.b);
+					auto result = ApplyFunction(static_cast<FunctionType>(instruction.a), inputs);
+					if (result.has_error)
+						return error;
+					stack.push_back(result.value);
+					break;
+				}
+
+				case Op::JumpIfFalse:
+				{
+					complex condition = stack.back();
+					stack.pop_back();
+					if (condition == complex(0))
+						frame.pc = instruction.a;
+					break;
+				}
+
+				case Op::Jump:
+					frame.pc = instruction.a;
+					break;
+
+				case Op::Call:
+				case Op::TailCall:
+					if (!call(current.names[instruction.a], instruction.b, instruction.op == Op::TailCall))
+						return error;
+					break;
+
+				case Op::HigherOrder:
+				{
+					// The function operated on sees globals only, like any other callee
+					const auto& [function, name] = current.higher_order[instruction.a];
+					inputs.assign(stack.end() - instruction.b, stack.end());
+					stack.resize(stack.size() - instruction.b);
+					auto result = ApplyHigherOrder(function, name, inputs, variables, functions);
+					if (result.has_error)
+						return error;
+					stack.push_back(result.value);
+					break;
+				}
+
+				case Op::Fallback:
+				{
+					auto result = current.fallbacks[instruction.a]->approximate(variables, functions);
+					if (result.has_error)
+						return error;
+					stack.push_back(result.value);
+					break;
+				}
+
+				case Op::Return:
+				{
+					complex result = stack.back();
+					stack.pop_back();
+
+					locals.resize(frame.base);
+					frames.pop_back();
+					if (frames.empty())
+						return { .value = result };
+
+					stack.push_back(result);
+					break;
+				}
+			}
+		}
+	}
+
+	CalcResult Interpreter::Evaluate(const TokenNode* root, const VariableList& variables, const FunctionList& functions)
+	{
+		Bytecode* bytecode = Compile(root);
+		if (!bytecode)
+			return { .has_error = true };
+
+		auto result = Execute(*bytecode, {}, variables, functions);
+		delete bytecode;
+		return result;
+	}
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Bytecode.h"
+
+namespace bcalc::Interpreter
+{
+
+	// Executes 'bytecode' with 'arguments' in its parameter slots. User function calls run on a heap allocated
+	// frame stack and calls in tail position reuse the caller's frame, so recursion is not limited by the C++ stack.
+	CalcResult Execute(const Bytecode& bytecode, const std::vector<std::complex<value_type>>& arguments, const VariableList& variables, const FunctionList& functions);
+
+	// Compiles and executes an expression without parameters.
+	CalcResult Evaluate(const TokenNode* root, const VariableList& variables, const FunctionList& functions);
+
+}
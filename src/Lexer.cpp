@@ -9,8 +9,21 @@ namespace bcalc
 	std::vector<Token> Lexer::Tokenize(std::string_view data)
 	{
 		std::vector<Token> result;
+		std::vector<Span> spans;
+		if (!Tokenize(data, 0, result, spans))
+			return {};
+		return result;
+	}
+
+	bool Lexer::Tokenize(std::string_view data, std::size_t start, std::vector<Token>& result, std::vector<Span>& spans)
+	{
+		auto push = [&](Token token, std::size_t begin, std::size_t end)
+		{
+			result.push_back(std::move(token));
+			spans.push_back({ .begin = begin, .end = end });
+		};
 
-		for (uint64_t i = 0; i < data.size(); i++)
+		for (uint64_t i = start; i < data.size(); i++)
 		{
 			if (isspace(data[i]))
 				continue;
@@ -19,43 +32,54 @@ namespace bcalc
 			{
 				value_type value;
 				auto [ptr, _] = std::from_chars(data.data() + i, data.data() + data.size(), value);
-				result.push_back(Token::CreateValue(value));
-				i = ptr - data.data() - 1;
+				std::size_t end = ptr - data.data();
+				push(Token::CreateValue(value, std::string(data.data() + i, ptr)), i, end);
+				i = end - 1;
 				continue;
 			}
 
 			if (isalpha(data[i]))
 			{
 				uint64_t len = 1;
-				while (i + len < data.size() && (isalpha(data[i + len]) || isdigit(data[i + len]))) len++;
+				while (i + len < data.size() && (isalpha(data[i + len]) || isdigit(data[i + len]) || data[i + len] == '_')) len++;
 				std::string val(data.data() + i, len);
 
 				if (!result.empty())
 				{
 					auto last = result.back().Type();
 					if (last == TokenType::Value || last == TokenType::String || last == TokenType::Constant || last == TokenType::BuiltinFunction)
-						result.push_back(Token::Create(TokenType::Mult));
+						push(Token::Create(TokenType::Mult), i, i);
 				}
 
 				if (auto it = s_string_to_function.find(val); it != s_string_to_function.end())
-					result.push_back(Token::CreateBuiltinFunction(it->second));
+					push(Token::CreateBuiltinFunction(it->second), i, i + len);
 				else if (auto it = s_string_to_constant.find(val); it != s_string_to_constant.end())
-					result.push_back(Token::CreateConstant(it->second));
+					push(Token::CreateConstant(it->second), i, i + len);
 				else
-					result.push_back(Token::CreateString(val));
+					push(Token::CreateString(val), i, i + len);
 				i += len - 1;
 				continue;
 			}
 
+			if (i + 1 < data.size())
+			{
+				if (auto it = s_string_to_token.find(std::string(data.substr(i, 2))); it != s_string_to_token.end())
+				{
+					push(Token::Create(it->second), i, i + 2);
+					i++;
+					continue;
+				}
+			}
+
 			if (auto it = s_char_to_token.find(data[i]); it != s_char_to_token.end())
-				result.push_back(Token::Create(it->second));
+				push(Token::Create(it->second), i, i + 1);
 			else
 			{
-				return {};
+				return false;
 			}
 		}
 
-		return result;
+		return true;
 	}
 
 }
@@ -8,6 +8,17 @@
 namespace bcalc::Lexer
 {
 
+	// Source range of a token, empty for multiplications inserted between juxtaposed operands
+	struct Span
+	{
+		std::size_t begin;
+		std::size_t end;
+	};
+
 	std::vector<Token> Tokenize(std::string_view);
 
-}
\ No newline at end of file
+	// Lexes 'data' from 'start' on, appending to 'tokens' and 'spans' which already hold the tokens of
+	// data[0, start). Lets callers keep the tokens of an unchanged prefix. Returns false on invalid input.
+	bool Tokenize(std::string_view data, std::size_t start, std::vector<Token>& tokens, std::vector<Span>& spans);
+
+}
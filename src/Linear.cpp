@@ -0,0 +1,412 @@
+// Vectorizes the row loops below, see Vectorize.h
+#include "Vectorize.h"
+
+#include "Linear.h"
+
+#include "FastMath.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+	using Linear::Matrix;
+
+	// A block of 'rhs' this deep and wide is reused by every row of a chunk while it is in L2 cache
+	static constexpr std::size_t s_block_depth		= 128;
+	static constexpr std::size_t s_block_columns	= 256;
+	// Rows of the product updated together, every loaded element of 'rhs' is used for each of them
+	static constexpr std::size_t s_row_group		= 4;
+	// Rows of the product computed between cancellation checks, also the unit of work of a thread
+	static constexpr std::size_t s_row_chunk		= 64;
+
+	// Rows updated by one thread during elimination
+	static constexpr std::size_t s_elimination_chunk = 128;
+
+	// Rows and columns shown from each end of large matrices
+	static constexpr std::size_t s_shown_edge = 3;
+
+	bool Matrix::IsReal() const
+	{
+		return std::all_of(m_values.begin(), m_values.end(), [](const complex& value) { return value.imag() == 0; });
+	}
+
+	// out[first, last) += lhs[first, last) * rhs for row major planes
+	template<typename T>
+	[[gnu::always_inline]] static inline void MultiplyKernel(const T* __restrict lhs, const T* __restrict rhs, T* __restrict out, std::size_t depth, std::size_t columns, std::size_t first, std::size_t last)
+	{
+		for (std::size_t jj = 0; jj < columns; jj += s_block_columns)
+		{
+			const std::size_t j_end = std::min(jj + s_block_columns, columns);
+			for (std::size_t pp = 0; pp < depth; pp += s_block_depth)
+			{
+				const std::size_t p_end = std::min(pp + s_block_depth, depth);
+
+				std::size_t i = first;
+				for (; i + s_row_group <= last; i += s_row_group)
+				{
+					T* __restrict c0 = out + (i + 0) * columns;
+					T* __restrict c1 = out + (i + 1) * columns;
+					T* __restrict c2 = out + (i + 2) * columns;
+					T* __restrict c3 = out + (i + 3) * columns;
+					for (std::size_t p = pp; p < p_end; p++)
+					{
+						const T* __restrict b = rhs + p * columns;
+						const T a0 = lhs[(i + 0) * depth + p];
+						const T a1 = lhs[(i + 1) * depth + p];
+						const T a2 = lhs[(i + 2) * depth + p];
+						const T a3 = lhs[(i + 3) * depth + p];
+						for (std::size_t j = jj; j < j_end; j++)
+						{
+							c0[j] += a0 * b[j];
+							c1[j] += a1 * b[j];
+							c2[j] += a2 * b[j];
+							c3[j] += a3 * b[j];
+						}
+					}
+				}
+
+				for (; i < last; i++)
+				{
+					T* __restrict c = out + i * columns;
+					for (std::size_t p = pp; p < p_end; p++)
+					{
+						const T* __restrict b = rhs + p * columns;
+						const T a = lhs[i * depth + p];
+						for (std::size_t j = jj; j < j_end; j++)
+							c[j] += a * b[j];
+					}
+				}
+			}
+		}
+	}
+
+	BCALC_VECTOR_TARGETS
+	static void MultiplyRows(const double* lhs, const double* rhs, double* out, std::size_t depth, std::size_t columns, std::size_t first, std::size_t last)
+	{
+		MultiplyKernel(lhs, rhs, out, depth, columns, first, last);
+	}
+
+	// Long double has no vector instructions
+	static void MultiplyRows(const long double* lhs, const long double* rhs, long double* out, std::size_t depth, std::size_t columns, std::size_t first, std::size_t last)
+	{
+		MultiplyKernel(lhs, rhs, out, depth, columns, first, last);
+	}
+
+	template<typename T>
+	static std::vector<T> RealPlane(const Matrix& matrix)
+	{
+		std::vector<T> plane(matrix.Size());
+		for (std::size_t i = 0; i < plane.size(); i++)
+			plane[i] = static_cast<T>(matrix.Data()[i].real());
+		return plane;
+	}
+
+	template<typename T>
+	static std::vector<T> ImagPlane(const Matrix& matrix, T sign = 1)
+	{
+		std::vector<T> plane(matrix.Size());
+		for (std::size_t i = 0; i < plane.size(); i++)
+			plane[i] = sign * static_cast<T>(matrix.Data()[i].imag());
+		return plane;
+	}
+
+	template<typename T>
+	static bool MultiplyPlanes(const Matrix& lhs, const Matrix& rhs, Matrix& out)
+	{
+		const std::size_t rows = lhs.Rows();
+		const std::size_t depth = lhs.Columns();
+		const std::size_t columns = rhs.Columns();
+		const bool real = lhs.IsReal() && rhs.IsReal();
+
+		// (a + bi)(c + di) = (ac + (-b)d) + (ad + bc)i, each product accumulates into a plane of the result
+		const std::vector<T> a = RealPlane<T>(lhs);
+		const std::vector<T> c = RealPlane<T>(rhs);
+		std::vector<T> b, minus_b, d;
+		if (!real)
+		{
+			b = ImagPlane<T>(lhs);
+			minus_b = ImagPlane<T>(lhs, -1);
+			d = ImagPlane<T>(rhs);
+		}
+
+		std::vector<T> out_real(rows * columns, 0);
+		std::vector<T> out_imag(real ? 0 : rows * columns, 0);
+
+		const std::size_t chunks = (rows + s_row_chunk - 1) / s_row_chunk;
+		std::atomic<bool> stopped = false;
+
+		ParallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t chunk = begin; chunk < end && !stopped; chunk++)
+			{
+				const std::size_t first = chunk * s_row_chunk;
+				const std::size_t last = std::min(first + s_row_chunk, rows);
+
+				// One node per element of the product
+				if (!Cancellation::Checkpoint((last - first) * columns))
+				{
+					stopped = true;
+					return;
+				}
+
+				MultiplyRows(a.data(), c.data(), out_real.data(), depth, columns, first, last);
+				if (real)
+					continue;
+				MultiplyRows(minus_b.data(), d.data(), out_real.data(), depth, columns, first, last);
+				MultiplyRows(a.data(), d.data(), out_imag.data(), depth, columns, first, last);
+				MultiplyRows(b.data(), c.data(), out_imag.data(), depth, columns, first, last);
+			}
+		});
+
+		if (stopped)
+			return false;
+
+		out = Matrix(rows, columns);
+		for (std::size_t i = 0; i < out.Size(); i++)
+			out.Data()[i] = complex(out_real[i], real ? 0 : out_imag[i]);
+		return true;
+	}
+
+	bool Linear::Multiply(const Matrix& lhs, const Matrix& rhs, Matrix& out)
+	{
+		if (lhs.Columns() != rhs.Rows())
+			return false;
+		if (FastMath::Enabled())
+			return MultiplyPlanes<double>(lhs, rhs, out);
+		return MultiplyPlanes<long double>(lhs, rhs, out);
+	}
+
+	Matrix Linear::Transpose(const Matrix& matrix)
+	{
+		Matrix result(matrix.Columns(), matrix.Rows());
+		for (std::size_t i = 0; i < matrix.Rows(); i++)
+			for (std::size_t j = 0; j < matrix.Columns(); j++)
+				result(j, i) = matrix(i, j);
+		return result;
+	}
+
+	// In place LU decomposition of a row major n by n matrix with partial pivoting. Row i of the factors is
+	// row 'pivots[i]' of the input. Returns false if the matrix is singular or the evaluation was stopped,
+	// 'singular' tells them apart.
+	template<typename T>
+	static bool Factorize(std::vector<T>& lu, std::size_t n, std::vector<std::size_t>& pivots, bool& odd, bool& singular)
+	{
+		pivots.resize(n);
+		for (std::size_t i = 0; i < n; i++)
+			pivots[i] = i;
+		odd = false;
+		singular = false;
+
+		for (std::size_t k = 0; k < n; k++)
+		{
+			if (!Cancellation::Checkpoint((n - k) * (n - k) / n + 1))
+				return false;
+
+			std::size_t pivot = k;
+			for (std::size_t i = k + 1; i < n; i++)
+				if (std::abs(lu[i * n + k]) > std::abs(lu[pivot * n + k]))
+					pivot = i;
+
+			if (lu[pivot * n + k] == T(0))
+			{
+				singular = true;
+				return false;
+			}
+
+			if (pivot != k)
+			{
+				std::swap_ranges(lu.begin() + k * n, lu.begin() + (k + 1) * n, lu.begin() + pivot * n);
+				std::swap(pivots[k], pivots[pivot]);
+				odd = !odd;
+			}
+
+			const T* __restrict row_k = lu.data() + k * n;
+			const T inverse = T(1) / row_k[k];
+
+			ParallelFor(n - k - 1, s_elimination_chunk, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = k + 1 + begin; i < k + 1 + end; i++)
+				{
+					T* __restrict row_i = lu.data() + i * n;
+					const T factor = row_i[k] * inverse;
+					row_i[k] = factor;
+					for (std::size_t j = k + 1; j < n; j++)
+						row_i[j] -= factor * row_k[j];
+				}
+			});
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	static std::vector<T> Elements(const Matrix& matrix)
+	{
+		std::vector<T> result(matrix.Size());
+		for (std::size_t i = 0; i < result.size(); i++)
+		{
+			if constexpr (std::is_same_v<T, complex>)
+				result[i] = matrix.Data()[i];
+			else
+				result[i] = matrix.Data()[i].real();
+		}
+		return result;
+	}
+
+	template<typename T>
+	static bool Invert(const Matrix& matrix, Matrix& out)
+	{
+		const std::size_t n = matrix.Rows();
+
+		std::vector<T> lu = Elements<T>(matrix);
+		std::vector<std::size_t> pivots;
+		bool odd, singular;
+		if (!Factorize(lu, n, pivots, odd, singular))
+			return false;
+
+		// Solves L U X = P I with whole rows of X at a time
+		std::vector<T> x(n * n, T(0));
+		for (std::size_t i = 0; i < n; i++)
+			x[i * n + pivots[i]] = T(1);
+
+		for (std::size_t i = 0; i < n; i++)
+		{
+			if (!Cancellation::Checkpoint(i + 1))
+				return false;
+
+			T* __restrict row_i = x.data() + i * n;
+			for (std::size_t k = 0; k < i; k++)
+			{
+				const T factor = lu[i * n + k];
+				const T* __restrict row_k = x.data() + k * n;
+				for (std::size_t j = 0; j < n; j++)
+					row_i[j] -= factor * row_k[j];
+			}
+		}
+
+		for (std::size_t i = n; i-- > 0;)
+		{
+			if (!Cancellation::Checkpoint(n - i))
+				return false;
+
+			T* __restrict row_i = x.data() + i * n;
+			for (std::size_t k = i + 1; k < n; k++)
+			{
+				const T factor = lu[i * n + k];
+				const T* __restrict row_k = x.data() + k * n;
+				for (std::size_t j = 0; j < n; j++)
+					row_i[j] -= factor * row_k[j];
+			}
+
+			const T inverse = T(1) / lu[i * n + i];
+			for (std::size_t j = 0; j < n; j++)
+				row_i[j] *= inverse;
+		}
+
+		out = Matrix(n, n);
+		for (std::size_t i = 0; i < x.size(); i++)
+			out.Data()[i] = x[i];
+		return true;
+	}
+
+	bool Linear::Inverse(const Matrix& matrix, Matrix& out)
+	{
+		if (!matrix.IsSquare())
+			return false;
+		if (matrix.IsReal())
+			return Invert<value_type>(matrix, out);
+		return Invert<complex>(matrix, out);
+	}
+
+	template<typename T>
+	static bool Determinant(const Matrix& matrix, complex& out)
+	{
+		const std::size_t n = matrix.Rows();
+
+		std::vector<T> lu = Elements<T>(matrix);
+		std::vector<std::size_t> pivots;
+		bool odd, singular;
+		if (!Factorize(lu, n, pivots, odd, singular))
+		{
+			out = 0;
+			return singular;
+		}
+
+		T product = odd ? T(-1) : T(1);
+		for (std::size_t i = 0; i < n; i++)
+			product *= lu[i * n + i];
+		out = product;
+		return true;
+	}
+
+	bool Linear::Determinant(const Matrix& matrix, complex& out)
+	{
+		if (!matrix.IsSquare())
+			return false;
+		if (matrix.IsReal())
+			return bcalc::Determinant<value_type>(matrix, out);
+		return bcalc::Determinant<complex>(matrix, out);
+	}
+
+	// Indices of the elements shown out of 'count', 'count' stands for the elided ones in the middle
+	static std::vector<std::size_t> ShownIndices(std::size_t count)
+	{
+		std::vector<std::size_t> indices;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			if (count > 2 * s_shown_edge + 1 && i == s_shown_edge)
+			{
+				indices.push_back(count);
+				i = count - s_shown_edge - 1;
+				continue;
+			}
+			indices.push_back(i);
+		}
+		return indices;
+	}
+
+	std::string Linear::ToString(const Value& value)
+	{
+		if (!value.is_matrix)
+			return complex_to_string(value.scalar);
+
+		const Matrix& matrix = value.matrix;
+
+		auto row_string = [&](std::size_t row, bool vector)
+		{
+			std::string result = "[";
+			for (std::size_t column : ShownIndices(vector ? matrix.Rows() : matrix.Columns()))
+			{
+				if (result.size() > 1)
+					result += ", ";
+				if (column == (vector ? matrix.Rows() : matrix.Columns()))
+					result += "...";
+				else
+					result += complex_to_string(vector ? matrix(column, 0) : matrix(row, column));
+			}
+			return result + "]";
+		};
+
+		std::string result;
+		if (matrix.IsVector())
+			result = row_string(0, true);
+		else
+		{
+			result = "[";
+			for (std::size_t row : ShownIndices(matrix.Rows()))
+			{
+				if (result.size() > 1)
+					result += ", ";
+				result += row == matrix.Rows() ? "..." : row_string(row, false);
+			}
+			result += "]";
+		}
+
+		if (matrix.Rows() > 2 * s_shown_edge + 1 || matrix.Columns() > 2 * s_shown_edge + 1)
+			result += " (" + std::to_string(matrix.Rows()) + "x" + std::to_string(matrix.Columns()) + ")";
+		return result;
+	}
+
+}
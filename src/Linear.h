@@ -0,0 +1,78 @@
+#pragma once
+
+#include "TokenNode.h"
+
+#include <string>
+#include <vector>
+
+namespace bcalc::Linear
+{
+
+	// Dense row major matrix of complex values. Vectors are matrices with one column.
+	class Matrix
+	{
+	public:
+		Matrix() = default;
+		Matrix(std::size_t rows, std::size_t columns, std::complex<value_type> fill = 0)
+			: m_rows(rows)
+			, m_columns(columns)
+			, m_values(rows * columns, fill)
+		{}
+
+		std::size_t Rows()		const { return m_rows; }
+		std::size_t Columns()	const { return m_columns; }
+		std::size_t Size()		const { return m_values.size(); }
+
+		bool IsVector()			const { return m_columns == 1; }
+		bool IsSquare()			const { return m_rows == m_columns; }
+
+		std::complex<value_type>& operator()(std::size_t row, std::size_t column)				{ return m_values[row * m_columns + column]; }
+		const std::complex<value_type>& operator()(std::size_t row, std::size_t column) const	{ return m_values[row * m_columns + column]; }
+
+		std::complex<value_type>* Data()				{ return m_values.data(); }
+		const std::complex<value_type>* Data() const	{ return m_values.data(); }
+
+		// True if no element has an imaginary part, real matrices take faster paths
+		bool IsReal() const;
+
+	private:
+		std::size_t								m_rows		= 0;
+		std::size_t								m_columns	= 0;
+		std::vector<std::complex<value_type>>	m_values;
+	};
+
+	using MatrixList = std::unordered_map<std::string, Matrix>;
+
+	// Result of evaluating an expression that may involve matrices
+	struct Value
+	{
+		bool						is_matrix	= false;
+		std::complex<value_type>	scalar		= 0;
+		Matrix						matrix;
+	};
+
+	// 'lhs.Columns()' has to equal 'rhs.Rows()'. Cache blocked and split across threads, real operands
+	// multiply in fewer passes. In fast math mode (FastMath.h) the products are computed in double with
+	// the widest vectors of the running CPU. Fails on mismatched shapes or when cancelled.
+	bool Multiply(const Matrix& lhs, const Matrix& rhs, Matrix& out);
+	Matrix Transpose(const Matrix& matrix);
+
+	// LU decomposition with partial pivoting, 'matrix' has to be square. Inverse fails for singular matrices,
+	// the determinant of a singular matrix is 0.
+	bool Inverse(const Matrix& matrix, Matrix& out);
+	bool Determinant(const Matrix& matrix, std::complex<value_type>& out);
+
+	// Returns true if 'root' reads matrix variables, contains vector literals or calls a builtin with a vector
+	// result ('matrix()', 'mc_mean()', 'roots()', 'grad()' and 'solve()' of several values), directly or through
+	// the user functions it calls. Other expressions don't need 'Evaluate()' and are left to the scalar engines.
+	bool UsesMatrices(const TokenNode* root, const MatrixList& matrices, const FunctionList& functions);
+
+	// Evaluates 'root' with matrix values. Arithmetic operators, comparisons and builtins on values apply
+	// elementwise, broadcasting scalars and dimensions of size 1. 'if' with a matrix condition selects
+	// elementwise. User functions are evaluated from their trees.
+	bool Evaluate(const TokenNode* root, const VariableList& variables, const MatrixList& matrices, const FunctionList& functions, Value& out);
+
+	// '[1, 2]' for vectors, '[[1, 2], [3, 4]]' for matrices. Large matrices are elided in the middle.
+	std::string ToString(const Value& value);
+
+}
@@ -0,0 +1,743 @@
+#include "Linear.h"
+
+#include "Batch.h"
+#include "Differentiate.h"
+#include "FastMath.h"
+#include "Parallel.h"
+#include "Random.h"
+#include "Solve.h"
+#include "Statistics.h"
+
+#include <atomic>
+#include <cmath>
+
+namespace bcalc::Linear
+{
+
+	using complex = std::complex<value_type>;
+
+	// Recursion of user functions deeper than this is treated as runaway
+	static constexpr std::size_t s_max_depth = 1 << 12;
+
+	// Elements computed by one thread of an elementwise operation, also the number counted per checkpoint
+	static constexpr std::size_t s_element_chunk = 4096;
+
+	// Elements of 'matrix()' computed by one thread
+	static constexpr std::size_t s_matrix_chunk = 64;
+
+	// 'matrix()' refuses to build more elements than this
+	static constexpr std::size_t s_max_elements = std::size_t(1) << 26;
+
+	// Samples of 'mc_mean()' summarized together, their summaries are merged in order so the result doesn't
+	// depend on the number of threads
+	static constexpr std::size_t s_sample_chunk = 4096;
+	// Chunks in flight at once, bounds the memory of their summaries
+	static constexpr std::size_t s_sample_round = 1024;
+
+	// 'mc_mean()' refuses to take more samples than this
+	static constexpr value_type s_max_samples = value_type(uint64_t(1) << 48);
+
+	using Locals = std::unordered_map<std::string, Value>;
+
+	struct Context
+	{
+		const VariableList&	variables;
+		const MatrixList&	matrices;
+		const FunctionList&	functions;
+	};
+
+	// Builtins whose result is a vector when called with 'arguments' arguments (including the function name)
+	static bool ReturnsVector(FunctionType function, std::size_t arguments)
+	{
+		switch (function)
+		{
+			case FunctionType::Matrix:
+			case FunctionType::McMean:
+				return true;
+			case FunctionType::Roots:
+				return true;
+			case FunctionType::Grad:
+			case FunctionType::Solve:
+				return arguments > 2;
+			default:
+				return false;
+		}
+	}
+
+	static bool UsesMatrices(const TokenNode* node, const MatrixList& matrices, const FunctionList& functions, std::unordered_set<const UserFunction*>& visited)
+	{
+		const Token& token = node->GetToken();
+
+		if (token.Type() == TokenType::LBracket)
+			return true;
+		if (token.Type() == TokenType::BuiltinFunction && ReturnsVector(token.GetBuiltinFunction(), node->GetNodes().size()))
+			return true;
+
+		if (token.Type() == TokenType::String)
+		{
+			if (matrices.contains(token.GetString()))
+				return true;
+
+			const UserFunction* function = FindFunction(functions, token.GetString(), node->GetNodes().size());
+			if (function && visited.insert(function).second && UsesMatrices(function->expression, matrices, functions, visited))
+				return true;
+		}
+
+		for (const TokenNode* child : node->GetNodes())
+			if (UsesMatrices(child, matrices, functions, visited))
+				return true;
+
+		return false;
+	}
+
+	bool UsesMatrices(const TokenNode* root, const MatrixList& matrices, const FunctionList& functions)
+	{
+		std::unordered_set<const UserFunction*> visited;
+		return UsesMatrices(root, matrices, functions, visited);
+	}
+
+	// Applies 'op' to the elements of 'inputs' broadcast to a common shape. Scalars and dimensions of size 1
+	// are repeated, other dimensions have to match.
+	template<typename F>
+	static bool Map(const std::vector<Value>& inputs, F&& op, Value& out)
+	{
+		std::size_t rows = 1;
+		std::size_t columns = 1;
+		bool any_matrix = false;
+
+		for (const Value& input : inputs)
+		{
+			if (!input.is_matrix)
+				continue;
+			any_matrix = true;
+
+			const std::size_t r = input.matrix.Rows();
+			const std::size_t c = input.matrix.Columns();
+			if ((r != 1 && rows != 1 && r != rows) || (c != 1 && columns != 1 && c != columns))
+				return false;
+			rows = std::max(rows, r);
+			columns = std::max(columns, c);
+		}
+
+		if (!any_matrix)
+		{
+			std::vector<complex> scalars(inputs.size());
+			for (std::size_t k = 0; k < inputs.size(); k++)
+				scalars[k] = inputs[k].scalar;
+
+			CalcResult result = op(scalars);
+			if (result.has_error)
+				return false;
+
+			out = { .scalar = result.value };
+			return true;
+		}
+
+		Matrix result(rows, columns);
+		std::atomic<bool> failed = false;
+
+		ParallelFor(result.Size(), s_element_chunk, [&](std::size_t begin, std::size_t end) {
+			std::vector<complex> scalars(inputs.size());
+			for (std::size_t chunk = begin; chunk < end && !failed; chunk += s_element_chunk)
+			{
+				const std::size_t chunk_end = std::min(chunk + s_element_chunk, end);
+				if (!Cancellation::Checkpoint(chunk_end - chunk))
+				{
+					failed = true;
+					return;
+				}
+
+				for (std::size_t index = chunk; index < chunk_end; index++)
+				{
+					const std::size_t i = index / columns;
+					const std::size_t j = index % columns;
+					for (std::size_t k = 0; k < inputs.size(); k++)
+					{
+						const Value& input = inputs[k];
+						if (!input.is_matrix)
+							scalars[k] = input.scalar;
+						else
+							scalars[k] = input.matrix(input.matrix.Rows() == 1 ? 0 : i, input.matrix.Columns() == 1 ? 0 : j);
+					}
+
+					CalcResult element = op(scalars);
+					if (element.has_error)
+					{
+						failed = true;
+						return;
+					}
+					result.Data()[index] = element.value;
+				}
+			}
+		});
+
+		if (failed)
+			return false;
+
+		out = { .is_matrix = true, .matrix = std::move(result) };
+		return true;
+	}
+
+	// Stacks evaluated list elements. Scalars make a vector, vectors or single row matrices of equal
+	// length make the rows of a matrix.
+	static bool BuildList(std::vector<Value>& elements, Value& out)
+	{
+		if (std::none_of(elements.begin(), elements.end(), [](const Value& element) { return element.is_matrix; }))
+		{
+			Matrix vector(elements.size(), 1);
+			for (std::size_t i = 0; i < elements.size(); i++)
+				vector(i, 0) = elements[i].scalar;
+			out = { .is_matrix = true, .matrix = std::move(vector) };
+			return true;
+		}
+
+		const std::size_t columns = elements.front().matrix.Size();
+		for (const Value& element : elements)
+		{
+			if (!element.is_matrix || element.matrix.Size() != columns)
+				return false;
+			if (!element.matrix.IsVector() && element.matrix.Rows() != 1)
+				return false;
+		}
+
+		Matrix matrix(elements.size(), columns);
+		for (std::size_t i = 0; i < elements.size(); i++)
+			std::copy_n(elements[i].matrix.Data(), columns, &matrix(i, 0));
+		out = { .is_matrix = true, .matrix = std::move(matrix) };
+		return true;
+	}
+
+	// Builtins whose matrix meaning is not elementwise. Returns false for an error, 'handled' is cleared
+	// when 'function' should be applied elementwise instead.
+	static bool ApplyLinear(FunctionType function, std::vector<Value>& inputs, Value& out, bool& handled)
+	{
+		handled = true;
+
+		switch (function)
+		{
+			case FunctionType::Dot:
+			{
+				if (inputs.size() != 2 || !inputs[0].is_matrix || !inputs[1].is_matrix)
+					break;
+				const Matrix& lhs = inputs[0].matrix;
+				const Matrix& rhs = inputs[1].matrix;
+				if (lhs.Rows() != rhs.Rows() || lhs.Columns() != rhs.Columns())
+					return false;
+
+				complex sum = 0;
+				for (std::size_t i = 0; i < lhs.Size(); i++)
+					sum += lhs.Data()[i] * rhs.Data()[i];
+				out = { .scalar = sum };
+				return Cancellation::Checkpoint(lhs.Size());
+			}
+			case FunctionType::Cross:
+			{
+				if (inputs.size() != 2 || !inputs[0].is_matrix || !inputs[1].is_matrix)
+					return false;
+				const Matrix& a = inputs[0].matrix;
+				const Matrix& b = inputs[1].matrix;
+				if (!a.IsVector() || !b.IsVector() || a.Rows() != 3 || b.Rows() != 3)
+					return false;
+
+				Matrix result(3, 1);
+				result(0, 0) = a(1, 0) * b(2, 0) - a(2, 0) * b(1, 0);
+				result(1, 0) = a(2, 0) * b(0, 0) - a(0, 0) * b(2, 0);
+				result(2, 0) = a(0, 0) * b(1, 0) - a(1, 0) * b(0, 0);
+				out = { .is_matrix = true, .matrix = std::move(result) };
+				return true;
+			}
+			case FunctionType::MatMul:
+			{
+				// Scalar operands scale elementwise
+				if (inputs.size() != 2 || !inputs[0].is_matrix || !inputs[1].is_matrix)
+					break;
+				out = { .is_matrix = true };
+				return Multiply(inputs[0].matrix, inputs[1].matrix, out.matrix);
+			}
+			case FunctionType::Transpose:
+			{
+				if (inputs.size() != 1 || !inputs[0].is_matrix)
+					break;
+				out = { .is_matrix = true, .matrix = Transpose(inputs[0].matrix) };
+				return true;
+			}
+			case FunctionType::Inverse:
+			{
+				if (inputs.size() != 1 || !inputs[0].is_matrix)
+					break;
+				out = { .is_matrix = true };
+				return Inverse(inputs[0].matrix, out.matrix);
+			}
+			case FunctionType::Det:
+			{
+				if (inputs.size() != 1 || !inputs[0].is_matrix)
+					break;
+				out = {};
+				return Determinant(inputs[0].matrix, out.scalar);
+			}
+			default:
+				break;
+		}
+
+		handled = false;
+		return true;
+	}
+
+	static bool EvaluateNode(const TokenNode* node, const Locals& locals, const Context& context, std::size_t depth, Value& out);
+
+	// matrix(f, rows[, columns]): elements f(i, j) with indices starting from 1, one count builds the vector f(i)
+	static bool BuildMatrix(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if ((nodes.size() != 2 && nodes.size() != 3) || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return false;
+
+		std::size_t counts[2] = { 1, 1 };
+		for (std::size_t i = 1; i < nodes.size(); i++)
+		{
+			Value count;
+			if (!EvaluateNode(nodes[i], locals, context, depth, count) || count.is_matrix)
+				return false;
+
+			const value_type value = count.scalar.real();
+			if (count.scalar.imag() != 0 || value != std::round(value) || value < 1 || value > s_max_elements)
+				return false;
+			counts[i - 1] = static_cast<std::size_t>(value);
+		}
+
+		const std::size_t rows = counts[0];
+		const std::size_t columns = counts[1];
+		if (rows * columns > s_max_elements)
+			return false;
+
+		const std::size_t parameter_count = nodes.size() - 1;
+		const UserFunction* function = FindFunction(context.functions, nodes[0]->GetToken().GetString(), parameter_count);
+		if (!function || depth >= s_max_depth)
+			return false;
+
+		Matrix result(rows, columns);
+
+		// Functions of scalars run through their compiled code on all threads
+		if (!UsesMatrices(function->expression, context.matrices, context.functions))
+		{
+			std::atomic<bool> failed = false;
+			ParallelFor(result.Size(), s_matrix_chunk, [&](std::size_t begin, std::size_t end) {
+				std::vector<complex> arguments(parameter_count);
+				for (std::size_t index = begin; index < end && !failed; index++)
+				{
+					arguments[0] = static_cast<value_type>(index / columns + 1);
+					if (parameter_count == 2)
+						arguments[1] = static_cast<value_type>(index % columns + 1);
+
+					CalcResult element = Invoke(*function, arguments, context.variables, context.functions);
+					if (element.has_error)
+					{
+						failed = true;
+						return;
+					}
+					result.Data()[index] = element.value;
+				}
+			});
+
+			if (failed)
+				return false;
+
+			out = { .is_matrix = true, .matrix = std::move(result) };
+			return true;
+		}
+
+		Locals parameters;
+		for (std::size_t index = 0; index < result.Size(); index++)
+		{
+			parameters[function->parameters[0]] = { .scalar = static_cast<value_type>(index / columns + 1) };
+			if (parameter_count == 2)
+				parameters[function->parameters[1]] = { .scalar = static_cast<value_type>(index % columns + 1) };
+
+			Value element;
+			if (!EvaluateNode(function->expression, parameters, context, depth + 1, element) || element.is_matrix)
+				return false;
+			result.Data()[index] = element.scalar;
+		}
+
+		out = { .is_matrix = true, .matrix = std::move(result) };
+		return true;
+	}
+
+	// Values of the arguments of a higher order builtin after the function name, all of them scalars
+	static bool ScalarArguments(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, std::vector<complex>& out)
+	{
+		out.resize(nodes.size() - 1);
+		for (std::size_t i = 1; i < nodes.size(); i++)
+		{
+			Value value;
+			if (!EvaluateNode(nodes[i], locals, context, depth, value) || value.is_matrix)
+				return false;
+			out[i - 1] = value.scalar;
+		}
+		return true;
+	}
+
+	// Column vector of 'values', a single value is a scalar
+	static void VectorValue(const std::vector<complex>& values, Value& out)
+	{
+		if (values.size() == 1)
+		{
+			out = { .scalar = values[0] };
+			return;
+		}
+
+		Matrix result(values.size(), 1);
+		std::copy(values.begin(), values.end(), result.Data());
+		out = { .is_matrix = true, .matrix = std::move(result) };
+	}
+
+	// grad(f, x1, ..., xn): the gradient of f at the point, all components from one reverse mode sweep
+	static bool Gradient(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if (nodes.size() < 2 || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return false;
+
+		std::vector<complex> point;
+		if (!ScalarArguments(nodes, locals, context, depth, point))
+			return false;
+
+		const UserFunction* function = FindFunction(context.functions, nodes[0]->GetToken().GetString(), point.size());
+		if (!function)
+			return false;
+
+		auto gradient = Differentiate::Reverse(*function, point, context.variables, context.functions);
+		if (gradient.empty())
+			return false;
+
+		VectorValue(gradient, out);
+		return true;
+	}
+
+	// solve(f, x0, ..., xn): the root Newton's method converges to from every starting point, NaN where it
+	// doesn't. Fails if no starting point converges.
+	static bool SolveAll(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if (nodes.size() < 2 || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return false;
+
+		std::vector<complex> starts;
+		if (!ScalarArguments(nodes, locals, context, depth, starts))
+			return false;
+
+		const UserFunction* function = FindFunction(context.functions, nodes[0]->GetToken().GetString(), 1);
+		if (!function)
+			return false;
+
+		bool converged = false;
+		std::vector<complex> roots;
+		for (const CalcResult& result : Solve::NewtonBatch(*function, starts, context.variables, context.functions))
+		{
+			converged |= !result.has_error;
+			roots.push_back(result.has_error ? complex(std::numeric_limits<value_type>::quiet_NaN()) : result.value);
+		}
+		if (!converged || Cancellation::Stopped())
+			return false;
+
+		VectorValue(roots, out);
+		return true;
+	}
+
+	// roots(f, a, b[, n]): every real root found in [a, b] in ascending order, fails if there is none
+	static bool AllRoots(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if ((nodes.size() != 3 && nodes.size() != 4) || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return false;
+
+		std::vector<complex> inputs;
+		if (!ScalarArguments(nodes, locals, context, depth, inputs))
+			return false;
+
+		std::size_t intervals = 100;
+		if (inputs.size() == 3)
+		{
+			if (inputs[2].real() < 1)
+				return false;
+			intervals = static_cast<std::size_t>(inputs[2].real());
+		}
+
+		const UserFunction* function = FindFunction(context.functions, nodes[0]->GetToken().GetString(), 1);
+		if (!function)
+			return false;
+
+		auto roots = Solve::Roots(*function, inputs[0].real(), inputs[1].real(), intervals, context.variables, context.functions);
+		if (roots.empty() || Cancellation::Stopped())
+			return false;
+
+		VectorValue({ roots.begin(), roots.end() }, out);
+		return true;
+	}
+
+	// Evaluates sample 'index' of 'run' into 'out', the parameters getting the first uniform draws of its stream
+	static bool Sample(const UserFunction& function, uint64_t run, uint64_t index, std::vector<complex>& arguments, const VariableList& variables, const FunctionList& functions, value_type& out)
+	{
+		Random::Stream stream(run, index);
+		for (complex& argument : arguments)
+			argument = Random::Uniform();
+
+		CalcResult result = Invoke(function, arguments, variables, functions);
+		if (result.has_error || result.value.imag() != 0 || !std::isfinite(result.value.real()))
+			return false;
+		out = result.value.real();
+		return true;
+	}
+
+	// mc_mean(f, n): the vector [mean, standard error] of f over n >= 2 samples. The parameters of f get independent
+	// uniform numbers in [0, 1) and f may draw more. Sample i uses stream i of a new run on whichever thread
+	// evaluates it. Fails if any sample has no finite real result. Overloaded f is sampled with its fewest
+	// parameters.
+	static bool SampleMean(const std::vector<TokenNode*>& nodes, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if (nodes.size() != 2 || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return false;
+
+		Value count;
+		if (!EvaluateNode(nodes[1], locals, context, depth, count) || count.is_matrix)
+			return false;
+		const value_type value = count.scalar.real();
+		if (count.scalar.imag() != 0 || value != std::round(value) || value < 2 || value > s_max_samples)
+			return false;
+		const uint64_t samples = static_cast<uint64_t>(value);
+
+		auto it = context.functions.find(nodes[0]->GetToken().GetString());
+		if (it == context.functions.end() || it->second.empty())
+			return false;
+		const UserFunction* function = nullptr;
+		for (const auto& [_, overload] : it->second)
+			if (!function || overload.parameters.size() < function->parameters.size())
+				function = &overload;
+
+		if (UsesMatrices(function->expression, context.matrices, context.functions))
+			return false;
+		const VariableList& variables = context.variables;
+
+		// Functions that don't draw themselves are evaluated a chunk at a time in fast math mode
+		Batch* batch = FastMath::Enabled() ? Batch::Compile(*function, variables, context.functions) : nullptr;
+
+		const std::size_t arity = function->parameters.size();
+		const uint64_t run = Random::NewRun();
+		const uint64_t chunks = (samples + s_sample_chunk - 1) / s_sample_chunk;
+
+		Statistics::Moments total;
+		std::vector<Statistics::Moments> partials;
+		std::atomic<bool> failed = false;
+
+		for (uint64_t first = 0; first < chunks && !failed; first += s_sample_round)
+		{
+			partials.assign(std::min<uint64_t>(s_sample_round, chunks - first), {});
+			ParallelFor(partials.size(), 1, [&](std::size_t begin, std::size_t end) {
+				std::vector<complex> arguments(arity);
+				std::vector<std::vector<double>> columns(batch ? arity : 0, std::vector<double>(s_sample_chunk));
+				std::vector<const double*> inputs(columns.size());
+				std::vector<double> results(batch ? s_sample_chunk : 0);
+
+				for (std::size_t chunk = begin; chunk < end && !failed; chunk++)
+				{
+					const uint64_t start = (first + chunk) * s_sample_chunk;
+					const uint64_t size = std::min<uint64_t>(s_sample_chunk, samples - start);
+					Statistics::Moments& moments = partials[chunk];
+
+					if (batch)
+					{
+						for (uint64_t i = 0; i < size; i++)
+						{
+							Random::Stream stream(run, start + i);
+							for (std::size_t j = 0; j < arity; j++)
+								columns[j][i] = static_cast<double>(Random::Uniform());
+						}
+						for (std::size_t j = 0; j < arity; j++)
+							inputs[j] = columns[j].data();
+						if (!batch->Evaluate(inputs.data(), results.data(), size))
+						{
+							failed = true;
+							return;
+						}
+					}
+
+					for (uint64_t i = 0; i < size; i++)
+					{
+						value_type result;
+						if (batch && !std::isnan(results[i]))
+							result = results[i];
+						else if (!Sample(*function, run, start + i, arguments, variables, context.functions, result))
+						{
+							failed = true;
+							return;
+						}
+						moments.Add(result);
+					}
+				}
+			});
+
+			for (const Statistics::Moments& partial : partials)
+				total.Merge(partial);
+		}
+
+		delete batch;
+
+		if (failed || Cancellation::Stopped())
+			return false;
+
+		Matrix result(2, 1);
+		result.Data()[0] = total.mean;
+		result.Data()[1] = std::sqrt(total.Variance() / static_cast<value_type>(total.count));
+		out = { .is_matrix = true, .matrix = std::move(result) };
+		return true;
+	}
+
+	static bool EvaluateNode(const TokenNode* node, const Locals& locals, const Context& context, std::size_t depth, Value& out)
+	{
+		if (!Cancellation::Checkpoint())
+			return false;
+
+		const Token& token = node->GetToken();
+		const auto& nodes = node->GetNodes();
+
+		switch (token.Type())
+		{
+			case TokenType::Value:
+				out = { .scalar = token.GetValue() };
+				return true;
+
+			case TokenType::Constant:
+				out = { .scalar = EvaluateConstant(token.GetConstant()) };
+				return true;
+
+			case TokenType::LBracket:
+			{
+				std::vector<Value> elements(nodes.size());
+				for (std::size_t i = 0; i < nodes.size(); i++)
+					if (!EvaluateNode(nodes[i], locals, context, depth, elements[i]))
+						return false;
+				return !elements.empty() && BuildList(elements, out);
+			}
+
+			case TokenType::String:
+			{
+				const std::string name = token.GetString();
+
+				if (auto it = locals.find(name); it != locals.end())
+				{
+					out = it->second;
+					return true;
+				}
+
+				if (auto it = context.matrices.find(name); it != context.matrices.end())
+				{
+					out = { .is_matrix = true, .matrix = it->second };
+					return true;
+				}
+
+				if (auto it = context.variables.find(name); it != context.variables.end())
+				{
+					out = { .scalar = it->second };
+					return true;
+				}
+
+				const UserFunction* function = FindFunction(context.functions, name, nodes.size());
+				if (!function || depth >= s_max_depth)
+					return false;
+
+				// Callees see their own parameters and globals, not the locals of the caller
+				Locals parameters;
+				for (std::size_t i = 0; i < nodes.size(); i++)
+				{
+					Value input;
+					if (!EvaluateNode(nodes[i], locals, context, depth, input))
+						return false;
+					parameters[function->parameters[i]] = std::move(input);
+				}
+
+				return EvaluateNode(function->expression, parameters, context, depth + 1, out);
+			}
+
+			case TokenType::BuiltinFunction:
+			{
+				FunctionType function = token.GetBuiltinFunction();
+
+				if (function == FunctionType::Matrix)
+					return BuildMatrix(nodes, locals, context, depth, out);
+				if (function == FunctionType::McMean)
+					return SampleMean(nodes, locals, context, depth, out);
+				if (function == FunctionType::Grad)
+					return Gradient(nodes, locals, context, depth, out);
+				if (function == FunctionType::Solve)
+					return SolveAll(nodes, locals, context, depth, out);
+				if (function == FunctionType::Roots)
+					return AllRoots(nodes, locals, context, depth, out);
+
+				// Other higher order builtins only take scalars and are left to the scalar engine
+				if (IsHigherOrder(function))
+				{
+					std::vector<complex> inputs;
+					if (nodes.empty() || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty() || !ScalarArguments(nodes, locals, context, depth, inputs))
+						return false;
+
+					CalcResult result = ApplyHigherOrder(function, nodes[0]->GetToken().GetString(), inputs, context.variables, context.functions);
+					if (result.has_error)
+						return false;
+
+					out = { .scalar = result.value };
+					return true;
+				}
+
+				if (function == FunctionType::If)
+				{
+					if (nodes.size() != 3)
+						return false;
+
+					Value condition;
+					if (!EvaluateNode(nodes[0], locals, context, depth, condition))
+						return false;
+					if (!condition.is_matrix)
+						return EvaluateNode(nodes[condition.scalar != complex(0) ? 1 : 2], locals, context, depth, out);
+
+					// Matrix conditions select elementwise from both branches
+					std::vector<Value> inputs(3);
+					inputs[0] = std::move(condition);
+					if (!EvaluateNode(nodes[1], locals, context, depth, inputs[1]) || !EvaluateNode(nodes[2], locals, context, depth, inputs[2]))
+						return false;
+
+					return Map(inputs, [](const std::vector<complex>& scalars) {
+						return CalcResult { .value = scalars[0] != complex(0) ? scalars[1] : scalars[2] };
+					}, out);
+				}
+
+				std::vector<Value> inputs(nodes.size());
+				for (std::size_t i = 0; i < nodes.size(); i++)
+					if (!EvaluateNode(nodes[i], locals, context, depth, inputs[i]))
+						return false;
+
+				bool handled;
+				if (!ApplyLinear(function, inputs, out, handled))
+					return false;
+				if (handled)
+					return true;
+
+				return Map(inputs, [function](const std::vector<complex>& scalars) { return ApplyFunction(function, scalars); }, out);
+			}
+
+			default:
+				break;
+		}
+
+		if (nodes.size() != 2)
+			return false;
+
+		std::vector<Value> inputs(2);
+		if (!EvaluateNode(nodes[0], locals, context, depth, inputs[0]) || !EvaluateNode(nodes[1], locals, context, depth, inputs[1]))
+			return false;
+
+		const TokenType type = token.Type();
+		return Map(inputs, [type](const std::vector<complex>& scalars) { return ApplyOperator(type, scalars[0], scalars[1]); }, out);
+	}
+
+	bool Evaluate(const TokenNode* root, const VariableList& variables, const MatrixList& matrices, const FunctionList& functions, Value& out)
+	{
+		return EvaluateNode(root, {}, { variables, matrices, functions }, 0, out);
+	}
+
+}
@@ -0,0 +1,935 @@
+#include "Multiprecision.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bcalc::Multiprecision
+{
+
+	static thread_local std::size_t s_precision = 4;
+
+	// Operands with fewer limbs than this are multiplied with the quadratic algorithm
+	static constexpr std::size_t s_karatsuba_threshold = 32;
+	// Operands with at least this many limbs (both) are multiplied with a number theoretic transform
+	static constexpr std::size_t s_ntt_threshold = 1536;
+
+	std::size_t DigitsToLimbs(std::size_t digits)
+	{
+		// log2(10) bits per digit, two guard limbs
+		return static_cast<std::size_t>(std::ceil(digits * 3.3219280948873623 / 32.0)) + 2;
+	}
+
+	Precision::Precision(std::size_t limbs)
+		: m_previous(s_precision)
+	{
+		s_precision = std::max<std::size_t>(limbs, 2);
+	}
+
+	Precision::~Precision()
+	{
+		s_precision = m_previous;
+	}
+
+	std::size_t Precision::Current()
+	{
+		return s_precision;
+	}
+
+	// Limb vector arithmetic
+
+	using Limbs = std::vector<uint32_t>;
+
+	static void MultiplySchoolbook(const uint32_t* a, std::size_t na, const uint32_t* b, std::size_t nb, uint32_t* out)
+	{
+		std::fill(out, out + na + nb, 0);
+		for (std::size_t i = 0; i < na; i++)
+		{
+			uint64_t carry = 0;
+			for (std::size_t j = 0; j < nb; j++)
+			{
+				uint64_t t = static_cast<uint64_t>(a[i]) * b[j] + out[i + j] + carry;
+				out[i + j] = static_cast<uint32_t>(t);
+				carry = t >> 32;
+			}
+			out[i + nb] = static_cast<uint32_t>(carry);
+		}
+	}
+
+	static Limbs AddLimbs(const uint32_t* a, std::size_t na, const uint32_t* b, std::size_t nb)
+	{
+		if (na < nb)
+		{
+			std::swap(a, b);
+			std::swap(na, nb);
+		}
+
+		Limbs result(na + 1);
+		uint64_t carry = 0;
+		for (std::size_t i = 0; i < na; i++)
+		{
+			uint64_t t = static_cast<uint64_t>(a[i]) + (i < nb ? b[i] : 0) + carry;
+			result[i] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		result[na] = static_cast<uint32_t>(carry);
+		return result;
+	}
+
+	// 'out += value << (32 * offset)', 'out' must be large enough to hold the result
+	static void AddLimbsAt(Limbs& out, const Limbs& value, std::size_t offset)
+	{
+		uint64_t carry = 0;
+		std::size_t i = 0;
+		for (; i < value.size(); i++)
+		{
+			uint64_t t = static_cast<uint64_t>(out[offset + i]) + value[i] + carry;
+			out[offset + i] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		for (; carry && offset + i < out.size(); i++)
+		{
+			uint64_t t = static_cast<uint64_t>(out[offset + i]) + carry;
+			out[offset + i] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+	}
+
+	// 'out -= value', the result must not be negative
+	static void SubLimbs(Limbs& out, const Limbs& value)
+	{
+		int64_t borrow = 0;
+		std::size_t i = 0;
+		for (; i < value.size(); i++)
+		{
+			int64_t t = static_cast<int64_t>(out[i]) - value[i] - borrow;
+			borrow = t < 0;
+			out[i] = static_cast<uint32_t>(t + (borrow << 32));
+		}
+		for (; borrow && i < out.size(); i++)
+		{
+			int64_t t = static_cast<int64_t>(out[i]) - borrow;
+			borrow = t < 0;
+			out[i] = static_cast<uint32_t>(t + (borrow << 32));
+		}
+	}
+
+	// Number theoretic transform modulo the prime 2^64 - 2^32 + 1, which has roots of unity of every power
+	// of two order up to 2^32 and a cheap reduction. Operands are split into 16 bit digits so convolution
+	// terms can't reach the modulus.
+	namespace NTT
+	{
+
+		static constexpr uint64_t s_modulus = 0xFFFFFFFF00000001;
+		static constexpr uint64_t s_epsilon = 0xFFFFFFFF; // 2^64 mod s_modulus
+		static constexpr uint64_t s_generator = 7;
+
+		static uint64_t Reduce(unsigned __int128 x)
+		{
+			uint64_t lo = static_cast<uint64_t>(x);
+			uint64_t hi = static_cast<uint64_t>(x >> 64);
+
+			// 2^64 = 2^32 - 1 and 2^96 = -1
+			uint64_t t0 = lo - (hi >> 32);
+			if (lo < (hi >> 32))
+				t0 -= s_epsilon;
+			uint64_t t1 = (hi & 0xFFFFFFFF) * s_epsilon;
+			uint64_t t2 = t0 + t1;
+			if (t2 < t1)
+				t2 += s_epsilon;
+			return t2 >= s_modulus ? t2 - s_modulus : t2;
+		}
+
+		static uint64_t Mul(uint64_t a, uint64_t b)
+		{
+			return Reduce(static_cast<unsigned __int128>(a) * b);
+		}
+
+		static uint64_t Add(uint64_t a, uint64_t b)
+		{
+			uint64_t r = a + b;
+			if (r < a)
+				return r + s_epsilon;
+			return r >= s_modulus ? r - s_modulus : r;
+		}
+
+		static uint64_t Sub(uint64_t a, uint64_t b)
+		{
+			return a >= b ? a - b : a + (s_modulus - b);
+		}
+
+		static uint64_t Pow(uint64_t base, uint64_t exponent)
+		{
+			uint64_t result = 1;
+			for (; exponent; exponent >>= 1)
+			{
+				if (exponent & 1)
+					result = Mul(result, base);
+				base = Mul(base, base);
+			}
+			return result;
+		}
+
+		static void Transform(std::vector<uint64_t>& data, bool inverse)
+		{
+			const std::size_t n = data.size();
+
+			for (std::size_t i = 1, j = 0; i < n; i++)
+			{
+				std::size_t bit = n >> 1;
+				for (; j & bit; bit >>= 1)
+					j ^= bit;
+				j ^= bit;
+				if (i < j)
+					std::swap(data[i], data[j]);
+			}
+
+			std::vector<uint64_t> twiddles(n / 2);
+			for (std::size_t length = 2; length <= n; length <<= 1)
+			{
+				uint64_t root = Pow(s_generator, (s_modulus - 1) / length);
+				if (inverse)
+					root = Pow(root, s_modulus - 2);
+
+				const std::size_t half = length / 2;
+				twiddles[0] = 1;
+				for (std::size_t k = 1; k < half; k++)
+					twiddles[k] = Mul(twiddles[k - 1], root);
+
+				for (std::size_t start = 0; start < n; start += length)
+				{
+					for (std::size_t k = 0; k < half; k++)
+					{
+						uint64_t u = data[start + k];
+						uint64_t v = Mul(data[start + k + half], twiddles[k]);
+						data[start + k] = Add(u, v);
+						data[start + k + half] = Sub(u, v);
+					}
+				}
+			}
+
+			if (inverse)
+			{
+				uint64_t scale = Pow(n, s_modulus - 2);
+				for (uint64_t& value : data)
+					value = Mul(value, scale);
+			}
+		}
+
+		static void Multiply(const uint32_t* a, std::size_t na, const uint32_t* b, std::size_t nb, uint32_t* out)
+		{
+			std::size_t n = 1;
+			while (n < 2 * (na + nb))
+				n <<= 1;
+
+			auto split = [n](const uint32_t* limbs, std::size_t count)
+			{
+				std::vector<uint64_t> digits(n, 0);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					digits[2 * i + 0] = limbs[i] & 0xFFFF;
+					digits[2 * i + 1] = limbs[i] >> 16;
+				}
+				return digits;
+			};
+
+			std::vector<uint64_t> fa = split(a, na);
+			std::vector<uint64_t> fb = split(b, nb);
+			Transform(fa, false);
+			Transform(fb, false);
+			for (std::size_t i = 0; i < n; i++)
+				fa[i] = Mul(fa[i], fb[i]);
+			Transform(fa, true);
+
+			unsigned __int128 carry = 0;
+			for (std::size_t i = 0; i < na + nb; i++)
+			{
+				unsigned __int128 lo = fa[2 * i + 0] + carry;
+				unsigned __int128 hi = fa[2 * i + 1] + (lo >> 16);
+				out[i] = static_cast<uint32_t>((lo & 0xFFFF) | ((hi & 0xFFFF) << 16));
+				carry = hi >> 16;
+			}
+		}
+
+	}
+
+	static Limbs MultiplyLimbs(const uint32_t* a, std::size_t na, const uint32_t* b, std::size_t nb)
+	{
+		if (na < nb)
+		{
+			std::swap(a, b);
+			std::swap(na, nb);
+		}
+
+		Limbs result(na + nb);
+
+		if (nb < s_karatsuba_threshold)
+		{
+			MultiplySchoolbook(a, na, b, nb, result.data());
+			return result;
+		}
+
+		if (nb >= s_ntt_threshold)
+		{
+			NTT::Multiply(a, na, b, nb, result.data());
+			return result;
+		}
+
+		// Unbalanced operands are multiplied in pieces of the shorter length
+		if (2 * nb <= na)
+		{
+			for (std::size_t offset = 0; offset < na; offset += nb)
+			{
+				std::size_t count = std::min(nb, na - offset);
+				AddLimbsAt(result, MultiplyLimbs(a + offset, count, b, nb), offset);
+			}
+			return result;
+		}
+
+		// Karatsuba: (a1 B + a0)(b1 B + b0) = z2 B^2 + ((a0 + a1)(b0 + b1) - z0 - z2) B + z0
+		const std::size_t m = na / 2;
+		Limbs z0 = MultiplyLimbs(a, m, b, m);
+		Limbs z2 = MultiplyLimbs(a + m, na - m, b + m, nb - m);
+
+		Limbs sa = AddLimbs(a, m, a + m, na - m);
+		Limbs sb = AddLimbs(b, m, b + m, nb - m);
+		Limbs z1 = MultiplyLimbs(sa.data(), sa.size(), sb.data(), sb.size());
+		SubLimbs(z1, z0);
+		SubLimbs(z1, z2);
+		while (!z1.empty() && z1.back() == 0)
+			z1.pop_back();
+
+		AddLimbsAt(result, z0, 0);
+		AddLimbsAt(result, z2, 2 * m);
+		AddLimbsAt(result, z1, m);
+		return result;
+	}
+
+	// Float
+
+	Float::Float(long double value)
+	{
+		// Callers reject non-finite values
+		if (value == 0 || !std::isfinite(value))
+			return;
+
+		int exponent;
+		long double fraction = std::frexp(std::fabs(value), &exponent);
+		uint64_t mantissa = static_cast<uint64_t>(std::ldexp(fraction, 64));
+
+		m_limbs = { static_cast<uint32_t>(mantissa), static_cast<uint32_t>(mantissa >> 32) };
+		*this = MulPow2(exponent - 64);
+		m_negative = value < 0;
+	}
+
+	void Float::Normalize()
+	{
+		std::size_t low = 0;
+		while (low < m_limbs.size() && m_limbs[low] == 0)
+			low++;
+		if (low == m_limbs.size())
+		{
+			*this = Float();
+			return;
+		}
+
+		std::size_t high = m_limbs.size();
+		while (m_limbs[high - 1] == 0)
+			high--;
+
+		if (high - low > s_precision)
+		{
+			// Rounds to nearest by the most significant dropped bit, halfway cases away from zero
+			low = high - s_precision;
+			if (m_limbs[low - 1] & 0x80000000)
+			{
+				std::size_t i = low;
+				while (i < high && ++m_limbs[i] == 0)
+					i++;
+				if (i == high)
+				{
+					if (high == m_limbs.size())
+						m_limbs.push_back(0);
+					m_limbs[high++] = 1;
+				}
+			}
+			while (m_limbs[low] == 0)
+				low++;
+		}
+
+		m_limbs.resize(high);
+		m_limbs.erase(m_limbs.begin(), m_limbs.begin() + low);
+		m_exponent += low;
+	}
+
+	Float Float::Truncated(std::size_t limbs) const
+	{
+		Float result = *this;
+		if (result.m_limbs.size() > limbs)
+		{
+			std::size_t drop = result.m_limbs.size() - limbs;
+			result.m_limbs.erase(result.m_limbs.begin(), result.m_limbs.begin() + drop);
+			result.m_exponent += drop;
+		}
+		return result;
+	}
+
+	bool Float::IsInteger() const
+	{
+		// Normalized numbers don't have zero limbs at the bottom
+		return m_exponent >= 0 || IsZero();
+	}
+
+	long double Float::ToLongDouble() const
+	{
+		if (IsZero())
+			return 0;
+
+		// Beyond this the result is zero or infinite anyway
+		const int64_t top = std::clamp<int64_t>(Top(), -1000, 1000);
+
+		long double result = 0;
+		for (std::size_t i = 0; i < std::min<std::size_t>(3, m_limbs.size()); i++)
+			result += std::ldexp(static_cast<long double>(m_limbs[m_limbs.size() - 1 - i]), static_cast<int>(32 * (top - 1 - static_cast<int64_t>(i))));
+		return m_negative ? -result : result;
+	}
+
+	Float Float::operator-() const
+	{
+		Float result = *this;
+		if (!result.IsZero())
+			result.m_negative = !result.m_negative;
+		return result;
+	}
+
+	Float Float::Abs() const
+	{
+		Float result = *this;
+		result.m_negative = false;
+		return result;
+	}
+
+	Float Float::MulPow2(int64_t bits) const
+	{
+		if (IsZero())
+			return Float();
+
+		int64_t limbs = bits >= 0 ? bits / 32 : -((-bits + 31) / 32);
+		int shift = static_cast<int>(bits - limbs * 32);
+
+		Float result;
+		result.m_negative = m_negative;
+		result.m_exponent = m_exponent + limbs;
+		result.m_limbs.resize(m_limbs.size() + 1);
+
+		uint32_t carry = 0;
+		for (std::size_t i = 0; i < m_limbs.size(); i++)
+		{
+			result.m_limbs[i] = (m_limbs[i] << shift) | carry;
+			carry = shift ? m_limbs[i] >> (32 - shift) : 0;
+		}
+		result.m_limbs.back() = carry;
+
+		result.Normalize();
+		return result;
+	}
+
+	Float Float::MulSmall(uint32_t value) const
+	{
+		Float result = *this;
+		result.m_limbs.push_back(0);
+
+		uint64_t carry = 0;
+		for (uint32_t& limb : result.m_limbs)
+		{
+			uint64_t t = static_cast<uint64_t>(limb) * value + carry;
+			limb = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+
+		result.Normalize();
+		return result;
+	}
+
+	Float Float::DivSmall(uint32_t value) const
+	{
+		if (IsZero())
+			return Float();
+
+		// Extend with zero limbs so the quotient keeps the full precision
+		std::size_t extra = m_limbs.size() < s_precision + 1 ? s_precision + 1 - m_limbs.size() : 0;
+
+		Float result;
+		result.m_negative = m_negative;
+		result.m_exponent = m_exponent - static_cast<int64_t>(extra);
+		result.m_limbs.resize(m_limbs.size() + extra);
+
+		uint64_t remainder = 0;
+		for (std::size_t i = result.m_limbs.size(); i-- > 0;)
+		{
+			uint64_t current = (remainder << 32) | (i >= extra ? m_limbs[i - extra] : 0);
+			result.m_limbs[i] = static_cast<uint32_t>(current / value);
+			remainder = current % value;
+		}
+
+		result.Normalize();
+		return result;
+	}
+
+	int Float::CompareMagnitudes(const Float& lhs, const Float& rhs)
+	{
+		if (lhs.IsZero() || rhs.IsZero())
+			return static_cast<int>(!lhs.IsZero()) - static_cast<int>(!rhs.IsZero());
+
+		if (lhs.Top() != rhs.Top())
+			return lhs.Top() < rhs.Top() ? -1 : 1;
+
+		auto limb = [](const Float& x, int64_t position) -> uint32_t
+		{
+			int64_t index = position - x.m_exponent;
+			return index >= 0 && index < static_cast<int64_t>(x.m_limbs.size()) ? x.m_limbs[index] : 0;
+		};
+
+		const int64_t low = std::min(lhs.m_exponent, rhs.m_exponent);
+		for (int64_t position = lhs.Top() - 1; position >= low; position--)
+		{
+			uint32_t a = limb(lhs, position);
+			uint32_t b = limb(rhs, position);
+			if (a != b)
+				return a < b ? -1 : 1;
+		}
+		return 0;
+	}
+
+	Float Float::AddMagnitudes(const Float& lhs, const Float& rhs)
+	{
+		if (lhs.IsZero())
+			return rhs.Abs();
+		if (rhs.IsZero())
+			return lhs.Abs();
+
+		// Limbs far below the precision of the result are dropped
+		const int64_t top = std::max(lhs.Top(), rhs.Top());
+		const int64_t low = std::max(std::min(lhs.m_exponent, rhs.m_exponent), top - static_cast<int64_t>(s_precision) - 1);
+
+		Float result;
+		result.m_exponent = low;
+		result.m_limbs.assign(top - low + 1, 0);
+
+		for (const Float* x : { &lhs, &rhs })
+		{
+			std::size_t j = x->m_exponent < low ? low - x->m_exponent : 0;
+			std::size_t i = x->m_exponent + j - low;
+			uint64_t carry = 0;
+			for (; j < x->m_limbs.size(); i++, j++)
+			{
+				uint64_t t = static_cast<uint64_t>(result.m_limbs[i]) + x->m_limbs[j] + carry;
+				result.m_limbs[i] = static_cast<uint32_t>(t);
+				carry = t >> 32;
+			}
+			for (; carry; i++)
+			{
+				uint64_t t = static_cast<uint64_t>(result.m_limbs[i]) + carry;
+				result.m_limbs[i] = static_cast<uint32_t>(t);
+				carry = t >> 32;
+			}
+		}
+
+		result.Normalize();
+		return result;
+	}
+
+	Float Float::SubMagnitudes(const Float& lhs, const Float& rhs)
+	{
+		// |lhs| >= |rhs|
+		if (rhs.IsZero())
+			return lhs.Abs();
+
+		const int64_t top = lhs.Top();
+		const int64_t low = std::max(std::min(lhs.m_exponent, rhs.m_exponent), top - static_cast<int64_t>(s_precision) - 1);
+
+		Float result;
+		result.m_exponent = low;
+		result.m_limbs.assign(top - low, 0);
+
+		for (std::size_t j = lhs.m_exponent < low ? low - lhs.m_exponent : 0; j < lhs.m_limbs.size(); j++)
+			result.m_limbs[lhs.m_exponent + j - low] = lhs.m_limbs[j];
+
+		// Truncating both operands at the same position keeps the difference non-negative
+		std::size_t j = rhs.m_exponent < low ? low - rhs.m_exponent : 0;
+		std::size_t i = rhs.m_exponent + j - low;
+		int64_t borrow = 0;
+		for (; j < rhs.m_limbs.size(); i++, j++)
+		{
+			int64_t t = static_cast<int64_t>(result.m_limbs[i]) - rhs.m_limbs[j] - borrow;
+			borrow = t < 0;
+			result.m_limbs[i] = static_cast<uint32_t>(t + (borrow << 32));
+		}
+		for (; borrow; i++)
+		{
+			int64_t t = static_cast<int64_t>(result.m_limbs[i]) - borrow;
+			borrow = t < 0;
+			result.m_limbs[i] = static_cast<uint32_t>(t + (borrow << 32));
+		}
+
+		result.Normalize();
+		return result;
+	}
+
+	Float operator+(const Float& lhs, const Float& rhs)
+	{
+		Float result;
+		bool negative;
+
+		if (lhs.m_negative == rhs.m_negative)
+		{
+			result = Float::AddMagnitudes(lhs, rhs);
+			negative = lhs.m_negative;
+		}
+		else
+		{
+			int comparison = Float::CompareMagnitudes(lhs, rhs);
+			if (comparison == 0)
+				return Float();
+			result = comparison > 0 ? Float::SubMagnitudes(lhs, rhs) : Float::SubMagnitudes(rhs, lhs);
+			negative = comparison > 0 ? lhs.m_negative : rhs.m_negative;
+		}
+
+		result.m_negative = negative && !result.IsZero();
+		return result;
+	}
+
+	Float operator-(const Float& lhs, const Float& rhs)
+	{
+		return lhs + -rhs;
+	}
+
+	Float operator*(const Float& lhs, const Float& rhs)
+	{
+		if (lhs.IsZero() || rhs.IsZero())
+			return Float();
+
+		// Limbs below the working precision don't contribute to the result
+		std::size_t skip_lhs = lhs.m_limbs.size() > s_precision ? lhs.m_limbs.size() - s_precision : 0;
+		std::size_t skip_rhs = rhs.m_limbs.size() > s_precision ? rhs.m_limbs.size() - s_precision : 0;
+
+		Float result;
+		result.m_negative = lhs.m_negative != rhs.m_negative;
+		result.m_exponent = lhs.m_exponent + rhs.m_exponent + static_cast<int64_t>(skip_lhs + skip_rhs);
+		result.m_limbs = MultiplyLimbs(
+			lhs.m_limbs.data() + skip_lhs, lhs.m_limbs.size() - skip_lhs,
+			rhs.m_limbs.data() + skip_rhs, rhs.m_limbs.size() - skip_rhs
+		);
+		result.Normalize();
+		return result;
+	}
+
+	// Approximates 'x = m * 2^(32 * exponent)' from its two most significant limbs
+	static long double LeadingLimbs(const std::vector<uint32_t>& limbs)
+	{
+		long double result = std::ldexp(static_cast<long double>(limbs.back()), 32);
+		if (limbs.size() > 1)
+			result += limbs[limbs.size() - 2];
+		return result;
+	}
+
+	Float Float::Reciprocal(const Float& x)
+	{
+		const std::size_t target = s_precision;
+
+		// Newton iteration 'y += y (1 - x y)' doubling the precision on every step
+		Float y = Float(1.0L / LeadingLimbs(x.m_limbs));
+		y.m_exponent -= x.Top() - 2;
+
+		const Float abs = x.Abs();
+		const Float one = Float(1);
+
+		std::size_t precision = 1;
+		for (bool last = false; !last;)
+		{
+			last = precision == target;
+			precision = std::min(2 * precision, target);
+
+			Precision guard(precision + 1);
+			Float error = one - abs.Truncated(precision + 1) * y;
+			y = y + y * error;
+		}
+
+		y.m_negative = x.m_negative;
+		y.Normalize();
+		return y;
+	}
+
+	Float operator/(const Float& lhs, const Float& rhs)
+	{
+		if (rhs.IsZero())
+			return Float();
+
+		Float result;
+		{
+			Precision guard(s_precision + 1);
+			result = lhs * Float::Reciprocal(rhs);
+		}
+		result.Normalize();
+		return result;
+	}
+
+	int Compare(const Float& lhs, const Float& rhs)
+	{
+		if (lhs.m_negative != rhs.m_negative)
+			return lhs.m_negative ? -1 : 1;
+		int comparison = Float::CompareMagnitudes(lhs, rhs);
+		return lhs.m_negative ? -comparison : comparison;
+	}
+
+	Float Sqrt(const Float& x)
+	{
+		if (x.IsZero() || x.m_negative)
+			return Float();
+
+		const std::size_t target = s_precision;
+
+		// 'x = m 2^(32 t)' with an even 't' so the square root of the scale is exact
+		int64_t t = x.Top() - 2;
+		long double m = LeadingLimbs(x.m_limbs);
+		if (t % 2 != 0)
+		{
+			m = std::ldexp(m, 32);
+			t--;
+		}
+
+		// Newton iteration for the inverse square root 'y += y (1 - x y^2) / 2'
+		Float y = Float(1.0L / std::sqrt(m));
+		y.m_exponent -= t / 2;
+
+		const Float one = Float(1);
+
+		std::size_t precision = 1;
+		for (bool last = false; !last;)
+		{
+			last = precision == target;
+			precision = std::min(2 * precision, target);
+
+			Precision guard(precision + 1);
+			Float error = one - x.Truncated(precision + 1) * (y * y);
+			y = y + (y * error).MulPow2(-1);
+		}
+
+		// sqrt(x) = x y, corrected once more with the residual
+		Float result;
+		{
+			Precision guard(target + 1);
+			result = x * y;
+			result = result + (y * (x - result * result)).MulPow2(-1);
+		}
+		result.Normalize();
+		return result;
+	}
+
+	Float Truncate(const Float& x)
+	{
+		if (x.m_exponent >= 0)
+			return x;
+		if (x.Top() <= 0)
+			return Float();
+
+		Float result;
+		result.m_negative = x.m_negative;
+		result.m_limbs.assign(x.m_limbs.begin() - x.m_exponent, x.m_limbs.end());
+		result.Normalize();
+		return result;
+	}
+
+	Float Floor(const Float& x)
+	{
+		Float result = Truncate(x);
+		if (x.m_negative && !(result == x))
+			result = result - Float(1);
+		return result;
+	}
+
+	Float Ceil(const Float& x)
+	{
+		return -Floor(-x);
+	}
+
+	Float Round(const Float& x)
+	{
+		// Halfway cases away from zero like 'std::round'. The fraction is exact, adding 0.5 first could round.
+		const Float abs = x.Abs();
+		Float result = Truncate(abs);
+		if (!(abs - result < Float(0.5L)))
+			result = result + Float(1);
+		return x.IsNegative() ? -result : result;
+	}
+
+	// Decimal conversion
+
+	static Float Pow10(uint64_t exponent)
+	{
+		Float result = Float(1);
+		Float base = Float(10);
+		for (; exponent; exponent >>= 1)
+		{
+			if (exponent & 1)
+				result = result * base;
+			if (exponent > 1)
+				base = base * base;
+		}
+		return result;
+	}
+
+	Float Float::FromDecimal(std::string_view text)
+	{
+		std::string digits;
+		int64_t exponent = 0;
+
+		std::size_t i = 0;
+		for (bool fraction = false; i < text.size(); i++)
+		{
+			if (text[i] == '.')
+			{
+				fraction = true;
+				continue;
+			}
+			if (!isdigit(text[i]))
+				break;
+			if (digits.empty() && text[i] == '0')
+			{
+				exponent -= fraction;
+				continue;
+			}
+			digits.push_back(text[i]);
+			exponent -= fraction;
+		}
+
+		if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+		{
+			bool negative = ++i < text.size() && text[i] == '-';
+			if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+				i++;
+
+			int64_t value = 0;
+			for (; i < text.size() && isdigit(text[i]); i++)
+				value = std::min<int64_t>(value * 10 + (text[i] - '0'), 1'000'000'000);
+			exponent += negative ? -value : value;
+		}
+
+		// Trailing zeros go to the exponent, so "3.0" is the integer 3 and needs no division
+		while (!digits.empty() && digits.back() == '0')
+		{
+			digits.pop_back();
+			exponent++;
+		}
+
+		// The integer of all digits is exact, scaling it rounds once to nearest with a guard limb. Results that
+		// are representable at the working precision, like "0.25" or "1e20", are exact.
+		Float mantissa;
+		{
+			Precision guard(std::max(s_precision, DigitsToLimbs(digits.size())));
+			for (std::size_t j = 0; j < digits.size(); j += 9)
+			{
+				const std::size_t count = std::min<std::size_t>(9, digits.size() - j);
+				uint32_t chunk = 0;
+				uint32_t scale = 1;
+				for (std::size_t k = 0; k < count; k++)
+				{
+					chunk = chunk * 10 + (digits[j + k] - '0');
+					scale *= 10;
+				}
+				mantissa = mantissa.MulSmall(scale) + Float(chunk);
+			}
+		}
+
+		Float result;
+		{
+			Precision guard(s_precision + 1);
+			if (exponent >= 0)
+				result = mantissa * Pow10(exponent);
+			else
+				result = mantissa / Pow10(-exponent);
+		}
+		result.Normalize();
+		return result;
+	}
+
+	std::string Float::ToDecimal(std::size_t digits) const
+	{
+		if (IsZero())
+			return "0";
+
+		Precision guard(std::max(s_precision, DigitsToLimbs(digits)) + 1);
+
+		// Scale into [1, 10) starting from an estimate of the decimal exponent
+		const long double log2 = 32.0L * (Top() - 1) + std::log2(static_cast<long double>(m_limbs.back()));
+		int64_t exponent = static_cast<int64_t>(std::floor(log2 * 0.30102999566398119521L));
+
+		Float x = Abs();
+		x = exponent >= 0 ? x / Pow10(exponent) : x * Pow10(-exponent);
+		while (!(x < Float(10)))
+		{
+			x = x.DivSmall(10);
+			exponent++;
+		}
+		while (x < Float(1))
+		{
+			x = x.MulSmall(10);
+			exponent--;
+		}
+
+		// One extra digit for rounding
+		std::string result;
+		for (std::size_t i = 0; i <= digits; i++)
+		{
+			uint32_t digit = 0;
+			if (!x.IsZero() && x.Top() == 1)
+			{
+				digit = x.m_limbs.back();
+				x.m_limbs.back() = 0;
+				x.Normalize();
+			}
+			result.push_back('0' + digit);
+			x = x.MulSmall(10);
+		}
+
+		bool round_up = result.back() >= '5';
+		result.pop_back();
+		for (std::size_t i = result.size(); round_up && i-- > 0;)
+		{
+			round_up = result[i] == '9';
+			result[i] = round_up ? '0' : result[i] + 1;
+		}
+		if (round_up)
+		{
+			result.insert(result.begin(), '1');
+			result.pop_back();
+			exponent++;
+		}
+
+		while (result.size() > 1 && result.back() == '0')
+			result.pop_back();
+
+		std::string text = m_negative ? "-" : "";
+		if (exponent >= -5 && exponent < static_cast<int64_t>(digits))
+		{
+			if (exponent < 0)
+				text += "0." + std::string(-exponent - 1, '0') + result;
+			else
+			{
+				if (result.size() <= static_cast<std::size_t>(exponent))
+					result.append(exponent + 1 - result.size(), '0');
+				text += result.substr(0, exponent + 1);
+				if (result.size() > static_cast<std::size_t>(exponent + 1))
+					text += "." + result.substr(exponent + 1);
+			}
+		}
+		else
+		{
+			text += result.substr(0, 1);
+			if (result.size() > 1)
+				text += "." + result.substr(1);
+			text += "e" + std::to_string(exponent);
+		}
+		return text;
+	}
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "TokenNode.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace bcalc::Multiprecision
+{
+
+	// Number of 32 bit limbs used for 'digits' significant decimal digits, including guard limbs
+	std::size_t DigitsToLimbs(std::size_t digits);
+
+	// Sets the working precision (in limbs) of the calling thread for the lifetime of the guard.
+	class Precision
+	{
+	public:
+		Precision(std::size_t limbs);
+		~Precision();
+
+		static std::size_t Current();
+
+	private:
+		std::size_t m_previous;
+	};
+
+	// Binary floating point number 'limbs * 2^(32 * exponent)' rounded to nearest at the working precision.
+	// There are no infinities or NaNs, operations that would produce them are rejected before they are made.
+	class Float
+	{
+	public:
+		Float() = default;
+		Float(long double value);
+
+		// Parses a decimal literal like "12.5e-3"
+		static Float FromDecimal(std::string_view text);
+		// Formats with 'digits' significant decimal digits, trailing zeros are dropped
+		std::string ToDecimal(std::size_t digits) const;
+		long double ToLongDouble() const;
+
+		bool IsZero()		const { return m_limbs.empty(); }
+		bool IsNegative()	const { return m_negative; }
+		bool IsInteger()	const;
+
+		// Position of the most significant limb, 'x < 2^(32 * Top())'
+		int64_t Top() const { return m_exponent + static_cast<int64_t>(m_limbs.size()); }
+
+		Float operator-() const;
+		Float Abs() const;
+
+		// Exact scaling by 2^bits
+		Float MulPow2(int64_t bits) const;
+		Float MulSmall(uint32_t value) const;
+		Float DivSmall(uint32_t value) const;
+
+		friend Float operator+(const Float& lhs, const Float& rhs);
+		friend Float operator-(const Float& lhs, const Float& rhs);
+		friend Float operator*(const Float& lhs, const Float& rhs);
+		// 'rhs' must not be zero
+		friend Float operator/(const Float& lhs, const Float& rhs);
+
+		friend int Compare(const Float& lhs, const Float& rhs);
+		friend bool operator==(const Float& lhs, const Float& rhs) { return Compare(lhs, rhs) == 0; }
+		friend bool operator<(const Float& lhs, const Float& rhs) { return Compare(lhs, rhs) < 0; }
+
+		// 'x' must not be negative
+		friend Float Sqrt(const Float& x);
+		friend Float Floor(const Float& x);
+		// Drops the fractional part
+		friend Float Truncate(const Float& x);
+
+		// Copy with at most 'limbs' most significant limbs
+		Float Truncated(std::size_t limbs) const;
+
+	private:
+		void Normalize();
+
+		static Float AddMagnitudes(const Float& lhs, const Float& rhs);
+		// |lhs| must not be smaller than |rhs|
+		static Float SubMagnitudes(const Float& lhs, const Float& rhs);
+		static int CompareMagnitudes(const Float& lhs, const Float& rhs);
+		static Float Reciprocal(const Float& x);
+
+	private:
+		bool					m_negative = false;
+		int64_t					m_exponent = 0;
+		std::vector<uint32_t>	m_limbs; // least significant first, empty for zero
+	};
+
+	Float Ceil(const Float& x);
+	Float Round(const Float& x);
+
+	// Constants at the working precision, computed once per precision and cached
+	Float Pi();
+	Float E();
+	Float Ln2();
+
+	// Real functions return false outside of their domain or when the result doesn't fit
+	bool Exp(const Float& x, Float& out);
+	bool Log(const Float& x, Float& out);
+	void SinCos(const Float& x, Float& sin, Float& cos);
+	Float Atan(const Float& x);
+	Float Atan2(const Float& y, const Float& x);
+
+	struct Complex
+	{
+		Float real;
+		Float imag;
+
+		Complex() = default;
+		Complex(Float real, Float imag = Float()) : real(std::move(real)), imag(std::move(imag)) {}
+		Complex(const std::complex<value_type>& value) : real(value.real()), imag(value.imag()) {}
+
+		bool IsZero() const { return real.IsZero() && imag.IsZero(); }
+		std::complex<value_type> ToComplex() const { return { real.ToLongDouble(), imag.ToLongDouble() }; }
+	};
+
+	// Formatted like 'complex_to_string()'
+	std::string ToString(const Complex& value, std::size_t digits);
+
+	// Arithmetic and comparison operators, false on division by zero or overflow
+	bool ApplyOperator(TokenType type, const Complex& lhs, const Complex& rhs, Complex& out);
+	// Builtins that operate on values, same branch cuts as the 'std::complex' versions
+	bool ApplyFunction(FunctionType function, const std::vector<Complex>& inputs, Complex& out);
+	Complex EvaluateConstant(Constant constant);
+
+	using VariableList = std::unordered_map<std::string, Complex>;
+
+	// Evaluates 'root' with 'digits' significant digits. Variables are looked up from 'precise' first and then
+	// from 'variables', user functions are evaluated from their trees. Builtins operating on user functions
+	// are not available at this precision.
+	bool Evaluate(const TokenNode* root, std::size_t digits, const VariableList& precise, const bcalc::VariableList& variables, const FunctionList& functions, Complex& out);
+
+}
@@ -0,0 +1,1000 @@
+#include "Multiprecision.h"
+#include "Random.h"
+
+#include <cmath>
+#include <mutex>
+
+namespace bcalc::Multiprecision
+{
+
+	// Terms smaller than this relative to the result don't change it at the working precision
+	static bool Negligible(const Float& term, const Float& relative_to)
+	{
+		return term.IsZero() || term.Top() < relative_to.Top() - static_cast<int64_t>(Precision::Current()) - 1;
+	}
+
+	// Limbs a series term needs, it only has to be accurate relative to the sum it is added to
+	static std::size_t TermLimbs(const Float& term, const Float& sum)
+	{
+		int64_t limbs = static_cast<int64_t>(Precision::Current()) - (sum.Top() - term.Top()) + 1;
+		return static_cast<std::size_t>(std::max<int64_t>(limbs, 2));
+	}
+
+	// Number of halvings applied to arguments before summing their series, balancing series length against
+	// the squarings that undo it
+	static int ReductionSteps()
+	{
+		return static_cast<int>(std::sqrt(32.0 * Precision::Current()) / 2) + 4;
+	}
+
+	// Constants
+
+	struct ConstantCache
+	{
+		std::mutex	mutex;
+		Float		value;
+		std::size_t	limbs = 0;
+	};
+
+	static Float Cached(ConstantCache& cache, Float (*compute)())
+	{
+		const std::size_t limbs = Precision::Current();
+
+		{
+			std::scoped_lock _(cache.mutex);
+			if (cache.limbs >= limbs)
+				return cache.value.Truncated(limbs);
+		}
+
+		Float value;
+		{
+			Precision guard(limbs + 1);
+			value = compute();
+		}
+
+		std::scoped_lock _(cache.mutex);
+		if (cache.limbs < limbs)
+		{
+			cache.value = value;
+			cache.limbs = limbs;
+		}
+		return value.Truncated(limbs);
+	}
+
+	// atan(1 / n) = sum (-1)^k / ((2k + 1) n^(2k + 1))
+	static Float AtanInverse(uint32_t n)
+	{
+		Float power = Float(1).DivSmall(n);
+		Float sum = power;
+		for (uint32_t k = 1; ; k++)
+		{
+			power = power.DivSmall(n * n);
+			Float term = power.DivSmall(2 * k + 1);
+			if (Negligible(term, sum))
+				break;
+			sum = k % 2 ? sum - term : sum + term;
+		}
+		return sum;
+	}
+
+	static Float ComputePi()
+	{
+		// Machin's formula
+		return AtanInverse(5).MulSmall(16) - AtanInverse(239).MulSmall(4);
+	}
+
+	static Float ComputeE()
+	{
+		Float term = Float(1);
+		Float sum = Float(2);
+		for (uint32_t k = 2; ; k++)
+		{
+			term = term.DivSmall(k);
+			if (Negligible(term, sum))
+				break;
+			sum = sum + term;
+		}
+		return sum;
+	}
+
+	static Float ComputeLn2()
+	{
+		// ln 2 = 2 atanh(1 / 3) = 2 sum 1 / ((2k + 1) 3^(2k + 1))
+		Float power = Float(1).DivSmall(3);
+		Float sum = power;
+		for (uint32_t k = 1; ; k++)
+		{
+			power = power.DivSmall(9);
+			Float term = power.DivSmall(2 * k + 1);
+			if (Negligible(term, sum))
+				break;
+			sum = sum + term;
+		}
+		return sum.MulPow2(1);
+	}
+
+	Float Pi()
+	{
+		static ConstantCache s_cache;
+		return Cached(s_cache, ComputePi);
+	}
+
+	Float E()
+	{
+		static ConstantCache s_cache;
+		return Cached(s_cache, ComputeE);
+	}
+
+	Float Ln2()
+	{
+		static ConstantCache s_cache;
+		return Cached(s_cache, ComputeLn2);
+	}
+
+	// Real functions
+
+	bool Exp(const Float& x, Float& out)
+	{
+		if (x.IsZero())
+		{
+			out = Float(1);
+			return true;
+		}
+
+		// Keeps the binary exponent of the result far from overflowing
+		if (x.Top() > 1)
+			return false;
+
+		const std::size_t limbs = Precision::Current();
+		const int steps = ReductionSteps();
+
+		Float result;
+		{
+			// Squaring amplifies the relative error by 2 per step
+			Precision guard(limbs + steps / 32 + 3);
+
+			// x = n ln 2 + r, |r| <= ln 2 / 2
+			const Float ln2 = Ln2();
+			const int64_t n = std::llround((x / ln2).ToLongDouble());
+			Float r = (x - ln2 * Float(static_cast<long double>(n))).MulPow2(-steps);
+
+			Float term = Float(1);
+			Float sum = Float(1);
+			for (uint32_t k = 1; ; k++)
+			{
+				{
+					Precision term_guard(TermLimbs(term, sum));
+					term = (term * r).DivSmall(k);
+				}
+				if (Negligible(term, sum))
+					break;
+				sum = sum + term;
+			}
+
+			for (int i = 0; i < steps; i++)
+				sum = sum * sum;
+			result = sum.MulPow2(n);
+		}
+
+		out = result.Truncated(limbs);
+		return true;
+	}
+
+	bool Log(const Float& x, Float& out)
+	{
+		if (x.IsZero() || x.IsNegative())
+			return false;
+
+		const std::size_t limbs = Precision::Current();
+
+		// Close to 1 the result is small, so it needs more limbs for the same relative precision
+		const Float distance = x - Float(1);
+		if (distance.IsZero())
+		{
+			out = Float();
+			return true;
+		}
+
+		Float result;
+		{
+			Precision guard(limbs + 2 + static_cast<std::size_t>(std::max<int64_t>(0, -distance.Top())));
+
+			// x = m 2^b with m close to 1
+			const long double leading = x.MulPow2(-32 * (x.Top() - 1)).ToLongDouble();
+			const int64_t b = std::llround(std::log2(leading) + 32.0L * (x.Top() - 1));
+			const Float m = x.MulPow2(-b);
+
+			// Halley iteration 'y += 2 (m - e^y) / (m + e^y)' triples the correct limbs on every step, so only
+			// the last steps run at the full precision
+			const std::size_t target = Precision::Current();
+			Float y = Float(std::log(m.ToLongDouble()));
+
+			std::size_t precision = 1;
+			for (bool last = false; !last;)
+			{
+				last = precision == target;
+				precision = std::min(3 * precision, target);
+
+				Precision step_guard(precision + 1);
+				Float exp;
+				Exp(y, exp);
+				y = y + ((m - exp) / (m + exp)).MulPow2(1);
+			}
+
+			result = b != 0 ? y + Ln2() * Float(static_cast<long double>(b)) : y;
+		}
+
+		out = result.Truncated(limbs);
+		return true;
+	}
+
+	void SinCos(const Float& x, Float& sin, Float& cos)
+	{
+		if (x.IsZero())
+		{
+			sin = Float();
+			cos = Float(1);
+			return;
+		}
+
+		const std::size_t limbs = Precision::Current();
+		const int steps = ReductionSteps();
+
+		Float s, c;
+		{
+			// The reduction subtracts a multiple of 2 pi as large as x
+			Precision guard(limbs + steps / 32 + 3 + static_cast<std::size_t>(std::max<int64_t>(0, x.Top())));
+
+			const Float two_pi = Pi().MulPow2(1);
+			const Float turns = Floor(x / two_pi + Float(0.5L));
+			const Float r = (x - two_pi * turns).MulPow2(-steps);
+			const Float r2 = r * r;
+
+			s = r;
+			c = Float(1);
+			Float sin_term = r;
+			Float cos_term = Float(1);
+			for (uint32_t k = 1; ; k++)
+			{
+				{
+					Precision term_guard(TermLimbs(sin_term, s));
+					sin_term = -(sin_term * r2).DivSmall((2 * k) * (2 * k + 1));
+				}
+				{
+					Precision term_guard(TermLimbs(cos_term, c));
+					cos_term = -(cos_term * r2).DivSmall((2 * k - 1) * (2 * k));
+				}
+				bool done = Negligible(sin_term, s) && Negligible(cos_term, c);
+				s = s + sin_term;
+				c = c + cos_term;
+				if (done)
+					break;
+			}
+
+			// sin 2a = 2 sin a cos a, cos 2a = (cos a - sin a)(cos a + sin a)
+			for (int i = 0; i < steps; i++)
+			{
+				Float doubled = (s * c).MulPow2(1);
+				c = (c - s) * (c + s);
+				s = doubled;
+			}
+		}
+
+		sin = s.Truncated(limbs);
+		cos = c.Truncated(limbs);
+	}
+
+	Float Atan(const Float& x)
+	{
+		if (x.IsZero())
+			return Float();
+		if (x.IsNegative())
+			return -Atan(-x);
+
+		const std::size_t limbs = Precision::Current();
+
+		Float result;
+		{
+			Precision guard(limbs + 2);
+
+			if (Float(1) < x)
+				result = Pi().MulPow2(-1) - Atan(Float(1) / x);
+			else
+			{
+				// atan x = 2 atan(x / (1 + sqrt(1 + x^2)))
+				const int steps = ReductionSteps() / 2;
+				Float y = x;
+				for (int i = 0; i < steps; i++)
+					y = y / (Float(1) + Sqrt(Float(1) + y * y));
+
+				const Float y2 = y * y;
+				Float power = y;
+				Float sum = y;
+				for (uint32_t k = 1; ; k++)
+				{
+					Float term;
+					{
+						Precision term_guard(TermLimbs(power, sum));
+						power = -(power * y2);
+						term = power.DivSmall(2 * k + 1);
+					}
+					if (Negligible(term, sum))
+						break;
+					sum = sum + term;
+				}
+				result = sum.MulPow2(steps);
+			}
+		}
+
+		return result.Truncated(limbs);
+	}
+
+	Float Atan2(const Float& y, const Float& x)
+	{
+		if (x.IsZero())
+		{
+			if (y.IsZero())
+				return Float();
+			Float half_pi = Pi().MulPow2(-1);
+			return y.IsNegative() ? -half_pi : half_pi;
+		}
+
+		Float angle = Atan(y / x);
+		if (!x.IsNegative())
+			return angle;
+		return y.IsNegative() ? angle - Pi() : angle + Pi();
+	}
+
+	// Complex arithmetic
+
+	static Complex operator+(const Complex& lhs, const Complex& rhs) { return { lhs.real + rhs.real, lhs.imag + rhs.imag }; }
+	static Complex operator-(const Complex& lhs, const Complex& rhs) { return { lhs.real - rhs.real, lhs.imag - rhs.imag }; }
+	static Complex operator*(const Complex& lhs, const Complex& rhs)
+	{
+		if (rhs.imag.IsZero())
+			return { lhs.real * rhs.real, lhs.imag * rhs.real };
+		return { lhs.real * rhs.real - lhs.imag * rhs.imag, lhs.real * rhs.imag + lhs.imag * rhs.real };
+	}
+
+	static bool Divide(const Complex& lhs, const Complex& rhs, Complex& out)
+	{
+		if (rhs.IsZero())
+			return false;
+
+		if (rhs.imag.IsZero())
+		{
+			out = { lhs.real / rhs.real, lhs.imag / rhs.real };
+			return true;
+		}
+
+		Float denominator = rhs.real * rhs.real + rhs.imag * rhs.imag;
+		out = {
+			(lhs.real * rhs.real + lhs.imag * rhs.imag) / denominator,
+			(lhs.imag * rhs.real - lhs.real * rhs.imag) / denominator
+		};
+		return true;
+	}
+
+	static const Complex s_i = Complex(Float(), Float(1));
+
+	static Float Abs(const Complex& z)
+	{
+		if (z.imag.IsZero())
+			return z.real.Abs();
+		if (z.real.IsZero())
+			return z.imag.Abs();
+		return Sqrt(z.real * z.real + z.imag * z.imag);
+	}
+
+	// cosh and sinh of a real argument
+	static bool CoshSinh(const Float& x, Float& cosh, Float& sinh)
+	{
+		if (x.IsZero())
+		{
+			cosh = Float(1);
+			sinh = Float();
+			return true;
+		}
+
+		const std::size_t limbs = Precision::Current();
+
+		// e^x - e^-x cancels for small x
+		Precision guard(limbs + 1 + static_cast<std::size_t>(std::max<int64_t>(0, -x.Top())));
+
+		Float exp;
+		if (!Exp(x, exp))
+			return false;
+		Float inverse = Float(1) / exp;
+		cosh = ((exp + inverse).MulPow2(-1)).Truncated(limbs);
+		sinh = ((exp - inverse).MulPow2(-1)).Truncated(limbs);
+		return true;
+	}
+
+	static bool Exp(const Complex& z, Complex& out)
+	{
+		Float magnitude;
+		if (!Exp(z.real, magnitude))
+			return false;
+		if (z.imag.IsZero())
+		{
+			out = magnitude;
+			return true;
+		}
+
+		Float sin, cos;
+		SinCos(z.imag, sin, cos);
+		out = { magnitude * cos, magnitude * sin };
+		return true;
+	}
+
+	static bool Log(const Complex& z, Complex& out)
+	{
+		if (z.IsZero())
+			return false;
+
+		if (z.imag.IsZero() && !z.real.IsNegative())
+		{
+			out.imag = Float();
+			return Log(z.real, out.real);
+		}
+
+		Float magnitude;
+		if (!Log(Abs(z), magnitude))
+			return false;
+		out = { magnitude, Atan2(z.imag, z.real) };
+		return true;
+	}
+
+	static Complex Sqrt(const Complex& z)
+	{
+		if (z.imag.IsZero())
+		{
+			if (z.real.IsNegative())
+				return { Float(), Sqrt(-z.real) };
+			return Sqrt(z.real);
+		}
+
+		// The larger of the two parts is computed directly, the other from b = 2 re im
+		Float r = Abs(z);
+		if (!z.real.IsNegative())
+		{
+			Float real = Sqrt((r + z.real).MulPow2(-1));
+			return { real, (z.imag / real).MulPow2(-1) };
+		}
+
+		Float imag = Sqrt((r - z.real).MulPow2(-1));
+		if (z.imag.IsNegative())
+			imag = -imag;
+		return { (z.imag / imag).MulPow2(-1), imag };
+	}
+
+	static bool Pow(const Complex& base, const Complex& exponent, Complex& out)
+	{
+		// Small integer powers by repeated squaring, exact where possible
+		if (exponent.imag.IsZero() && exponent.real.IsInteger() && exponent.real.Top() <= 1)
+		{
+			uint64_t n = static_cast<uint64_t>(std::fabs(exponent.real.ToLongDouble()));
+
+			Complex result = Float(1);
+			Complex power = base;
+			for (; n; n >>= 1)
+			{
+				if (n & 1)
+					result = result * power;
+				if (n > 1)
+					power = power * power;
+			}
+
+			if (!exponent.real.IsNegative())
+			{
+				out = result;
+				return true;
+			}
+			return Divide(Float(1), result, out);
+		}
+
+		if (base.IsZero())
+		{
+			if (exponent.real.IsNegative() || exponent.real.IsZero())
+				return false;
+			out = Complex();
+			return true;
+		}
+
+		Complex log;
+		if (!Log(base, log))
+			return false;
+		return Exp(exponent * log, out);
+	}
+
+	static bool Sin(const Complex& z, Complex& out)
+	{
+		Float sin, cos, cosh, sinh;
+		SinCos(z.real, sin, cos);
+		if (!CoshSinh(z.imag, cosh, sinh))
+			return false;
+		out = { sin * cosh, cos * sinh };
+		return true;
+	}
+
+	static bool Cos(const Complex& z, Complex& out)
+	{
+		Float sin, cos, cosh, sinh;
+		SinCos(z.real, sin, cos);
+		if (!CoshSinh(z.imag, cosh, sinh))
+			return false;
+		out = { cos * cosh, -(sin * sinh) };
+		return true;
+	}
+
+	static bool Sinh(const Complex& z, Complex& out)
+	{
+		Float sin, cos, cosh, sinh;
+		SinCos(z.imag, sin, cos);
+		if (!CoshSinh(z.real, cosh, sinh))
+			return false;
+		out = { sinh * cos, cosh * sin };
+		return true;
+	}
+
+	static bool Cosh(const Complex& z, Complex& out)
+	{
+		Float sin, cos, cosh, sinh;
+		SinCos(z.imag, sin, cos);
+		if (!CoshSinh(z.real, cosh, sinh))
+			return false;
+		out = { cosh * cos, sinh * sin };
+		return true;
+	}
+
+	// Real inverse hyperbolic cosine, 'x >= 1'
+	static bool Acosh(const Float& x, Float& out)
+	{
+		return Log(x + Sqrt(x * x - Float(1)), out);
+	}
+
+	// Arguments on the real axis are handled separately, which keeps results real inside the domain and puts
+	// values on branch cuts on the same side as 'std::complex' does for a positive zero imaginary part.
+
+	static bool ArcSin(const Complex& z, Complex& out)
+	{
+		if (z.imag.IsZero())
+		{
+			const Float one = Float(1);
+			const Float abs = z.real.Abs();
+			if (!(one < abs))
+			{
+				out = Atan2(z.real, Sqrt(one - z.real * z.real));
+				return true;
+			}
+
+			Float half_pi = Pi().MulPow2(-1);
+			out = { z.real.IsNegative() ? -half_pi : half_pi, Float() };
+			return Acosh(abs, out.imag);
+		}
+
+		// asin z = -i log(i z + sqrt(1 - z^2))
+		Complex log;
+		if (!Log(s_i * z + Sqrt(Complex(Float(1)) - z * z), log))
+			return false;
+		out = { log.imag, -log.real };
+		return true;
+	}
+
+	static bool ArcCos(const Complex& z, Complex& out)
+	{
+		if (z.imag.IsZero())
+		{
+			const Float one = Float(1);
+			if (!(one < z.real.Abs()))
+			{
+				out = Atan2(Sqrt(one - z.real * z.real), z.real);
+				return true;
+			}
+
+			out = { z.real.IsNegative() ? Pi() : Float(), Float() };
+			if (!Acosh(z.real.Abs(), out.imag))
+				return false;
+			out.imag = -out.imag;
+			return true;
+		}
+
+		Complex asin;
+		if (!ArcSin(z, asin))
+			return false;
+		out = { Pi().MulPow2(-1) - asin.real, -asin.imag };
+		return true;
+	}
+
+	static bool ArcTan(const Complex& z, Complex& out)
+	{
+		if (z.imag.IsZero())
+		{
+			out = Atan(z.real);
+			return true;
+		}
+
+		if (z.real.IsZero() && Float(1) < z.imag.Abs())
+		{
+			// 0.5 log((b + 1) / (b - 1))
+			const Float one = Float(1);
+			out = Pi().MulPow2(-1);
+			if (!Log((z.imag + one) / (z.imag - one), out.imag))
+				return false;
+			out.imag = out.imag.MulPow2(-1);
+			return true;
+		}
+
+		// atan z = i/2 (log(1 - i z) - log(1 + i z))
+		Complex lhs, rhs;
+		const Complex one = Float(1);
+		if (!Log(one - s_i * z, lhs) || !Log(one + s_i * z, rhs))
+			return false;
+		Complex difference = lhs - rhs;
+		out = { (-difference.imag).MulPow2(-1), difference.real.MulPow2(-1) };
+		return true;
+	}
+
+	static bool ArcSinh(const Complex& z, Complex& out)
+	{
+		if (z.imag.IsZero())
+		{
+			const Float abs = z.real.Abs();
+			if (!Log(abs + Sqrt(abs * abs + Float(1)), out.real))
+				return false;
+			if (z.real.IsNegative())
+				out.real = -out.real;
+			out.imag = Float();
+			return true;
+		}
+
+		if (z.real.IsZero() && Float(1) < z.imag.Abs())
+		{
+			Float half_pi = Pi().MulPow2(-1);
+			out.imag = z.imag.IsNegative() ? -half_pi : half_pi;
+			return Acosh(z.imag.Abs(), out.real);
+		}
+
+		// asinh z = log(z + sqrt(z^2 + 1))
+		return Log(z + Sqrt(z * z + Complex(Float(1))), out);
+	}
+
+	static bool ArcCosh(const Complex& z, Complex& out)
+	{
+		if (z.imag.IsZero())
+		{
+			const Float one = Float(1);
+			if (!(z.real < one))
+			{
+				out.imag = Float();
+				return Acosh(z.real, out.real);
+			}
+			if (!(one < z.real.Abs()))
+			{
+				out = { Float(), Atan2(Sqrt(one - z.real * z.real), z.real) };
+				return true;
+			}
+
+			out.imag = Pi();
+			return Acosh(z.real.Abs(), out.real);
+		}
+
+		// acosh z = log(z + sqrt(z + 1) sqrt(z - 1))
+		const Complex one = Float(1);
+		return Log(z + Sqrt(z + one) * Sqrt(z - one), out);
+	}
+
+	static bool ArcTanh(const Complex& z, Complex& out)
+	{
+		const Complex one = Float(1);
+
+		if (z.imag.IsZero())
+		{
+			const Float abs = z.real.Abs();
+			if (abs == Float(1))
+				return false;
+
+			// 0.5 log|(1 + x) / (1 - x)|, plus pi/2 i outside of (-1, 1)
+			Float log;
+			if (!Log(((Float(1) + z.real) / (Float(1) - z.real)).Abs(), log))
+				return false;
+			out = { log.MulPow2(-1), Float(1) < abs ? Pi().MulPow2(-1) : Float() };
+			return true;
+		}
+
+		// atanh z = (log(1 + z) - log(1 - z)) / 2
+		Complex lhs, rhs;
+		if (!Log(one + z, lhs) || !Log(one - z, rhs))
+			return false;
+		Complex difference = lhs - rhs;
+		out = { difference.real.MulPow2(-1), difference.imag.MulPow2(-1) };
+		return true;
+	}
+
+	Complex EvaluateConstant(Constant constant)
+	{
+		static_assert(static_cast<int>(Constant::Count) == 3);
+
+		switch (constant)
+		{
+			case Constant::pi:
+				return Pi();
+			case Constant::e:
+				return E();
+			case Constant::i:
+				return s_i;
+			case Constant::Count:
+				// Not a constant, the lexer never creates it
+				break;
+		}
+
+		throw;
+	}
+
+	bool ApplyOperator(TokenType type, const Complex& lhs, const Complex& rhs, Complex& out)
+	{
+		switch (type)
+		{
+			case TokenType::Add:	out = lhs + rhs;	return true;
+			case TokenType::Sub:	out = lhs - rhs;	return true;
+			case TokenType::Mult:	out = lhs * rhs;	return true;
+			case TokenType::Div:	return Divide(lhs, rhs, out);
+			case TokenType::Power:	return Pow(lhs, rhs, out);
+			default:
+				break;
+		}
+
+		// Ordering compares real parts, equality compares the whole complex value
+		bool result;
+		switch (type)
+		{
+			case TokenType::Less:			result = lhs.real < rhs.real;							break;
+			case TokenType::LessEqual:		result = !(rhs.real < lhs.real);						break;
+			case TokenType::Greater:		result = rhs.real < lhs.real;							break;
+			case TokenType::GreaterEqual:	result = !(lhs.real < rhs.real);						break;
+			case TokenType::Equal:			result = lhs.real == rhs.real && lhs.imag == rhs.imag;	break;
+			case TokenType::NotEqual:		result = !(lhs.real == rhs.real && lhs.imag == rhs.imag);	break;
+			default:
+				return false;
+		}
+
+		out = result ? Float(1) : Float();
+		return true;
+	}
+
+	bool ApplyFunction(FunctionType function, const std::vector<Complex>& inputs, Complex& out)
+	{
+		static_assert(static_cast<int>(FunctionType::Count) == 38);
+
+		if (function == FunctionType::Log && inputs.size() == 2)
+		{
+			Complex numerator, denominator;
+			if (!Log(inputs[0], numerator) || !Log(inputs[1], denominator))
+				return false;
+			return Divide(numerator, denominator, out);
+		}
+
+		if (function == FunctionType::If)
+		{
+			if (inputs.size() != 3)
+				return false;
+			out = inputs[0].IsZero() ? inputs[2] : inputs[1];
+			return true;
+		}
+
+		// Draws have the 64 bits of long double
+		if (function == FunctionType::Rand || function == FunctionType::Randn)
+		{
+			if (!inputs.empty())
+				return false;
+			out = Float(function == FunctionType::Rand ? Random::Uniform() : Random::Normal());
+			return true;
+		}
+
+		// Scalars act as 1 by 1 matrices
+		if (function == FunctionType::Dot || function == FunctionType::MatMul)
+		{
+			if (inputs.size() != 2)
+				return false;
+			return ApplyOperator(TokenType::Mult, inputs[0], inputs[1], out);
+		}
+
+		if (inputs.size() != 1)
+			return false;
+		const Complex& z = inputs[0];
+
+		switch (function)
+		{
+			case FunctionType::Sin:		return Sin(z, out);
+			case FunctionType::ArcSin:	return ArcSin(z, out);
+			case FunctionType::Sinh:	return Sinh(z, out);
+			case FunctionType::ArcSinh:	return ArcSinh(z, out);
+			case FunctionType::Cos:		return Cos(z, out);
+			case FunctionType::ArcCos:	return ArcCos(z, out);
+			case FunctionType::Cosh:	return Cosh(z, out);
+			case FunctionType::ArcCosh:	return ArcCosh(z, out);
+			case FunctionType::Tan:
+			{
+				Complex sin, cos;
+				return Sin(z, sin) && Cos(z, cos) && Divide(sin, cos, out);
+			}
+			case FunctionType::ArcTan:	return ArcTan(z, out);
+			case FunctionType::Tanh:
+			{
+				Complex sinh, cosh;
+				return Sinh(z, sinh) && Cosh(z, cosh) && Divide(sinh, cosh, out);
+			}
+			case FunctionType::ArcTanh:	return ArcTanh(z, out);
+			case FunctionType::Sqrt:
+				out = Sqrt(z);
+				return true;
+			case FunctionType::Log:		return Log(z, out);
+			case FunctionType::Exp:		return Exp(z, out);
+			case FunctionType::Round:
+				out = { Round(z.real), Round(z.imag) };
+				return true;
+			case FunctionType::Floor:
+				out = { Floor(z.real), Floor(z.imag) };
+				return true;
+			case FunctionType::Ceil:
+				out = { Ceil(z.real), Ceil(z.imag) };
+				return true;
+			case FunctionType::Transpose:
+			case FunctionType::Det:
+				out = z;
+				return true;
+			case FunctionType::Inverse:
+				return Divide(Complex(Float(1)), z, out);
+			case FunctionType::Dot:
+			case FunctionType::Cross:
+			case FunctionType::MatMul:
+			case FunctionType::Diff:
+			case FunctionType::Grad:
+			case FunctionType::Solve:
+			case FunctionType::Roots:
+			case FunctionType::Sum:
+			case FunctionType::Prod:
+			case FunctionType::Integrate:
+			case FunctionType::Table:
+			case FunctionType::Grid:
+			case FunctionType::Matrix:
+			case FunctionType::If:
+			case FunctionType::Rand:
+			case FunctionType::Randn:
+			case FunctionType::McMean:
+			case FunctionType::Count:
+				return false;
+		}
+
+		return false;
+	}
+
+	std::string ToString(const Complex& value, std::size_t digits)
+	{
+		if (value.imag.IsZero())
+			return value.real.ToDecimal(digits);
+
+		std::string imag = value.imag.Abs().ToDecimal(digits) + " i";
+		if (value.real.IsZero())
+			return value.imag.IsNegative() ? "-" + imag : imag;
+		return value.real.ToDecimal(digits) + (value.imag.IsNegative() ? " - " : " + ") + imag;
+	}
+
+	// Tree evaluation
+
+	// Recursion of user functions deeper than this is treated as runaway
+	static constexpr std::size_t s_max_depth = 1 << 12;
+
+	struct Context
+	{
+		const VariableList&			precise;
+		const bcalc::VariableList&	variables;
+		const FunctionList&			functions;
+	};
+
+	static bool EvaluateNode(const TokenNode* node, const VariableList& locals, const Context& context, std::size_t depth, Complex& out)
+	{
+		if (!Cancellation::Checkpoint())
+			return false;
+
+		const Token& token = node->GetToken();
+		const auto& nodes = node->GetNodes();
+
+		switch (token.Type())
+		{
+			case TokenType::Value:
+				// Literals are parsed again from their text, '0.1' isn't exact as a long double
+				if (!token.GetLiteral().empty())
+					out = Float::FromDecimal(token.GetLiteral());
+				else
+					out = Complex(token.GetValue());
+				return true;
+
+			case TokenType::Constant:
+				out = Multiprecision::EvaluateConstant(token.GetConstant());
+				return true;
+
+			case TokenType::String:
+			{
+				const std::string name = token.GetString();
+
+				if (auto it = locals.find(name); it != locals.end())
+				{
+					out = it->second;
+					return true;
+				}
+
+				if (auto it = context.precise.find(name); it != context.precise.end())
+				{
+					out = it->second;
+					return true;
+				}
+
+				if (auto it = context.variables.find(name); it != context.variables.end())
+				{
+					if (!std::isfinite(it->second.real()) || !std::isfinite(it->second.imag()))
+						return false;
+					out = Complex(it->second);
+					return true;
+				}
+
+				const UserFunction* function = FindFunction(context.functions, name, nodes.size());
+				if (!function || depth >= s_max_depth)
+					return false;
+
+				// Callees see their own parameters and globals, not the locals of the caller
+				VariableList parameters;
+				for (std::size_t i = 0; i < nodes.size(); i++)
+				{
+					Complex input;
+					if (!EvaluateNode(nodes[i], locals, context, depth, input))
+						return false;
+					parameters[function->parameters[i]] = std::move(input);
+				}
+
+				return EvaluateNode(function->expression, parameters, context, depth + 1, out);
+			}
+
+			case TokenType::BuiltinFunction:
+			{
+				FunctionType function = token.GetBuiltinFunction();
+				if (IsHigherOrder(function))
+					return false;
+
+				if (function == FunctionType::If)
+				{
+					Complex condition;
+					if (nodes.size() != 3 || !EvaluateNode(nodes[0], locals, context, depth, condition))
+						return false;
+					return EvaluateNode(nodes[condition.IsZero() ? 2 : 1], locals, context, depth, out);
+				}
+
+				std::vector<Complex> inputs(nodes.size());
+				for (std::size_t i = 0; i < nodes.size(); i++)
+					if (!EvaluateNode(nodes[i], locals, context, depth, inputs[i]))
+						return false;
+
+				return ApplyFunction(function, inputs, out);
+			}
+
+			default:
+				break;
+		}
+
+		if (nodes.size() != 2)
+			return false;
+
+		Complex lhs, rhs;
+		if (!EvaluateNode(nodes[0], locals, context, depth, lhs) || !EvaluateNode(nodes[1], locals, context, depth, rhs))
+			return false;
+
+		return ApplyOperator(token.Type(), lhs, rhs, out);
+	}
+
+	bool Evaluate(const TokenNode* root, std::size_t digits, const VariableList& precise, const bcalc::VariableList& variables, const FunctionList& functions, Complex& out)
+	{
+		Precision guard(DigitsToLimbs(digits));
+		return EvaluateNode(root, {}, { precise, variables, functions }, 0, out);
+	}
+
+}
@@ -0,0 +1,74 @@
+#include "Parallel.h"
+
+namespace bcalc
+{
+
+	ThreadPool& ThreadPool::Get()
+	{
+		// The calling thread runs a chunk too
+		static ThreadPool pool(ThreadCount() - 1);
+		return pool;
+	}
+
+	ThreadPool::ThreadPool(std::size_t threads)
+	{
+		m_workers.reserve(threads);
+		for (std::size_t i = 0; i < threads; i++)
+			m_workers.emplace_back(&ThreadPool::Work, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	void ThreadPool::Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_condition.notify_one();
+	}
+
+	bool ThreadPool::RunOne()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_tasks.empty())
+				return false;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+	void ThreadPool::Work()
+	{
+		s_in_parallel = true;
+
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+				if (m_tasks.empty())
+					return;
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Cancellation.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bcalc
+{
+
+	inline std::size_t ThreadCount()
+	{
+		return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+	}
+
+	// Worker threads shared by every 'ParallelFor()' of the process, started on first use
+	class ThreadPool
+	{
+	public:
+		static ThreadPool& Get();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> task);
+		// Runs a queued task on the calling thread, returns false if there was none
+		bool RunOne();
+
+		// True on workers and on threads running their own chunk of a 'ParallelFor()'
+		static bool InParallel() { return s_in_parallel; }
+
+		// Marks the calling thread as running parallel work for the lifetime of the object
+		class Region
+		{
+		public:
+			Region() : m_previous(s_in_parallel) { s_in_parallel = true; }
+			~Region() { s_in_parallel = m_previous; }
+
+			Region(const Region&) = delete;
+			Region& operator=(const Region&) = delete;
+
+		private:
+			bool m_previous;
+		};
+
+	private:
+		ThreadPool(std::size_t threads);
+		~ThreadPool();
+
+		void Work();
+
+	private:
+		static inline thread_local bool s_in_parallel = false;
+
+		std::vector<std::thread>			m_workers;
+		std::deque<std::function<void()>>	m_tasks;
+		std::mutex							m_mutex;
+		std::condition_variable				m_condition;
+		bool								m_stop = false;
+	};
+
+	// Calls 'func(begin, end)' for contiguous chunks of [0, count) on up to ThreadCount() threads of the pool.
+	// Small workloads, and calls made from parallel work already using every thread, run on the calling
+	// thread. Workers join the evaluation of the calling thread.
+	template<typename F>
+	void ParallelFor(std::size_t count, std::size_t min_chunk, F&& func)
+	{
+		std::size_t threads = std::min(ThreadCount(), count / std::max<std::size_t>(min_chunk, 1));
+		if (threads <= 1 || ThreadPool::InParallel())
+		{
+			if (count > 0)
+				func(std::size_t(0), count);
+			return;
+		}
+
+		ThreadPool& pool = ThreadPool::Get();
+		Cancellation* cancellation = Cancellation::Current();
+
+		std::size_t chunk = count / threads;
+		std::size_t extra = count % threads;
+
+		// Chunks still running on the pool, the last one to finish notifies under the lock so the caller can't
+		// return before it is done with them
+		struct
+		{
+			std::mutex				mutex;
+			std::condition_variable	done;
+			std::size_t				remaining;
+		} state;
+		state.remaining = threads - 1;
+
+		std::size_t begin = 0;
+		for (std::size_t i = 0; i < threads; i++)
+		{
+			std::size_t end = begin + chunk + (i < extra ? 1 : 0);
+			if (i == threads - 1)
+			{
+				ThreadPool::Region region;
+				func(begin, end);
+			}
+			else
+			{
+				pool.Submit([&func, &state, cancellation, begin, end]() {
+					{
+						Cancellation::Join join(cancellation);
+						func(begin, end);
+					}
+					std::lock_guard lock(state.mutex);
+					if (--state.remaining == 0)
+						state.done.notify_all();
+				});
+			}
+			begin = end;
+		}
+
+		// Queued chunks of this or other loops are run here instead of waiting for a worker to take them
+		ThreadPool::Region region;
+		while (true)
+		{
+			{
+				std::lock_guard lock(state.mutex);
+				if (state.remaining == 0)
+					return;
+			}
+			if (!pool.RunOne())
+				break;
+		}
+
+		std::unique_lock lock(state.mutex);
+		state.done.wait(lock, [&state]() { return state.remaining == 0; });
+	}
+
+}
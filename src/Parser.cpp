@@ -8,34 +8,48 @@ namespace bcalc
 
 	using it = std::vector<Token>::const_iterator;
 
+	static bool Opens(TokenType type)
+	{
+		return type == TokenType::LParan || type == TokenType::LBracket;
+	}
+
+	static bool Closes(TokenType type)
+	{
+		return type == TokenType::RParan || type == TokenType::RBracket;
+	}
+
 	static bool IsValid(it begin, it end)
 	{
-		int64_t depth = 0;
+		// Closing tokens still expected, parenthesis and brackets have to match
+		std::vector<TokenType> expected;
 		for (auto it = begin; it != end; it++)
 		{
 			if (it->Type() == TokenType::LParan)
-				depth++;
-			else if (it->Type() == TokenType::RParan)
+				expected.push_back(TokenType::RParan);
+			else if (it->Type() == TokenType::LBracket)
+				expected.push_back(TokenType::RBracket);
+			else if (Closes(it->Type()))
 			{
-				if (depth == 0)
+				if (expected.empty() || expected.back() != it->Type())
 					return false;
-				depth--;
+				expected.pop_back();
 			}
 		}
-		return depth == 0;
+		return expected.empty();
 	}
 
-	static bool IsInParenthesis(it begin, it end)
+	// Returns true if 'begin' is an 'open' token matched by the token at 'end - 1'
+	static bool IsEnclosed(it begin, it end, TokenType open)
 	{
-		if (begin->Type() != TokenType::LParan)
+		if (begin->Type() != open)
 			return false;
 
 		int64_t depth = 0;
 		for (auto it = begin + 1; it != end - 1; it++)
 		{
-			if (it->Type() == TokenType::LParan)
+			if (Opens(it->Type()))
 				depth++;
-			else if (it->Type() == TokenType::RParan)
+			else if (Closes(it->Type()))
 			{
 				if (depth == 0)
 					return false;
@@ -46,6 +60,11 @@ namespace bcalc
 		return depth == 0;
 	}
 
+	static bool IsInParenthesis(it begin, it end)
+	{
+		return IsEnclosed(begin, end, TokenType::LParan);
+	}
+
 	static it FindZeroDepth(it begin, it end, TokenType type)
 	{
 		uint64_t depth = 0;
@@ -53,16 +72,44 @@ namespace bcalc
 		{
 			if (it->Type() == type && depth == 0)
 				return it;
-			else if (it->Type() == TokenType::RParan)
+			else if (Closes(it->Type()))
 				depth++;
-			else if (it->Type() == TokenType::LParan)
+			else if (Opens(it->Type()))
 				depth--;
 		}
 		return end;
 	}
 
+	static bool IsComparison(TokenType type)
+	{
+		switch (type)
+		{
+			case TokenType::Less:
+			case TokenType::LessEqual:
+			case TokenType::Greater:
+			case TokenType::GreaterEqual:
+			case TokenType::Equal:
+			case TokenType::NotEqual:
+				return true;
+			default:
+				return false;
+		}
+	}
+
 	static it LastOOO(it begin, it end)
 	{
+		// Comparison
+		uint64_t depth = 0;
+		for (auto it = end - 1; it >= begin; it--)
+		{
+			if (IsComparison(it->Type()) && depth == 0)
+				return it;
+			else if (Closes(it->Type()))
+				depth++;
+			else if (Opens(it->Type()))
+				depth--;
+		}
+
 		// Addition / Substraction
 		auto add	= FindZeroDepth(begin, end, TokenType::Add);
 		auto sub	= FindZeroDepth(begin, end, TokenType::Sub);
@@ -96,6 +143,41 @@ namespace bcalc
 			fprintf(stderr, "%s\n", it->to_string().c_str());
 	}
 
+	// Builds the comma separated inputs between 'open' and the matching token at 'end - 1'
+	static bool BuildInputs(it open, it end, bool errors, std::vector<TokenNode*>& inputs)
+	{
+		it comma = open;
+
+		while (comma + 1 < end)
+		{
+			it start = ++comma;
+
+			// Commas of nested calls and lists belong to their own inputs
+			int64_t depth = 0;
+			while (comma + 1 != end && (depth > 0 || comma->Type() != TokenType::Comma))
+			{
+				if (Opens(comma->Type()))
+					depth++;
+				else if (Closes(comma->Type()))
+					depth--;
+				comma++;
+			}
+
+			TokenNode* input = Parser::BuildTokenTree(start, comma, errors);
+			if (!input)
+			{
+				for (TokenNode* node : inputs)
+					delete node;
+				inputs.clear();
+				return false;
+			}
+
+			inputs.push_back(input);
+		}
+
+		return true;
+	}
+
 	TokenNode* Parser::BuildTokenTree(it begin, it end, bool errors)
 	{
 		if (!IsValid(begin, end))
@@ -132,26 +214,26 @@ namespace bcalc
 				return new TokenNode(*begin);
 
 			std::vector<TokenNode*> inputs;
+			if (!BuildInputs(begin + 1, end, errors, inputs))
+			{
+				BCALC_PRINT_ERROR(errors, begin, end, "Could not build function input\n");
+				return nullptr;
+			}
 
-			it comma = begin + 1;
+			return new TokenNode(*begin, inputs);
+		}
 
-			while (comma + 1 < end)
+		// Vector and matrix literals
+		if (IsEnclosed(begin, end, TokenType::LBracket))
+		{
+			std::vector<TokenNode*> elements;
+			if (std::distance(begin, end) == 2 || !BuildInputs(begin, end, errors, elements))
 			{
-				it start = ++comma;
-				while (comma + 1 != end && comma->Type() != TokenType::Comma)
-					comma++;
-
-				TokenNode* input = BuildTokenTree(start, comma, errors);
-				if (!input)
-				{
-					BCALC_PRINT_ERROR(errors, begin, end, "Could not build function input\n");
-					return nullptr;
-				}
-
-				inputs.push_back(input);
+				BCALC_PRINT_ERROR(errors, begin, end, "Could not build list element\n");
+				return nullptr;
 			}
 
-			return new TokenNode(*begin, inputs);
+			return new TokenNode(*begin, elements);
 		}
 
 		auto op = LastOOO(begin, end);
@@ -0,0 +1,290 @@
+#include "Preview.h"
+
+#include "Parser.h"
+
+#include <algorithm>
+
+namespace bcalc
+{
+
+	// Cached subtree results are dropped beyond this
+	static constexpr std::size_t s_max_cache_entries = 4096;
+
+	// Characters after a number that 'from_chars' may look at, like the "e+5" of "1e+5"
+	static constexpr std::size_t s_lexer_lookahead = 3;
+
+	// Subtree in prefix form with literals as written, two literals with the same long double value may
+	// still differ in multi-precision mode
+	static void AppendKey(const TokenNode* node, std::string& key)
+	{
+		const Token& token = node->GetToken();
+		key += token.Type() == TokenType::Value ? token.GetLiteral() : token.to_string();
+		key += '(';
+		for (const TokenNode* child : node->GetNodes())
+		{
+			AppendKey(child, key);
+			key += ',';
+		}
+		key += ')';
+	}
+
+	Preview::Preview(const Program& program)
+		: m_program(program)
+		, m_worker(&Preview::Run, this)
+	{}
+
+	Preview::~Preview()
+	{
+		{
+			std::scoped_lock _(m_mutex);
+			m_stop = true;
+			m_generation++;
+			m_cancel = true;
+		}
+		m_condition.notify_one();
+		m_worker.join();
+	}
+
+	void Preview::Update(std::string_view line)
+	{
+		{
+			std::scoped_lock _(m_mutex);
+			m_request = line;
+			m_generation++;
+			m_cancel = true;
+			m_pending = true;
+			m_finished = false;
+		}
+		m_condition.notify_one();
+	}
+
+	bool Preview::Poll(std::string& text)
+	{
+		std::scoped_lock _(m_mutex);
+		if (!m_finished)
+			return false;
+		m_finished = false;
+		text = m_result;
+		return true;
+	}
+
+	std::unique_lock<std::mutex> Preview::LockProgram()
+	{
+		m_generation++;
+		m_cancel = true;
+		return std::unique_lock(m_program_mutex);
+	}
+
+	void Preview::Run()
+	{
+		while (true)
+		{
+			std::string line;
+			uint64_t generation;
+			{
+				std::unique_lock lock(m_mutex);
+				m_condition.wait(lock, [this] { return m_pending || m_stop; });
+				if (m_stop)
+					return;
+				line = std::move(m_request);
+				generation = m_generation;
+				m_pending = false;
+				m_cancel = false;
+			}
+
+			std::string result;
+			{
+				std::scoped_lock _(m_program_mutex);
+				Cancellation cancellation({}, &m_cancel);
+				result = Process(line, generation);
+			}
+
+			std::scoped_lock _(m_mutex);
+			if (!Superseded(generation))
+			{
+				m_result = std::move(result);
+				m_finished = true;
+			}
+		}
+	}
+
+	bool Preview::Tokenize(std::string_view line)
+	{
+		// Tokens ending well before the first changed character can't change
+		std::size_t common = std::mismatch(line.begin(), line.end(), m_line.begin(), m_line.end()).first - line.begin();
+
+		std::size_t keep = 0;
+		while (keep < m_tokens.size() && m_spans[keep].end + s_lexer_lookahead <= common)
+			keep++;
+
+		std::size_t start = keep ? m_spans[keep - 1].end : 0;
+		m_tokens.erase(m_tokens.begin() + keep, m_tokens.end());
+		m_spans.erase(m_spans.begin() + keep, m_spans.end());
+		m_line = line;
+
+		if (Lexer::Tokenize(line, start, m_tokens, m_spans))
+			return true;
+
+		m_tokens.clear();
+		m_spans.clear();
+		m_line.clear();
+		return false;
+	}
+
+	bool Preview::Evaluate(const TokenNode* node, uint64_t generation, Entry& out, std::string& key)
+	{
+		if (Superseded(generation))
+			return false;
+
+		const Token& token = node->GetToken();
+		const auto& nodes = node->GetNodes();
+
+		// Children are evaluated (and cached) separately for operators and builtins on values, everything
+		// else is evaluated as a whole
+		bool split = nodes.size() == 2 && token.Type() != TokenType::String && token.Type() != TokenType::BuiltinFunction;
+		if (token.Type() == TokenType::BuiltinFunction)
+		{
+			FunctionType function = token.GetBuiltinFunction();
+			split = !IsHigherOrder(function) && function != FunctionType::If;
+		}
+
+		// Keys of split nodes are built from the keys of their children
+		std::vector<Entry> inputs(split ? nodes.size() : 0);
+		if (split)
+		{
+			key = token.to_string() + '(';
+			for (std::size_t i = 0; i < nodes.size(); i++)
+			{
+				std::string child_key;
+				if (!Evaluate(nodes[i], generation, inputs[i], child_key))
+					return false;
+				key += child_key;
+				key += ',';
+			}
+			key += ')';
+		}
+		else
+		{
+			key.clear();
+			AppendKey(node, key);
+		}
+
+		if (auto it = m_cache.find(key); it != m_cache.end())
+		{
+			out = it->second;
+			return !out.result.has_error;
+		}
+
+		const std::size_t digits = m_program.Digits();
+		if (!split)
+			out.result = m_program.Evaluate(node, out.precise);
+		else if (digits == 0)
+		{
+			if (token.Type() == TokenType::BuiltinFunction)
+			{
+				std::vector<std::complex<value_type>> values;
+				for (const Entry& input : inputs)
+					values.push_back(input.result.value);
+				out.result = ApplyFunction(token.GetBuiltinFunction(), values);
+			}
+			else
+				out.result = ApplyOperator(token.Type(), inputs[0].result.value, inputs[1].result.value);
+		}
+		else
+		{
+			Multiprecision::Precision guard(Multiprecision::DigitsToLimbs(digits));
+
+			bool success;
+			if (token.Type() == TokenType::BuiltinFunction)
+			{
+				std::vector<Multiprecision::Complex> values;
+				for (const Entry& input : inputs)
+					values.push_back(input.precise);
+				success = Multiprecision::ApplyFunction(token.GetBuiltinFunction(), values, out.precise);
+			}
+			else
+				success = Multiprecision::ApplyOperator(token.Type(), inputs[0].precise, inputs[1].precise, out.precise);
+
+			out.result = success ? CalcResult { .value = out.precise.ToComplex() } : CalcResult { .has_error = true };
+		}
+
+		// A cancelled evaluation fails without its result being wrong
+		if (Superseded(generation))
+			return false;
+
+		if (m_cache.size() >= s_max_cache_entries)
+			m_cache.clear();
+		m_cache[key] = out;
+		return !out.result.has_error;
+	}
+
+	std::string Preview::Process(std::string_view line, uint64_t generation)
+	{
+		if (m_program.Version() != m_cache_version || m_program.Digits() != m_cache_digits)
+		{
+			m_cache.clear();
+			m_cache_version = m_program.Version();
+			m_cache_digits = m_program.Digits();
+		}
+
+		if (auto first = line.find_first_not_of(" \t"); first == std::string_view::npos || line[first] == ':')
+			return {};
+
+		if (!Tokenize(line))
+			return {};
+
+		// Like 'Program::Process()': bindings and assignments preview their value, definitions and tables
+		// have none
+		auto begin = m_tokens.cbegin();
+		auto end = m_tokens.cend();
+		auto is_assignment = [](const Token& token) { return token.Type() == TokenType::Equals || token.Type() == TokenType::Bind; };
+		if (auto it = std::find_if(begin, end, is_assignment); it != end)
+		{
+			if (it != begin + 1 || begin->Type() != TokenType::String || std::find_if(it + 1, end, is_assignment) != end)
+				return {};
+			begin = it + 1;
+		}
+
+		TokenNode* root = Parser::BuildTokenTree(begin, end);
+		if (!root)
+			return {};
+
+		if (root->GetToken().Type() == TokenType::BuiltinFunction)
+		{
+			FunctionType function = root->GetToken().GetBuiltinFunction();
+			if (function == FunctionType::Table || function == FunctionType::Grid)
+			{
+				delete root;
+				return {};
+			}
+		}
+
+		// Previewed draws would differ from the ones of the processed line and move the session stream
+		if (m_program.DrawsRandom(root))
+		{
+			delete root;
+			return {};
+		}
+
+		// Matrix values aren't cached, the whole line is evaluated
+		if (m_program.UsesMatrices(root))
+		{
+			Linear::Value value;
+			bool success = m_program.EvaluateLinear(root, value);
+			delete root;
+			return success ? Linear::ToString(value) : std::string();
+		}
+
+		Entry entry;
+		std::string key;
+		bool success = Evaluate(root, generation, entry, key);
+		delete root;
+
+		if (!success)
+			return {};
+		if (m_program.Digits())
+			return m_program.FormatPrecise(entry.precise);
+		return complex_to_string(entry.result.value);
+	}
+
+}
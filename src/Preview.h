@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Lexer.h"
+#include "Program.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace bcalc
+{
+
+	// Evaluates the line being typed on a worker thread for the live result preview of the TUI.
+	// Tokens of the unchanged prefix of the previous line are kept, and results of subtrees are cached until
+	// the program changes, so typing at the end of a line only evaluates what is new.
+	class Preview
+	{
+	public:
+		Preview(const Program& program);
+		~Preview();
+
+		Preview(const Preview&) = delete;
+		Preview& operator=(const Preview&) = delete;
+
+		// Requests a preview of 'line', superseding earlier requests. Doesn't wait for evaluation.
+		void Update(std::string_view line);
+
+		// Returns true if a preview of the newest line finished since the last call. 'text' is empty if the
+		// line has no value.
+		bool Poll(std::string& text);
+
+		// Must be held while the program is modified. Cancels the preview being evaluated.
+		std::unique_lock<std::mutex> LockProgram();
+
+	private:
+		struct Entry
+		{
+			CalcResult				result;
+			Multiprecision::Complex	precise;
+		};
+
+		void Run();
+
+		// Worker side, return false when evaluation fails or is superseded
+		bool Tokenize(std::string_view line);
+		bool Evaluate(const TokenNode* node, uint64_t generation, Entry& out, std::string& key);
+		std::string Process(std::string_view line, uint64_t generation);
+
+		bool Superseded(uint64_t generation) const { return m_generation.load(std::memory_order_relaxed) != generation; }
+
+	private:
+		const Program& m_program;
+
+		std::mutex				m_mutex;
+		std::condition_variable	m_condition;
+		std::string				m_request;
+		std::atomic<uint64_t>	m_generation	= 0; // of the newest request
+		std::atomic<bool>		m_cancel		= false; // set when the evaluated request is superseded
+		bool					m_pending		= false;
+		bool					m_finished		= false;
+		bool					m_stop			= false;
+		std::string				m_result;
+
+		// Held by the worker while it evaluates
+		std::mutex m_program_mutex;
+
+		// Worker state
+		std::string							m_line;
+		std::vector<Token>					m_tokens;
+		std::vector<Lexer::Span>			m_spans;
+		std::unordered_map<std::string, Entry>	m_cache;
+		uint64_t							m_cache_version = 0;
+		std::size_t							m_cache_digits	= 0;
+
+		std::thread m_worker;
+	};
+
+}
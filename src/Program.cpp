@@ -1,13 +1,28 @@
 #include "Program.h"
 
+#include "FastMath.h"
+#include "Interpreter.h"
 #include "Lexer.h"
+#include "Parallel.h"
 #include "Parser.h"
+#include "Random.h"
+#include "Statistics.h"
+#include "Workspace.h"
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
 
 namespace bcalc
 {
 
+	// Above this a single multiplication needs more memory than is reasonable
+	static constexpr std::size_t s_max_digits = 10'000'000;
+
+	// Bins of the histogram printed by ':stats'
+	static constexpr std::size_t s_histogram_bins = 10;
+
 	Program::Program()
 	{
 
@@ -16,18 +31,640 @@ namespace bcalc
 	Program::~Program()
 	{
 		for (auto& [_, overloads] : m_functions)
+		{
 			for (auto& [_, func] : overloads)
+			{
+				delete func.code;
 				delete func.expression;
+			}
+		}
+		for (auto& [_, expression] : m_bindings)
+			delete expression;
+		CloseTableOutput();
+	}
+
+	void Program::SetTableOutput(FILE* output, Table::Format format)
+	{
+		CloseTableOutput();
+		m_table_output = output;
+		m_table_format = format;
+	}
+
+	bool Program::OpenTableOutput(const std::string& path, Table::Format format)
+	{
+		if (path == "-")
+		{
+			SetTableOutput(stdout, format);
+			return true;
+		}
+
+		FILE* file = fopen(path.c_str(), format == Table::Format::Binary ? "wb" : "w");
+		if (!file)
+			return false;
+
+		SetTableOutput(file, format);
+		m_owns_table_output = true;
+		return true;
+	}
+
+	bool Program::SetPrecision(std::string_view text)
+	{
+		std::size_t digits = 0;
+		if (text != "off")
+		{
+			auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), digits);
+			if (ec != std::errc() || ptr != text.data() + text.size() || digits > s_max_digits)
+				return false;
+		}
+
+		m_digits = digits;
+		return true;
+	}
+
+	void Program::SetFastMath(bool enabled)
+	{
+		FastMath::SetEnabled(enabled);
+	}
+
+	CalcResult Program::Evaluate(const TokenNode* root, Multiprecision::Complex& precise) const
+	{
+		if (m_digits == 0)
+			return Interpreter::Evaluate(root, m_variables, m_functions);
+
+		if (!Multiprecision::Evaluate(root, m_digits, m_precise, m_variables, m_functions, precise))
+			return { .has_error = true };
+		return { .value = precise.ToComplex() };
+	}
+
+	bool Program::UsesMatrices(const TokenNode* root) const
+	{
+		return Linear::UsesMatrices(root, m_matrices, m_functions);
+	}
+
+	bool Program::EvaluateLinear(const TokenNode* root, Linear::Value& out) const
+	{
+		if (m_digits)
+			return false;
+		return Linear::Evaluate(root, m_variables, m_matrices, m_functions, out);
+	}
+
+	static bool DrawsRandom(const TokenNode* node, const FunctionList& functions, std::unordered_set<std::string>& visited)
+	{
+		const Token& token = node->GetToken();
+
+		if (token.Type() == TokenType::BuiltinFunction)
+		{
+			FunctionType function = token.GetBuiltinFunction();
+			if (function == FunctionType::Rand || function == FunctionType::Randn || function == FunctionType::McMean)
+				return true;
+		}
+
+		// Any overload, higher-order builtins name functions without calling them
+		if (token.Type() == TokenType::String && visited.insert(token.GetString()).second)
+			if (auto it = functions.find(token.GetString()); it != functions.end())
+				for (const auto& [_, overload] : it->second)
+					if (DrawsRandom(overload.expression, functions, visited))
+						return true;
+
+		for (const TokenNode* child : node->GetNodes())
+			if (DrawsRandom(child, functions, visited))
+				return true;
+
+		return false;
+	}
+
+	bool Program::DrawsRandom(const TokenNode* root) const
+	{
+		std::unordered_set<std::string> visited;
+		return bcalc::DrawsRandom(root, m_functions, visited);
+	}
+
+	void Program::SetSeed(uint64_t seed)
+	{
+		Random::SetSeed(seed);
+	}
+
+	void Program::Changed(const std::string& name)
+	{
+		m_name_versions[name] = ++m_name_counter;
+	}
+
+	void Program::CollectDependencies(const TokenNode* root, std::unordered_set<std::string>& names) const
+	{
+		std::unordered_set<std::string> identifiers;
+		root->CollectIdentifiers(identifiers);
+		for (const auto& name : identifiers)
+		{
+			if (!names.insert(name).second)
+				continue;
+			if (auto it = m_functions.find(name); it != m_functions.end())
+				for (const auto& [_, overload] : it->second)
+					CollectDependencies(overload.expression, names);
+		}
+	}
+
+	std::string Program::CacheKey(const std::vector<Token>& tokens) const
+	{
+		// Results depend on the engine too
+		std::string key = std::to_string(m_digits) + (FastMath::Enabled() ? " fast\n" : "\n");
+		return key + ResultCache::Key(tokens, m_digits != 0);
+	}
+
+	void Program::StoreVariable(const std::string& name, const CalcResult& result, const Multiprecision::Complex& precise)
+	{
+		Changed(name);
+		m_matrices.erase(name);
+		m_variables[name] = result.value;
+		if (m_digits)
+			m_precise[name] = precise;
+		else
+			m_precise.erase(name);
+	}
+
+	CalcResult Program::StoreValue(const std::string& name, Linear::Value& value)
+	{
+		if (!value.is_matrix)
+		{
+			StoreVariable(name, { .value = value.scalar }, {});
+			return { .value = value.scalar };
+		}
+
+		std::string text = Linear::ToString(value);
+		Changed(name);
+		m_variables.erase(name);
+		m_precise.erase(name);
+		m_matrices[name] = std::move(value.matrix);
+		return { .text = std::move(text) };
+	}
+
+	std::string Program::FormatPrecise(const Multiprecision::Complex& precise) const
+	{
+		if (m_digits == 0)
+			return {};
+		return Multiprecision::ToString(precise, m_digits);
+	}
+
+	void Program::CloseTableOutput()
+	{
+		if (m_owns_table_output)
+			fclose(m_table_output);
+		m_table_output = nullptr;
+		m_owns_table_output = false;
+	}
+
+	CalcResult Program::ProcessCommand(std::string_view command)
+	{
+		CalcResult error { .has_error = true };
+
+		std::vector<std::string_view> words;
+		for (std::size_t i = 0; i < command.size();)
+		{
+			if (isspace(command[i]))
+			{
+				i++;
+				continue;
+			}
+			std::size_t len = 0;
+			while (i + len < command.size() && !isspace(command[i + len]))
+				len++;
+			words.push_back(command.substr(i, len));
+			i += len;
+		}
+
+		if (words.empty())
+			return error;
+
+		// :output <file|-> [csv|binary]
+		if (words[0] == ":output")
+		{
+			if (words.size() != 2 && words.size() != 3)
+				return error;
+
+			Table::Format format = Table::Format::CSV;
+			if (words.size() == 3)
+			{
+				if (words[2] == "binary")
+					format = Table::Format::Binary;
+				else if (words[2] != "csv")
+					return error;
+			}
+
+			if (!OpenTableOutput(std::string(words[1]), format))
+				return error;
+			return { .has_value = false };
+		}
+
+		// :save <file>, :load <file>
+		if (words[0] == ":save" || words[0] == ":load")
+		{
+			if (words.size() != 2)
+				return error;
+
+			const std::string path(words[1]);
+			if (!(words[0] == ":save" ? SaveWorkspace(path) : LoadWorkspace(path)))
+				return error;
+			return { .has_value = false };
+		}
+
+		// :precision <digits|off>
+		if (words[0] == ":precision")
+		{
+			if (words.size() != 2 || !SetPrecision(words[1]))
+				return error;
+			return { .has_value = false };
+		}
+
+		// :stats <file> [csv|binary] <column>[,<column>...] <expression>
+		if (words[0] == ":stats")
+			return ProcessStatistics(command, words);
+
+		// :seed [<seed>], the current seed is the value without one
+		if (words[0] == ":seed")
+		{
+			if (words.size() == 1)
+				return { .value = static_cast<value_type>(Random::Seed()), .text = std::to_string(Random::Seed()) };
+			if (words.size() != 2)
+				return error;
+
+			uint64_t seed = 0;
+			auto [ptr, ec] = std::from_chars(words[1].data(), words[1].data() + words[1].size(), seed);
+			if (ec != std::errc() || ptr != words[1].data() + words[1].size())
+				return error;
+
+			SetSeed(seed);
+			return { .has_value = false };
+		}
+
+		// :fastmath <on|off>
+		if (words[0] == ":fastmath")
+		{
+			if (words.size() != 2 || (words[1] != "on" && words[1] != "off"))
+				return error;
+
+			SetFastMath(words[1] == "on");
+			return { .has_value = false };
+		}
+
+		return error;
+	}
+
+	CalcResult Program::ProcessTable(const TokenNode* root)
+	{
+		CalcResult error { .has_error = true };
+
+		if (!m_table_output)
+			return error;
+
+		const auto& nodes = root->GetNodes();
+		if (nodes.empty() || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return error;
+
+		std::vector<value_type> inputs;
+		for (std::size_t i = 1; i < nodes.size(); i++)
+		{
+			auto result = nodes[i]->approximate(m_variables, m_functions);
+			if (result.has_error || result.value.imag() != 0)
+				return error;
+			inputs.push_back(result.value.real());
+		}
+
+		// Sample counts must be positive integers of at most Table::s_max_rows, which also keeps 'nx * ny' from
+		// overflowing. NaN fails the comparisons.
+		auto is_count = [](value_type value) { return value >= 1 && value <= Table::s_max_rows && value == std::round(value); };
+
+		const std::string name = nodes[0]->GetToken().GetString();
+		if (root->GetToken().GetBuiltinFunction() == FunctionType::Table)
+		{
+			// table(f, a, b, n)
+			const UserFunction* function = FindFunction(m_functions, name, 1);
+			if (!function || inputs.size() != 3 || !is_count(inputs[2]))
+				return error;
+			if (!Table::Write(m_table_output, m_table_format, *function, inputs[0], inputs[1], static_cast<uint64_t>(inputs[2]), m_variables, m_functions))
+				return error;
+		}
+		else
+		{
+			// grid(f, x0, x1, nx, y0, y1, ny)
+			const UserFunction* function = FindFunction(m_functions, name, 2);
+			if (!function || inputs.size() != 6 || !is_count(inputs[2]) || !is_count(inputs[5]))
+				return error;
+			if (static_cast<uint64_t>(inputs[2]) > Table::s_max_rows / static_cast<uint64_t>(inputs[5]))
+				return error;
+			if (!Table::WriteGrid(m_table_output, m_table_format, *function, inputs[0], inputs[1], static_cast<uint64_t>(inputs[2]), inputs[3], inputs[4], static_cast<uint64_t>(inputs[5]), m_variables, m_functions))
+				return error;
+		}
+
+		return { .has_value = false };
+	}
+
+	CalcResult Program::ProcessStatistics(std::string_view command, const std::vector<std::string_view>& words)
+	{
+		CalcResult error { .has_error = true };
+
+		std::size_t next = 2;
+		Table::Format format = Table::Format::CSV;
+		if (words.size() > next && (words[next] == "csv" || words[next] == "binary"))
+			format = words[next++] == "binary" ? Table::Format::Binary : Table::Format::CSV;
+		if (words.size() < next + 2)
+			return error;
+
+		// Columns are bound to the parameters of the expression in order
+		std::vector<std::string> columns;
+		for (std::string_view names = words[next]; !names.empty();)
+		{
+			std::size_t comma = std::min(names.find(','), names.size());
+			auto tokens = Lexer::Tokenize(names.substr(0, comma));
+			if (tokens.size() != 1 || tokens[0].Type() != TokenType::String)
+				return error;
+			columns.push_back(tokens[0].GetString());
+			names.remove_prefix(std::min(comma + 1, names.size()));
+		}
+
+		// The expression is the rest of the line, spaces included
+		auto tokens = Lexer::Tokenize(command.substr(words[next + 1].data() - command.data()));
+		if (tokens.empty())
+			return error;
+
+		TokenNode* root = Parser::BuildTokenTree(tokens.begin(), tokens.end());
+		if (!root)
+			return error;
+
+		UserFunction function { .parameters = columns, .expression = root, .code = Compile(root, columns) };
+		if (!function.code)
+		{
+			delete root;
+			return error;
+		}
+
+		Statistics::Summary summary;
+		bool success = Statistics::Stream(std::string(words[1]), format, function, m_variables, m_functions, summary);
+		delete function.code;
+		delete root;
+
+		if (!success)
+			return error;
+		return { .value = summary.moments.mean, .text = Statistics::ToString(summary, s_histogram_bins) };
+	}
+
+	void Program::RemoveBinding(const std::string& name)
+	{
+		auto it = m_bindings.find(name);
+		if (it == m_bindings.end())
+			return;
+		delete it->second;
+		m_bindings.erase(it);
+		m_dependencies.Remove(name);
+	}
+
+	// Adds the identifiers 'expression' reads besides 'parameters' to 'out'
+	static void CollectFreeIdentifiers(const TokenNode* expression, const std::vector<std::string>& parameters, std::unordered_set<std::string>& out)
+	{
+		std::unordered_set<std::string> identifiers;
+		expression->CollectIdentifiers(identifiers);
+		for (const auto& parameter : parameters)
+			identifiers.erase(parameter);
+		out.merge(identifiers);
+	}
+
+	void Program::SetFunctionDependencies(const std::string& name)
+	{
+		std::unordered_set<std::string> dependencies;
+		for (const auto& [_, overload] : m_functions[name])
+			CollectFreeIdentifiers(overload.expression, overload.parameters, dependencies);
+		m_dependencies.SetDependencies(name, std::move(dependencies));
+	}
+
+	bool Program::WouldCycleBinding(const std::string& name, const std::unordered_set<std::string>& dependencies) const
+	{
+		// Functions may recurse, only cycles through a binding can't be evaluated
+		for (const auto& level : m_dependencies.Dependents(name))
+			for (const auto& dependent : level)
+				if (m_bindings.contains(dependent) && m_dependencies.WouldCycle(dependent, dependencies))
+					return true;
+		return false;
+	}
+
+	bool Program::SaveWorkspace(const std::string& path) const
+	{
+		return Workspace::Save(path, m_variables, m_matrices, m_functions, m_bindings);
+	}
+
+	bool Program::LoadWorkspace(const std::string& path)
+	{
+		Workspace::Definitions definitions;
+		if (!Workspace::Load(path, definitions))
+			return false;
+
+		// Everything is compiled before the session is touched, so a bad function leaves it unchanged
+		std::vector<Bytecode*> code(definitions.functions.size());
+		for (std::size_t i = 0; i < definitions.functions.size(); i++)
+		{
+			const auto& function = definitions.functions[i];
+			if (!(code[i] = Compile(function.expression, function.parameters)))
+			{
+				for (Bytecode* bytecode : code)
+					delete bytecode;
+				Workspace::Free(definitions);
+				return false;
+			}
+		}
+
+		// Values of loaded bindings are stored with them, only definitions already in the session
+		// may have to be recomputed
+		const bool had_bindings = !m_bindings.empty();
+		std::vector<std::string> changed;
+
+		for (auto& [name, value] : definitions.variables)
+		{
+			RemoveBinding(name);
+			Changed(name);
+			m_variables[name] = value;
+			m_precise.erase(name);
+			m_matrices.erase(name);
+			changed.push_back(name);
+		}
+
+		for (auto& [name, matrix] : definitions.matrices)
+		{
+			RemoveBinding(name);
+			Changed(name);
+			m_variables.erase(name);
+			m_precise.erase(name);
+			m_matrices[name] = std::move(matrix);
+			changed.push_back(name);
+		}
+
+		std::unordered_set<std::string> function_names;
+		for (std::size_t i = 0; i < definitions.functions.size(); i++)
+		{
+			auto& function = definitions.functions[i];
+			auto& overloads = m_functions[function.name];
+
+			std::size_t param_count = function.parameters.size();
+			if (auto it = overloads.find(param_count); it != overloads.end())
+			{
+				delete it->second.code;
+				delete it->second.expression;
+			}
+			overloads[param_count] = {
+				.parameters = std::move(function.parameters),
+				.expression = function.expression,
+				.code = code[i]
+			};
+			function_names.insert(function.name);
+		}
+		for (const auto& name : function_names)
+		{
+			Changed(name);
+			SetFunctionDependencies(name);
+			changed.push_back(name);
+		}
+
+		// Loaded functions can close a cycle through a binding of the session, such a binding keeps just its value
+		for (const auto& name : function_names)
+		{
+			for (const auto& level : m_dependencies.Dependents(name))
+			{
+				for (const auto& dependent : level)
+				{
+					auto it = m_bindings.find(dependent);
+					if (it == m_bindings.end())
+						continue;
+
+					std::unordered_set<std::string> dependencies;
+					it->second->CollectIdentifiers(dependencies);
+					m_dependencies.Remove(dependent);
+					if (m_dependencies.WouldCycle(dependent, dependencies))
+						RemoveBinding(dependent);
+					else
+						m_dependencies.SetDependencies(dependent, std::move(dependencies));
+				}
+			}
+		}
+
+		for (auto& binding : definitions.bindings)
+		{
+			std::unordered_set<std::string> dependencies;
+			binding.expression->CollectIdentifiers(dependencies);
+
+			// Merging into a session can close a cycle, such a binding keeps just its value
+			if (m_dependencies.WouldCycle(binding.name, dependencies))
+			{
+				delete binding.expression;
+				continue;
+			}
+
+			RemoveBinding(binding.name);
+			m_bindings[binding.name] = binding.expression;
+			m_dependencies.SetDependencies(binding.name, std::move(dependencies));
+		}
+
+		if (had_bindings)
+			for (const auto& name : changed)
+				UpdateDependents(name);
+
+		return true;
+	}
+
+	void Program::UpdateDependents(const std::string& name)
+	{
+		for (const auto& level : m_dependencies.Dependents(name))
+		{
+			std::vector<std::pair<const std::string*, const TokenNode*>> dirty;
+			for (const auto& dependent : level)
+				if (auto it = m_bindings.find(dependent); it != m_bindings.end())
+					dirty.emplace_back(&it->first, it->second);
+
+			// Bindings within one level are independent of each other
+			std::vector<CalcResult> results(dirty.size());
+			std::vector<Multiprecision::Complex> precise(dirty.size());
+			ParallelFor(dirty.size(), 64, [&](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; i++)
+					results[i] = Evaluate(dirty[i].second, precise[i]);
+			});
+
+			for (std::size_t i = 0; i < dirty.size(); i++)
+			{
+				if (results[i].has_error)
+				{
+					Changed(*dirty[i].first);
+					m_variables.erase(*dirty[i].first);
+					m_precise.erase(*dirty[i].first);
+				}
+				else
+					StoreVariable(*dirty[i].first, results[i], precise[i]);
+			}
+		}
 	}
 
 	CalcResult Program::Process(std::string_view input)
+	{
+		m_version++;
+
+		Cancellation cancellation(m_budget, m_cancel);
+		auto result = ProcessLine(input);
+		if (result.has_error)
+			result.stop = cancellation.Reason();
+		return result;
+	}
+
+	CalcResult Program::ProcessLine(std::string_view input)
 	{
 		CalcResult error { .has_error = true };
 
+		if (auto first = input.find_first_not_of(" \t"); first != std::string_view::npos && input[first] == ':')
+			return ProcessCommand(input.substr(first));
+
 		auto tokens = Lexer::Tokenize(input);
 		if (tokens.empty())
 			return error;
 
+		// Reactive binding
+		if (auto bind_it = std::find_if(tokens.begin(), tokens.end(), [](const auto& token) { return token.Type() == TokenType::Bind; }); bind_it != tokens.end())
+		{
+			if (tokens.size() <= 2 || tokens.front().Type() != TokenType::String || bind_it != tokens.begin() + 1)
+				return error;
+			if (std::any_of(tokens.begin(), tokens.end(), [](const auto& token) { return token.Type() == TokenType::Equals; }))
+				return error;
+
+			TokenNode* root = Parser::BuildTokenTree(bind_it + 1, tokens.end());
+			if (!root)
+				return error;
+
+			// Bindings hold scalars
+			if (UsesMatrices(root))
+			{
+				delete root;
+				return error;
+			}
+
+			const std::string name = tokens[0].GetString();
+
+			std::unordered_set<std::string> dependencies;
+			root->CollectIdentifiers(dependencies);
+			if (m_dependencies.WouldCycle(name, dependencies))
+			{
+				delete root;
+				return error;
+			}
+
+			Multiprecision::Complex precise;
+			auto result = Evaluate(root, precise);
+			if (result.has_error)
+			{
+				delete root;
+				return error;
+			}
+
+			RemoveBinding(name);
+			m_bindings[name] = root;
+			m_dependencies.SetDependencies(name, std::move(dependencies));
+
+			StoreVariable(name, result, precise);
+			UpdateDependents(name);
+			return { .value = result.value, .text = FormatPrecise(precise) };
+		}
+
 		// Assignment
 		if (auto eq_it = std::find_if(tokens.begin(), tokens.end(), [](const auto& token) { return token.Type() == TokenType::Equals; }); eq_it != tokens.end())
 		{
@@ -40,15 +677,35 @@ namespace bcalc
 				TokenNode* root = Parser::BuildTokenTree(eq_it + 1, tokens.end());
 				if (!root)
 					return error;
+
+				const std::string name = tokens[0].GetString();
+
+				if (UsesMatrices(root))
+				{
+					Linear::Value value;
+					bool success = EvaluateLinear(root, value);
+					delete root;
+
+					if (!success)
+						return error;
+
+					RemoveBinding(name);
+					auto result = StoreValue(name, value);
+					UpdateDependents(name);
+					return result;
+				}
 				
-				auto result = root->approximate(m_variables, m_functions);
+				Multiprecision::Complex precise;
+				auto result = Evaluate(root, precise);
 				delete root;
 
 				if (result.has_error)
 					return error;
-				
-				m_variables[tokens[0].GetString()] = result.value;
-				return { .value = result.value };
+
+				RemoveBinding(name);
+				StoreVariable(name, result, precise);
+				UpdateDependents(name);
+				return { .value = result.value, .text = FormatPrecise(precise) };
 			}
 			// Function
 			else
@@ -81,31 +738,129 @@ namespace bcalc
 				if (!root)
 					return error;
 
+				Bytecode* code = Compile(root, parameters);
+				if (!code)
+				{
+					delete root;
+					return error;
+				}
+
+				const std::string name = tokens[0].GetString();
 				std::size_t param_count = parameters.size();
-				m_functions[tokens[0].GetString()][param_count] = {
+
+				// Bindings reading the function can't be read by it
+				std::unordered_set<std::string> dependencies;
+				CollectFreeIdentifiers(root, parameters, dependencies);
+				if (auto it = m_functions.find(name); it != m_functions.end())
+					for (const auto& [count, overload] : it->second)
+						if (count != param_count)
+							CollectFreeIdentifiers(overload.expression, overload.parameters, dependencies);
+				if (WouldCycleBinding(name, dependencies))
+				{
+					delete code;
+					delete root;
+					return error;
+				}
+
+				auto& overloads = m_functions[name];
+				if (auto it = overloads.find(param_count); it != overloads.end())
+				{
+					delete it->second.code;
+					delete it->second.expression;
+				}
+				overloads[param_count] = {
 					.parameters = std::move(parameters),
-					.expression = root
+					.expression = root,
+					.code = code
 				};
 
+				Changed(name);
+				SetFunctionDependencies(name);
+				UpdateDependents(name);
+
 				return { .has_value = false };
 			}
 		}
 		// Expression
 		else
 		{
+			// Lines seen before skip parsing and evaluation while nothing they read has changed
+			std::string cache_key;
+			if (m_result_cache.Capacity())
+			{
+				cache_key = CacheKey(tokens);
+				if (const ResultCache::Entry* entry = m_result_cache.Find(cache_key, m_name_versions))
+				{
+					if (entry->result.has_error)
+						return error;
+
+					CalcResult result = entry->result;
+					StoreVariable("ans", result, entry->precise);
+					UpdateDependents("ans");
+					return result;
+				}
+			}
+
 			TokenNode* root = Parser::BuildTokenTree(tokens.begin(), tokens.end());
 			if (!root)
 				return error;
+
+			// Table output commands
+			if (root->GetToken().Type() == TokenType::BuiltinFunction)
+			{
+				FunctionType function = root->GetToken().GetBuiltinFunction();
+				if (function == FunctionType::Table || function == FunctionType::Grid)
+				{
+					auto result = ProcessTable(root);
+					delete root;
+					return result;
+				}
+			}
+
+			if (UsesMatrices(root))
+			{
+				Linear::Value value;
+				bool success = EvaluateLinear(root, value);
+				delete root;
+
+				if (!success)
+					return error;
+
+				auto result = StoreValue("ans", value);
+				UpdateDependents("ans");
+				return result;
+			}
 			
-			auto result = root->approximate(m_variables, m_functions);
+			Multiprecision::Complex precise;
+			auto result = Evaluate(root, precise);
+
+			// Evaluations stopped by the budget could succeed another time, random ones differ every time
+			if (!cache_key.empty() && !Cancellation::Stopped() && !DrawsRandom(root))
+			{
+				ResultCache::Entry entry {
+					.result = result.has_error ? error : CalcResult { .value = result.value, .text = FormatPrecise(precise) },
+					.precise = precise
+				};
+
+				std::unordered_set<std::string> dependencies;
+				CollectDependencies(root, dependencies);
+				for (const auto& name : dependencies)
+				{
+					auto it = m_name_versions.find(name);
+					entry.dependencies.emplace_back(name, it == m_name_versions.end() ? 0 : it->second);
+				}
+
+				m_result_cache.Insert(cache_key, std::move(entry));
+			}
 			delete root;
 
 			if (result.has_error)
 				return error;
 			
-			m_variables["ans"] = result.value;
+			StoreVariable("ans", result, precise);
+			UpdateDependents("ans");
 
-			return { .value = result.value };
+			return { .value = result.value, .text = FormatPrecise(precise) };
 		}
 	}
 
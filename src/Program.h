@@ -1,5 +1,10 @@
 #pragma once
 
+#include "DependencyGraph.h"
+#include "Linear.h"
+#include "Multiprecision.h"
+#include "ResultCache.h"
+#include "Table.h"
 #include "TokenNode.h"
 
 namespace bcalc
@@ -11,11 +16,113 @@ namespace bcalc
 		Program();
 		~Program();
 
+		// Processes one line within the budget, 'stop' of the result tells why an evaluation was cut short
 		CalcResult Process(std::string_view input);
 
+		// Limits of each line given to 'Process()'
+		void SetBudget(const Budget& budget) { m_budget = budget; }
+		// Setting 'cancel' from any thread or a signal handler stops the line being processed
+		void SetCancelFlag(const std::atomic<bool>* cancel) { m_cancel = cancel; }
+
+		// Sets where 'table' and 'grid' stream their rows. Null disables them until ':output' is used.
+		void SetTableOutput(FILE* output, Table::Format format);
+		// Opens 'path' for table output, "-" selects stdout.
+		bool OpenTableOutput(const std::string& path, Table::Format format);
+
+		// Writes variables, functions and bindings to a workspace file, see Workspace.h
+		bool SaveWorkspace(const std::string& path) const;
+		// Adds the definitions of a workspace file to the session, replacing ones with the same names.
+		// Nothing is changed if the file can't be loaded.
+		bool LoadWorkspace(const std::string& path);
+
+		// Evaluates with 'digits' significant digits from now on, "off" or 0 returns to long double.
+		// Returns false and changes nothing if 'digits' isn't a number of at most 10 million or "off".
+		bool SetPrecision(std::string_view digits);
+		std::size_t Digits() const { return m_digits; }
+
+		// Evaluates real arguments of common builtins with the double precision kernels of FastMath.h,
+		// and tables of simple functions in batches. Applies to every program of the process.
+		void SetFastMath(bool enabled);
+
+		// Evaluates with the active engine, 'precise' receives the full result in multi-precision mode.
+		// Doesn't modify the session, so it may run concurrently with other evaluations but not with 'Process()'.
+		CalcResult Evaluate(const TokenNode* root, Multiprecision::Complex& precise) const;
+		std::string FormatPrecise(const Multiprecision::Complex& precise) const;
+
+		// Returns true if 'root' needs 'EvaluateLinear()', see Linear::UsesMatrices()
+		bool UsesMatrices(const TokenNode* root) const;
+		// Evaluates 'root' with matrix values, fails in multi-precision mode. Same concurrency as 'Evaluate()'.
+		bool EvaluateLinear(const TokenNode* root, Linear::Value& out) const;
+
+		// Returns true if evaluating 'root' draws random numbers, directly or in the user functions it calls
+		bool DrawsRandom(const TokenNode* root) const;
+
+		// Seeds 'rand()', 'randn()' and 'mc_mean()' of every program of the process, see Random.h
+		void SetSeed(uint64_t seed);
+
+		// Keeps results of up to 'entries' expression lines, so repeated lines skip parsing and evaluation while
+		// nothing they read changes. Zero disables the cache, which is the default.
+		void SetResultCacheCapacity(std::size_t entries) { m_result_cache.SetCapacity(entries); }
+		const ResultCache::Statistics& ResultCacheStats() const { return m_result_cache.Stats(); }
+
+		// Changes whenever 'Process()' may have changed variables, functions or settings
+		uint64_t Version() const { return m_version; }
+
+	private:
+		CalcResult ProcessLine(std::string_view input);
+		// Handles lines starting with ':'
+		CalcResult ProcessCommand(std::string_view command);
+		CalcResult ProcessTable(const TokenNode* root);
+		// ':stats', 'words' are the words of 'command'
+		CalcResult ProcessStatistics(std::string_view command, const std::vector<std::string_view>& words);
+		void CloseTableOutput();
+
+		void StoreVariable(const std::string& name, const CalcResult& result, const Multiprecision::Complex& precise);
+		// Stores a result of 'EvaluateLinear()', returns what 'Process()' reports for it
+		CalcResult StoreValue(const std::string& name, Linear::Value& value);
+
+		// Marks the value or definition of 'name' as changed for the result cache
+		void Changed(const std::string& name);
+		// Collects the names 'root' reads, including everything read by the user functions it calls
+		void CollectDependencies(const TokenNode* root, std::unordered_set<std::string>& names) const;
+		std::string CacheKey(const std::vector<Token>& tokens) const;
+
+		void RemoveBinding(const std::string& name);
+		// Makes 'name' depend on the free identifiers of all of its overloads
+		void SetFunctionDependencies(const std::string& name);
+		// Returns true if function 'name' reading 'dependencies' would make a binding depend on itself
+		bool WouldCycleBinding(const std::string& name, const std::unordered_set<std::string>& dependencies) const;
+
+		// Recomputes every binding that (transitively) reads 'name'.
+		void UpdateDependents(const std::string& name);
+
 	private:
 		VariableList m_variables;
 		FunctionList m_functions;
+		// Variables holding vectors and matrices, a name is never in both lists
+		Linear::MatrixList m_matrices;
+
+		// Reactive bindings created with 'name := expression'
+		std::unordered_map<std::string, TokenNode*> m_bindings;
+		DependencyGraph m_dependencies;
+
+		uint64_t m_version = 0;
+
+		Budget						m_budget;
+		const std::atomic<bool>*	m_cancel	= nullptr;
+
+		// Significant digits of multi-precision mode, 0 when evaluating in long double
+		std::size_t m_digits = 0;
+		// Full precision values of variables written in multi-precision mode, 'm_variables' holds them rounded
+		Multiprecision::VariableList m_precise;
+
+		ResultCache				m_result_cache;
+		ResultCache::Versions	m_name_versions;
+		uint64_t				m_name_counter = 0;
+
+		FILE*			m_table_output			= stdout;
+		Table::Format	m_table_format			= Table::Format::CSV;
+		bool			m_owns_table_output		= false;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "Quadrature.h"
+
+#include "Parallel.h"
+#include "Summation.h"
+
+#include <atomic>
+#include <limits>
+#include <queue>
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+
+	// The path is always split into the same number of pieces so results don't depend on the number of threads
+	static constexpr std::size_t s_pieces = 16;
+
+	// Maximum number of bisections for every piece of the path
+	static constexpr std::size_t s_max_subdivisions = 2000;
+
+	// Non-negative Kronrod nodes on [-1, 1], odd indices are the 7 point Gauss nodes
+	static constexpr value_type s_kronrod_nodes[8] {
+		0.991455371120812639206854697526329L,
+		0.949107912342758524526189684047851L,
+		0.864864423359769072789712788640926L,
+		0.741531185599394439863864773280788L,
+		0.586087235467691130294144845693013L,
+		0.405845151377397166906606412076961L,
+		0.207784955007898467600689403773245L,
+		0.000000000000000000000000000000000L,
+	};
+
+	static constexpr value_type s_kronrod_weights[8] {
+		0.022935322010529224963732008058970L,
+		0.063092092629978553290700663189204L,
+		0.104790010322250183839876322541518L,
+		0.140653259715525918745189590510238L,
+		0.169004726639267902826583426598550L,
+		0.190350578064785409913256402421014L,
+		0.204432940075298892414161999234649L,
+		0.209482141084727828012999174891714L,
+	};
+
+	static constexpr value_type s_gauss_weights[4] {
+		0.129484966168869693270611432679082L,
+		0.279705391489276667901467771423780L,
+		0.381830050505118944950369775488975L,
+		0.417959183673469387755102040816327L,
+	};
+
+	struct Segment
+	{
+		value_type	begin;
+		value_type	end;
+		complex		value;
+		value_type	error;
+
+		bool operator<(const Segment& other) const { return error < other.error; }
+	};
+
+	// Integrates 'function(a + t * (b - a)) * (b - a)' over t in [begin, end]
+	static bool GaussKronrod(const UserFunction& function, const complex& a, const complex& b, value_type begin, value_type end, const VariableList& variables, const FunctionList& functions, Segment& segment)
+	{
+		value_type center = (begin + end) / 2;
+		value_type half = (end - begin) / 2;
+
+		complex kronrod = 0;
+		complex gauss = 0;
+
+		for (int i = 0; i < 8; i++)
+		{
+			value_type offsets[2] { -s_kronrod_nodes[i], s_kronrod_nodes[i] };
+			for (int j = 0; j < (i == 7 ? 1 : 2); j++)
+			{
+				value_type t = center + half * offsets[j];
+				auto result = Invoke(function, { a + t * (b - a) }, variables, functions);
+				if (result.has_error)
+					return false;
+
+				kronrod += s_kronrod_weights[i] * result.value;
+				if (i % 2 == 1)
+					gauss += s_gauss_weights[i / 2] * result.value;
+			}
+		}
+
+		complex scale = half * (b - a);
+		segment = {
+			.begin	= begin,
+			.end	= end,
+			.value	= kronrod * scale,
+			.error	= std::abs((kronrod - gauss) * scale),
+		};
+		return true;
+	}
+
+	static bool Adaptive(const UserFunction& function, const complex& a, const complex& b, value_type begin, value_type end, value_type tolerance, const VariableList& variables, const FunctionList& functions, CompensatedSum& sum)
+	{
+		Segment initial;
+		if (!GaussKronrod(function, a, b, begin, end, variables, functions, initial))
+			return false;
+
+		std::priority_queue<Segment> segments;
+		segments.push(initial);
+
+		complex value = initial.value;
+		value_type error = initial.error;
+
+		for (std::size_t i = 0; i < s_max_subdivisions; i++)
+		{
+			value_type relative = 64 * std::numeric_limits<value_type>::epsilon() * std::abs(value);
+			if (error <= std::max(tolerance, relative))
+				break;
+
+			Segment worst = segments.top();
+			value_type middle = (worst.begin + worst.end) / 2;
+			if (middle <= worst.begin || middle >= worst.end)
+				break;
+
+			Segment left, right;
+			if (!GaussKronrod(function, a, b, worst.begin, middle, variables, functions, left))
+				return false;
+			if (!GaussKronrod(function, a, b, middle, worst.end, variables, functions, right))
+				return false;
+
+			segments.pop();
+			segments.push(left);
+			segments.push(right);
+
+			value += left.value + right.value - worst.value;
+			error += left.error + right.error - worst.error;
+		}
+
+		// Sum the final segments with compensation instead of using the running estimate
+		while (!segments.empty())
+		{
+			sum.Add(segments.top().value);
+			segments.pop();
+		}
+
+		return true;
+	}
+
+	CalcResult Quadrature::Integrate(const UserFunction& function, complex a, complex b, value_type tolerance, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (function.parameters.size() != 1 || !(tolerance > 0))
+			return error;
+		if (a == b)
+			return { .value = 0 };
+
+		std::vector<CompensatedSum> partials(s_pieces);
+		std::atomic<bool> failed = false;
+
+		ParallelFor(s_pieces, 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end && !failed; i++)
+			{
+				value_type piece_begin = static_cast<value_type>(i) / s_pieces;
+				value_type piece_end = static_cast<value_type>(i + 1) / s_pieces;
+				if (!Adaptive(function, a, b, piece_begin, piece_end, tolerance / s_pieces, variables, functions, partials[i]))
+					failed = true;
+			}
+		});
+
+		if (failed)
+			return error;
+
+		CompensatedSum total;
+		for (const auto& partial : partials)
+			total.Add(partial);
+		return { .value = total.Result() };
+	}
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "TokenNode.h"
+
+namespace bcalc::Quadrature
+{
+
+	static constexpr value_type s_default_tolerance = 1e-12;
+
+	// Integral of a single parameter 'function' along the straight line from 'a' to 'b' using adaptive 15 point
+	// Gauss-Kronrod quadrature. The path is split into fixed pieces which are refined independently on separate threads
+	// until the estimated absolute error is below 'tolerance'.
+	CalcResult Integrate(const UserFunction& function, std::complex<value_type> a, std::complex<value_type> b, value_type tolerance, const VariableList& variables, const FunctionList& functions);
+
+}
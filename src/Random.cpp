@@ -0,0 +1,112 @@
+#include "Random.h"
+
+#include <atomic>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+namespace bcalc::Random
+{
+
+	static std::atomic<uint64_t> s_seed			= std::random_device{}() | (uint64_t(std::random_device{}()) << 32);
+	static std::atomic<uint64_t> s_runs			= 0; // the session stream is run 0
+	static std::atomic<uint64_t> s_session_draws	= 0;
+
+	// Bijective 64 bit mixer (SplitMix64 finalizer), spreads seeds and runs over the whole key space
+	static uint64_t Mix(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EB;
+		x ^= x >> 31;
+		return x;
+	}
+
+	static uint64_t Key(uint64_t run)
+	{
+		return Mix(s_seed.load(std::memory_order_relaxed) + run * 0x9E3779B97F4A7C15);
+	}
+
+	// Philox4x32-10 of Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"
+	static void Philox(uint64_t key, uint64_t draw, uint64_t sample, uint64_t out[2])
+	{
+		constexpr uint32_t s_multiplier[2]	{ 0xD2511F53, 0xCD9E8D57 };
+		constexpr uint32_t s_weyl[2]		{ 0x9E3779B9, 0xBB67AE85 };
+
+		uint32_t counter[4] { uint32_t(draw), uint32_t(draw >> 32), uint32_t(sample), uint32_t(sample >> 32) };
+		uint32_t k[2] { uint32_t(key), uint32_t(key >> 32) };
+
+		for (int round = 0; round < 10; round++)
+		{
+			const uint64_t product0 = uint64_t(s_multiplier[0]) * counter[0];
+			const uint64_t product1 = uint64_t(s_multiplier[1]) * counter[2];
+			counter[0] = uint32_t(product1 >> 32) ^ counter[1] ^ k[0];
+			counter[1] = uint32_t(product1);
+			counter[2] = uint32_t(product0 >> 32) ^ counter[3] ^ k[1];
+			counter[3] = uint32_t(product0);
+			k[0] += s_weyl[0];
+			k[1] += s_weyl[1];
+		}
+
+		out[0] = counter[0] | (uint64_t(counter[1]) << 32);
+		out[1] = counter[2] | (uint64_t(counter[3]) << 32);
+	}
+
+	void SetSeed(uint64_t seed)
+	{
+		s_seed = seed;
+		s_runs = 0;
+		s_session_draws = 0;
+	}
+
+	uint64_t Seed()
+	{
+		return s_seed;
+	}
+
+	uint64_t NewRun()
+	{
+		return ++s_runs;
+	}
+
+	Stream::Stream(uint64_t run, uint64_t sample)
+		: m_key(Key(run))
+		, m_sample(sample)
+		, m_previous(s_current)
+	{
+		s_current = this;
+	}
+
+	Stream::~Stream()
+	{
+		s_current = m_previous;
+	}
+
+	void Stream::Next(uint64_t out[2])
+	{
+		if (Stream* current = s_current)
+			Philox(current->m_key, current->m_draws++, current->m_sample, out);
+		else
+			Philox(Key(0), s_session_draws++, 0, out);
+	}
+
+	value_type Uniform()
+	{
+		uint64_t bits[2];
+		Stream::Next(bits);
+		// Exact in the 64 bit mantissa of long double, so never rounds up to 1
+		return std::ldexp(static_cast<value_type>(bits[0]), -64);
+	}
+
+	value_type Normal()
+	{
+		// Box-Muller from both halves of one draw, the first in (0, 1] for the logarithm
+		uint64_t bits[2];
+		Stream::Next(bits);
+		const value_type u1 = std::ldexp(static_cast<value_type>(bits[0]) + 1, -64);
+		const value_type u2 = std::ldexp(static_cast<value_type>(bits[1]), -64);
+		return std::sqrt(-2 * std::log(u1)) * std::cos(2 * std::numbers::pi_v<value_type> * u2);
+	}
+
+}
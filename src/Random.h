@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Token.h"
+
+#include <cstdint>
+
+namespace bcalc::Random
+{
+
+	// Random numbers of 'rand()' and 'randn()' come from the counter-based generator Philox4x32-10: draw d
+	// of a stream is a pure function of the seed, the stream and d, so no generator state is shared between
+	// threads and a stream gives the same numbers whichever thread draws them.
+	//
+	// Draws outside of a 'Stream' come from the session stream in the order they are made. Builtins that
+	// evaluate user functions on several threads don't order them, only 'mc_mean()' is reproducible there.
+
+	// Process wide, set through 'Program::SetSeed()'. Restarts the session stream and the numbering of runs,
+	// so everything drawn after setting the same seed is drawn again.
+	void SetSeed(uint64_t seed);
+	uint64_t Seed();
+
+	// Uniform in [0, 1)
+	value_type Uniform();
+	// Standard normal
+	value_type Normal();
+
+	// Number of a new independent family of streams, one per call of a sampling builtin
+	uint64_t NewRun();
+
+	// Makes stream 'sample' of run 'run' current on the calling thread for the lifetime of the object,
+	// starting from its first draw
+	class Stream
+	{
+	public:
+		Stream(uint64_t run, uint64_t sample);
+		~Stream();
+
+		Stream(const Stream&) = delete;
+		Stream& operator=(const Stream&) = delete;
+
+	private:
+		// Next 128 random bits of the current stream of the calling thread
+		static void Next(uint64_t out[2]);
+		friend value_type Uniform();
+		friend value_type Normal();
+
+	private:
+		static inline thread_local Stream* s_current = nullptr;
+
+		uint64_t	m_key;
+		uint64_t	m_sample;
+		uint64_t	m_draws = 0;
+
+		Stream*		m_previous;
+	};
+
+}
@@ -0,0 +1,123 @@
+#include "ResultCache.h"
+
+#include <cmath>
+
+namespace bcalc
+{
+
+	void ResultCache::SetCapacity(std::size_t capacity)
+	{
+		m_capacity = capacity;
+		while (m_entries.size() > m_capacity)
+		{
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+			m_stats.evictions++;
+		}
+	}
+
+	const ResultCache::Entry* ResultCache::Find(const std::string& key, const Versions& versions)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+		{
+			m_stats.misses++;
+			return nullptr;
+		}
+
+		const Entry& entry = it->second->second;
+		for (const auto& [name, version] : entry.dependencies)
+		{
+			auto version_it = versions.find(name);
+			if ((version_it == versions.end() ? 0 : version_it->second) != version)
+			{
+				m_entries.erase(it->second);
+				m_index.erase(it);
+				m_stats.misses++;
+				m_stats.stale++;
+				return nullptr;
+			}
+		}
+
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		m_stats.hits++;
+		return &entry;
+	}
+
+	void ResultCache::Insert(const std::string& key, Entry entry)
+	{
+		if (m_capacity == 0)
+			return;
+
+		auto [it, inserted] = m_index.try_emplace(key);
+		if (!inserted)
+		{
+			it->second->second = std::move(entry);
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return;
+		}
+
+		m_entries.emplace_front(key, std::move(entry));
+		it->second = m_entries.begin();
+
+		if (m_entries.size() > m_capacity)
+		{
+			m_index.erase(m_entries.back().first);
+			m_entries.pop_back();
+			m_stats.evictions++;
+		}
+	}
+
+	void ResultCache::Clear()
+	{
+		m_entries.clear();
+		m_index.clear();
+	}
+
+	// Exact bits of 'value' without the padding of long double
+	static void AppendValue(value_type value, std::string& key)
+	{
+		int exponent;
+		const value_type mantissa = std::frexp(value, &exponent);
+		// |mantissa| is in [0.5, 1), scaled into [2^63, 2^64) every one of its 64 bits is kept
+		const uint64_t bits = static_cast<uint64_t>(std::ldexp(std::abs(mantissa), 64));
+		key += std::signbit(value) ? '-' : '+';
+		key.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+		key.append(reinterpret_cast<const char*>(&exponent), sizeof(exponent));
+	}
+
+	std::string ResultCache::Key(const std::vector<Token>& tokens, bool literals)
+	{
+		std::string key;
+		for (const Token& token : tokens)
+		{
+			key += static_cast<char>(token.Type());
+			switch (token.Type())
+			{
+				case TokenType::Value:
+					// Otherwise values are compared, so '2', '2.0' and '20e-1' share a key
+					if (literals && !token.GetLiteral().empty())
+						key += token.GetLiteral() + '\0';
+					else
+					{
+						AppendValue(token.GetValue().real(), key);
+						AppendValue(token.GetValue().imag(), key);
+					}
+					break;
+				case TokenType::Constant:
+					key += static_cast<char>(token.GetConstant());
+					break;
+				case TokenType::String:
+					key += token.GetString() + '\0';
+					break;
+				case TokenType::BuiltinFunction:
+					key += static_cast<char>(token.GetBuiltinFunction());
+					break;
+				default:
+					break;
+			}
+		}
+		return key;
+	}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Multiprecision.h"
+#include "TokenNode.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bcalc
+{
+
+	// Results of expression lines keyed on their tokens, least recently used entries are dropped beyond the
+	// capacity. An entry is only returned while none of the names its expression reads have changed.
+	class ResultCache
+	{
+	public:
+		// Name to a counter that increases whenever the name changes, missing names never changed
+		using Versions = std::unordered_map<std::string, uint64_t>;
+
+		struct Entry
+		{
+			CalcResult				result;
+			Multiprecision::Complex	precise;
+			// Variables and functions read by the expression, directly or through functions it calls,
+			// with their versions when it was evaluated
+			std::vector<std::pair<std::string, uint64_t>> dependencies;
+		};
+
+		struct Statistics
+		{
+			uint64_t hits		= 0;
+			uint64_t misses		= 0;
+			uint64_t stale		= 0; // misses of entries whose dependencies had changed
+			uint64_t evictions	= 0;
+		};
+
+		// Zero disables the cache
+		void SetCapacity(std::size_t capacity);
+		std::size_t Capacity() const { return m_capacity; }
+
+		// Returns the entry of 'key' and marks it most recently used, nullptr if there is none or it is stale.
+		// Stale entries are dropped.
+		const Entry* Find(const std::string& key, const Versions& versions);
+		void Insert(const std::string& key, Entry entry);
+		void Clear();
+
+		const Statistics& Stats() const { return m_stats; }
+
+		// Key of a token stream, independent of how the input was spaced and written. 'literals' keeps number
+		// literals as written, two with the same long double value differ in multi-precision mode.
+		static std::string Key(const std::vector<Token>& tokens, bool literals);
+
+	private:
+		using List = std::list<std::pair<std::string, Entry>>;
+
+		std::size_t m_capacity = 0;
+		List m_entries; // most recently used first
+		std::unordered_map<std::string, List::iterator> m_index;
+
+		Statistics m_stats;
+	};
+
+}
@@ -0,0 +1,211 @@
+#include "Solve.h"
+
+#include "Differentiate.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <limits>
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+
+	static constexpr std::size_t s_max_iterations = 200;
+	static constexpr value_type s_epsilon = std::numeric_limits<value_type>::epsilon();
+
+	// Real part of 'function' at 'x', NaN if it could not be evaluated
+	static value_type EvaluateReal(const UserFunction& function, value_type x, const VariableList& variables, const FunctionList& functions)
+	{
+		auto result = Invoke(function, { x }, variables, functions);
+		if (result.has_error)
+			return std::numeric_limits<value_type>::quiet_NaN();
+		return result.value.real();
+	}
+
+	CalcResult Solve::Newton(const UserFunction& function, complex start, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (function.parameters.size() != 1)
+			return error;
+
+		complex x = start;
+		for (std::size_t i = 0; i < s_max_iterations; i++)
+		{
+			complex value;
+			auto derivative = Differentiate::Forward(function, 0, { x }, variables, functions, &value);
+			if (derivative.has_error)
+				return error;
+
+			if (value == complex(0))
+				return { .value = x };
+			if (derivative.value == complex(0))
+				return error;
+
+			complex step = value / derivative.value;
+			x -= step;
+
+			if (!std::isfinite(x.real()) || !std::isfinite(x.imag()))
+				return error;
+			if (std::abs(step) <= 64 * s_epsilon * std::max<value_type>(1, std::abs(x)))
+				return { .value = x };
+		}
+
+		return error;
+	}
+
+	std::vector<CalcResult> Solve::NewtonBatch(const UserFunction& function, const std::vector<complex>& starts, const VariableList& variables, const FunctionList& functions)
+	{
+		std::vector<CalcResult> results(starts.size());
+		ParallelFor(starts.size(), 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++)
+				results[i] = Newton(function, starts[i], variables, functions);
+		});
+		return results;
+	}
+
+	CalcResult Solve::Brent(const UserFunction& function, value_type a, value_type b, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (function.parameters.size() != 1)
+			return error;
+
+		value_type fa = EvaluateReal(function, a, variables, functions);
+		value_type fb = EvaluateReal(function, b, variables, functions);
+		if (std::isnan(fa) || std::isnan(fb) || (fa > 0 && fb > 0) || (fa < 0 && fb < 0))
+			return error;
+
+		if (fa == 0)
+			return { .value = a };
+		if (fb == 0)
+			return { .value = b };
+
+		value_type c = b, fc = fb;
+		value_type d = b - a, e = d;
+
+		for (std::size_t i = 0; i < s_max_iterations; i++)
+		{
+			if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0))
+			{
+				c = a;
+				fc = fa;
+				d = e = b - a;
+			}
+
+			if (std::abs(fc) < std::abs(fb))
+			{
+				a = b;	b = c;	c = a;
+				fa = fb; fb = fc; fc = fa;
+			}
+
+			value_type tolerance = 2 * s_epsilon * std::abs(b) + std::numeric_limits<value_type>::min();
+			value_type middle = (c - b) / 2;
+			if (std::abs(middle) <= tolerance || fb == 0)
+				return { .value = b };
+
+			if (std::abs(e) >= tolerance && std::abs(fa) > std::abs(fb))
+			{
+				// Inverse quadratic interpolation, or secant if only two points are distinct
+				value_type p, q;
+				value_type s = fb / fa;
+				if (a == c)
+				{
+					p = 2 * middle * s;
+					q = 1 - s;
+				}
+				else
+				{
+					value_type r = fb / fc;
+					q = fa / fc;
+					p = s * (2 * middle * q * (q - r) - (b - a) * (r - 1));
+					q = (q - 1) * (r - 1) * (s - 1);
+				}
+
+				if (p > 0)
+					q = -q;
+				p = std::abs(p);
+
+				if (2 * p < std::min(3 * middle * q - std::abs(tolerance * q), std::abs(e * q)))
+				{
+					e = d;
+					d = p / q;
+				}
+				else
+				{
+					d = middle;
+					e = d;
+				}
+			}
+			else
+			{
+				// Bisection
+				d = middle;
+				e = d;
+			}
+
+			a = b;
+			fa = fb;
+			b += std::abs(d) > tolerance ? d : std::copysign(tolerance, middle);
+			fb = EvaluateReal(function, b, variables, functions);
+			if (std::isnan(fb))
+				return error;
+		}
+
+		return error;
+	}
+
+	std::vector<value_type> Solve::Roots(const UserFunction& function, value_type a, value_type b, std::size_t intervals, const VariableList& variables, const FunctionList& functions)
+	{
+		if (function.parameters.size() != 1 || intervals == 0 || !(a < b))
+			return {};
+
+		std::vector<value_type> points(intervals + 1);
+		std::vector<value_type> values(intervals + 1);
+		ParallelFor(points.size(), 256, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++)
+			{
+				points[i] = (i == intervals) ? b : a + (b - a) * i / intervals;
+				values[i] = EvaluateReal(function, points[i], variables, functions);
+			}
+		});
+
+		std::vector<std::size_t> brackets;
+		for (std::size_t i = 0; i < intervals; i++)
+			if ((values[i] < 0 && values[i + 1] > 0) || (values[i] > 0 && values[i + 1] < 0))
+				brackets.push_back(i);
+
+		std::vector<value_type> roots(brackets.size(), std::numeric_limits<value_type>::quiet_NaN());
+		ParallelFor(brackets.size(), 1, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++)
+			{
+				std::size_t index = brackets[i];
+				auto root = Brent(function, points[index], points[index + 1], variables, functions);
+				if (root.has_error)
+					continue;
+
+				// Sign changes over poles converge to the pole, reject anything that didn't get closer to zero
+				value_type residual = std::abs(EvaluateReal(function, root.value.real(), variables, functions));
+				if (residual <= std::min(std::abs(values[index]), std::abs(values[index + 1])))
+					roots[i] = root.value.real();
+			}
+		});
+
+		std::vector<value_type> result;
+		for (std::size_t i = 0, j = 0; i <= intervals; i++)
+		{
+			if (values[i] == 0)
+				result.push_back(points[i]);
+			if (j < brackets.size() && brackets[j] == i)
+			{
+				if (!std::isnan(roots[j]))
+					result.push_back(roots[j]);
+				j++;
+			}
+		}
+
+		return result;
+	}
+
+}
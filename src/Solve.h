@@ -0,0 +1,22 @@
+#pragma once
+
+#include "TokenNode.h"
+
+namespace bcalc::Solve
+{
+
+	// Newton's method on a single parameter 'function' starting from 'start'.
+	// Derivatives are exact (forward mode), so complex roots can be found from complex starting points.
+	CalcResult Newton(const UserFunction& function, std::complex<value_type> start, const VariableList& variables, const FunctionList& functions);
+
+	// Runs Newton's method from every starting point in parallel. Results are in the order of 'starts'.
+	std::vector<CalcResult> NewtonBatch(const UserFunction& function, const std::vector<std::complex<value_type>>& starts, const VariableList& variables, const FunctionList& functions);
+
+	// Brent's method for a real root of 'function' in [a, b]. The real part of the function must change sign over the interval.
+	CalcResult Brent(const UserFunction& function, value_type a, value_type b, const VariableList& variables, const FunctionList& functions);
+
+	// Finds real roots in [a, b] by splitting the interval into 'intervals' pieces and running Brent's method on every
+	// piece where the function changes sign. Pieces are processed in parallel, roots are returned in ascending order.
+	std::vector<value_type> Roots(const UserFunction& function, value_type a, value_type b, std::size_t intervals, const VariableList& variables, const FunctionList& functions);
+
+}
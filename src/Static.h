@@ -0,0 +1,757 @@
+#pragma once
+
+#include "Token.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+#include <vector>
+
+// Compile time front end for C++ callers. Expressions are lexed and parsed during compilation with the same grammar
+// as Lexer::Tokenize and Parser::BuildTokenTree, and evaluated by code the compiler sees in full, so it can be inlined
+// and vectorized. Invalid input is a compile error that names the problem (e.g. 'unknown_identifier').
+//
+//   constexpr bcalc::Static::Function<"f(x, y) = x * y + sin(x)"> f;
+//   double value = f(1.0, 2.0);
+//
+//   constexpr bcalc::Static::Expression<"sqrt(2) / 2"> g;
+//   auto value = g.Evaluate<std::complex<long double>>();
+//
+// The value type is the common type of the arguments. With std::complex<long double> results are identical to
+// Program::Process, except that the compiler may round builtins of constant arguments differently in the last bits.
+// tests/Static.cpp checks this on a corpus of expressions. With real types, builtins follow their real counterparts
+// (e.g. sqrt(-1) is NaN) and 'i' is a compile error. Builtins operating on user functions (diff, sum, ...) are compile
+// errors.
+
+namespace bcalc::Static
+{
+
+	template<std::size_t N>
+	struct FixedString
+	{
+		constexpr FixedString(const char (&string)[N]) { std::copy_n(string, N, data); }
+		constexpr std::string_view view() const { return { data, N - 1 }; }
+
+		char data[N] {};
+	};
+
+	namespace Detail
+	{
+
+		// Calling one of these during constant evaluation fails the compilation, the name shows in the error message.
+		void invalid_character();
+		void unknown_identifier();
+		void invalid_parenthesis();
+		void invalid_input();
+		void invalid_function_definition();
+		void too_many_parameters();
+
+		static constexpr std::size_t s_max_parameters = 16;
+
+		struct StaticToken
+		{
+			TokenType	type	= TokenType::Count;
+			value_type	value	= 0;	// Value
+			uint32_t	index	= 0;	// FunctionType, Constant or parameter index of a String
+		};
+
+		struct Node
+		{
+			StaticToken	token;
+			uint32_t	children[3] {};
+			uint32_t	child_count = 0;
+		};
+
+		template<std::size_t N>
+		struct Tree
+		{
+			std::array<Node, 4 * N + 4>		nodes {};
+			uint32_t						node_count		= 0;
+			uint32_t						root			= 0;
+			uint32_t						parameter_count	= 0;
+		};
+
+		template<std::size_t N>
+		struct TokenList
+		{
+			std::array<StaticToken, 2 * N + 2>	tokens {};
+			std::size_t							size = 0;
+
+			constexpr void push(StaticToken token) { tokens[size++] = token; }
+		};
+
+		struct Parameters
+		{
+			std::array<std::string_view, s_max_parameters>	names {};
+			std::size_t										count = 0;
+		};
+
+		constexpr bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+		constexpr bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+		constexpr bool IsAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+		// Unsigned integer of 32 bit limbs, least significant first and without leading zero limbs
+		struct BigUnsigned
+		{
+			std::vector<uint32_t> limbs;
+
+			constexpr bool IsZero() const { return limbs.empty(); }
+
+			constexpr int Bits() const
+			{
+				if (limbs.empty())
+					return 0;
+				int bits = 32 * static_cast<int>(limbs.size() - 1);
+				for (uint32_t top = limbs.back(); top; top >>= 1)
+					bits++;
+				return bits;
+			}
+
+			constexpr void MultiplyAdd(uint32_t factor, uint32_t addend)
+			{
+				uint64_t carry = addend;
+				for (uint32_t& limb : limbs)
+				{
+					carry += uint64_t(limb) * factor;
+					limb = static_cast<uint32_t>(carry);
+					carry >>= 32;
+				}
+				if (carry)
+					limbs.push_back(static_cast<uint32_t>(carry));
+			}
+
+			constexpr void MultiplyPowerOfFive(int exponent)
+			{
+				for (; exponent >= 13; exponent -= 13)
+					MultiplyAdd(1220703125, 0);
+				uint32_t factor = 1;
+				for (; exponent > 0; exponent--)
+					factor *= 5;
+				MultiplyAdd(factor, 0);
+			}
+
+			constexpr void ShiftLeft(int bits)
+			{
+				if (limbs.empty())
+					return;
+				limbs.insert(limbs.begin(), bits / 32, 0);
+				if (bits %= 32)
+				{
+					uint32_t carry = 0;
+					for (uint32_t& limb : limbs)
+					{
+						uint32_t next = limb >> (32 - bits);
+						limb = (limb << bits) | carry;
+						carry = next;
+					}
+					if (carry)
+						limbs.push_back(carry);
+				}
+			}
+
+			constexpr bool operator>=(const BigUnsigned& other) const
+			{
+				if (limbs.size() != other.limbs.size())
+					return limbs.size() > other.limbs.size();
+				for (std::size_t i = limbs.size(); i-- > 0;)
+					if (limbs[i] != other.limbs[i])
+						return limbs[i] > other.limbs[i];
+				return true;
+			}
+
+			// 'other' must not be larger
+			constexpr void Subtract(const BigUnsigned& other)
+			{
+				int64_t borrow = 0;
+				for (std::size_t i = 0; i < limbs.size(); i++)
+				{
+					int64_t difference = int64_t(limbs[i]) - (i < other.limbs.size() ? other.limbs[i] : 0) - borrow;
+					borrow = difference < 0;
+					limbs[i] = static_cast<uint32_t>(difference + (borrow << 32));
+				}
+				while (!limbs.empty() && limbs.back() == 0)
+					limbs.pop_back();
+			}
+		};
+
+		// Nearest value_type to 'numerator / denominator * 2^exponent', ties to even like std::from_chars
+		constexpr value_type RoundQuotient(BigUnsigned numerator, BigUnsigned denominator, int exponent)
+		{
+			constexpr int digits = std::numeric_limits<value_type>::digits;
+			static_assert(digits <= 64);
+
+			// Scale to 1 <= numerator / denominator < 2
+			int shift = numerator.Bits() - denominator.Bits();
+			if (shift > 0)
+				denominator.ShiftLeft(shift);
+			else
+				numerator.ShiftLeft(-shift);
+			if (!(numerator >= denominator))
+			{
+				numerator.ShiftLeft(1);
+				shift--;
+			}
+			exponent += shift;
+
+			// 'digits' bits of the mantissa and one rounding bit by long division, the rest only matters if it is zero
+			uint64_t mantissa = 0;
+			bool round = false;
+			for (int i = 0; i <= digits; i++)
+			{
+				const bool bit = numerator >= denominator;
+				if (bit)
+					numerator.Subtract(denominator);
+				numerator.ShiftLeft(1);
+				if (i < digits)
+					mantissa = (mantissa << 1) | bit;
+				else
+					round = bit;
+			}
+
+			if (round && (!numerator.IsZero() || (mantissa & 1)))
+			{
+				mantissa++;
+				if ((mantissa >> (digits - 1)) != 1)
+				{
+					mantissa = uint64_t(1) << (digits - 1);
+					exponent++;
+				}
+			}
+
+			// Exact except for subnormals and overflow
+			value_type result = static_cast<value_type>(mantissa);
+			for (exponent -= digits - 1; exponent > 0; exponent--)
+				result *= 2;
+			for (; exponent < 0; exponent++)
+				result /= 2;
+			return result;
+		}
+
+		// Decimal number with optional fraction and exponent, the subset of std::from_chars accepted by the lexer.
+		// Correctly rounded like std::from_chars, however many digits the literal has.
+		constexpr std::size_t ParseNumber(std::string_view data, std::size_t i, value_type& out)
+		{
+			BigUnsigned mantissa;
+			int exponent = 0;
+			int digits = 0;
+
+			// Digits are added nine at a time
+			uint32_t pending = 0;
+			uint32_t pending_scale = 1;
+			auto digit = [&](char c, bool fraction)
+			{
+				pending = pending * 10 + (c - '0');
+				pending_scale *= 10;
+				if (pending_scale == 1000000000)
+				{
+					mantissa.MultiplyAdd(pending_scale, pending);
+					pending = 0;
+					pending_scale = 1;
+				}
+				digits += !mantissa.IsZero() || pending > 0;
+				exponent -= fraction;
+			};
+
+			for (; i < data.size() && IsDigit(data[i]); i++)
+				digit(data[i], false);
+
+			if (i < data.size() && data[i] == '.')
+				for (i++; i < data.size() && IsDigit(data[i]); i++)
+					digit(data[i], true);
+
+			mantissa.MultiplyAdd(pending_scale, pending);
+
+			if (i + 1 < data.size() && (data[i] == 'e' || data[i] == 'E'))
+			{
+				std::size_t j = i + 1;
+				bool negative = false;
+				if (data[j] == '+' || data[j] == '-')
+					negative = data[j++] == '-';
+
+				if (j < data.size() && IsDigit(data[j]))
+				{
+					int value = 0;
+					for (; j < data.size() && IsDigit(data[j]); j++)
+						value = std::min(value * 10 + (data[j] - '0'), 100000);
+					exponent += negative ? -value : value;
+					i = j;
+				}
+			}
+
+			// Decimal exponent of the leading digit decides out of range values without big arithmetic
+			const int magnitude = exponent + digits;
+			if (mantissa.IsZero() || magnitude < std::numeric_limits<value_type>::min_exponent10 - 2 * std::numeric_limits<value_type>::max_digits10)
+				out = 0;
+			else if (magnitude > std::numeric_limits<value_type>::max_exponent10 + 1)
+				out = std::numeric_limits<value_type>::infinity();
+			else
+			{
+				// mantissa * 10^exponent = mantissa * 5^exponent * 2^exponent
+				BigUnsigned denominator;
+				denominator.MultiplyAdd(1, 1);
+				if (exponent >= 0)
+					mantissa.MultiplyPowerOfFive(exponent);
+				else
+					denominator.MultiplyPowerOfFive(-exponent);
+				out = RoundQuotient(mantissa, denominator, exponent);
+			}
+			return i;
+		}
+
+		template<std::size_t N>
+		constexpr TokenList<N> Tokenize(std::string_view data, const Parameters& parameters)
+		{
+			TokenList<N> result;
+
+			for (std::size_t i = 0; i < data.size(); i++)
+			{
+				if (IsSpace(data[i]))
+					continue;
+
+				if (IsDigit(data[i]))
+				{
+					StaticToken token { .type = TokenType::Value };
+					i = ParseNumber(data, i, token.value) - 1;
+					result.push(token);
+					continue;
+				}
+
+				if (IsAlpha(data[i]))
+				{
+					std::size_t len = 1;
+					while (i + len < data.size() && (IsAlpha(data[i + len]) || IsDigit(data[i + len]) || data[i + len] == '_'))
+						len++;
+					std::string_view name = data.substr(i, len);
+					i += len - 1;
+
+					if (result.size > 0)
+					{
+						auto last = result.tokens[result.size - 1].type;
+						if (last == TokenType::Value || last == TokenType::String || last == TokenType::Constant || last == TokenType::BuiltinFunction)
+							result.push({ .type = TokenType::Mult });
+					}
+
+					StaticToken token;
+					for (const auto& [string, function] : s_function_names)
+						if (string == name)
+							token = { .type = TokenType::BuiltinFunction, .index = static_cast<uint32_t>(function) };
+					for (const auto& [string, constant] : s_constant_names)
+						if (string == name)
+							token = { .type = TokenType::Constant, .index = static_cast<uint32_t>(constant) };
+					for (std::size_t j = 0; j < parameters.count; j++)
+						if (token.type == TokenType::Count && parameters.names[j] == name)
+							token = { .type = TokenType::String, .index = static_cast<uint32_t>(j) };
+
+					if (token.type == TokenType::Count)
+						unknown_identifier();
+					result.push(token);
+					continue;
+				}
+
+				bool found = false;
+				if (i + 1 < data.size())
+				{
+					for (const auto& [string, type] : s_operator_strings)
+					{
+						if (data.substr(i, 2) == string)
+						{
+							result.push({ .type = type });
+							found = true;
+							i++;
+							break;
+						}
+					}
+				}
+
+				for (const auto& [c, type] : s_operator_chars)
+				{
+					if (!found && data[i] == c)
+					{
+						result.push({ .type = type });
+						found = true;
+					}
+				}
+
+				if (!found)
+					invalid_character();
+			}
+
+			return result;
+		}
+
+		template<std::size_t N>
+		class Parser
+		{
+		public:
+			constexpr Parser(const TokenList<N>& tokens, Tree<N>& tree)
+				: m_tokens(tokens), m_tree(tree)
+			{}
+
+			constexpr uint32_t Build(std::size_t begin, std::size_t end)
+			{
+				if (!IsValid(begin, end))
+					invalid_parenthesis();
+
+				while (begin < end && IsInParenthesis(begin, end))
+				{
+					begin++;
+					end--;
+				}
+
+				if (begin == end)
+					invalid_input();
+
+				const StaticToken& first = m_tokens.tokens[begin];
+
+				if (end - begin == 1)
+				{
+					if (first.type == TokenType::Value || first.type == TokenType::Constant || first.type == TokenType::String)
+						return Add({ .token = first });
+					invalid_input();
+				}
+
+				if ((first.type == TokenType::BuiltinFunction || first.type == TokenType::String) && IsInParenthesis(begin + 1, end))
+				{
+					Node node { .token = first };
+
+					// explicitly allow functions with no parameters
+					if (end - begin == 3)
+						return Add(node);
+
+					std::size_t comma = begin + 1;
+					while (comma + 1 < end)
+					{
+						std::size_t start = ++comma;
+
+						int64_t depth = 0;
+						while (comma + 1 != end && (depth > 0 || m_tokens.tokens[comma].type != TokenType::Comma))
+						{
+							if (m_tokens.tokens[comma].type == TokenType::LParan)
+								depth++;
+							else if (m_tokens.tokens[comma].type == TokenType::RParan)
+								depth--;
+							comma++;
+						}
+
+						uint32_t input = Build(start, comma);
+						if (node.child_count < 3)
+							node.children[node.child_count] = input;
+						node.child_count++;
+					}
+
+					if (first.type == TokenType::String)
+						node.child_count = 0; // parameters ignore call arguments like in tree evaluation
+					return Add(node);
+				}
+
+				std::size_t op = LastOOO(begin, end);
+				if (op == end)
+					invalid_input();
+
+				uint32_t lhs;
+				if (begin == op)
+				{
+					TokenType type = m_tokens.tokens[op].type;
+					if (type != TokenType::Add && type != TokenType::Sub)
+						invalid_input();
+					lhs = Add({ .token = { .type = TokenType::Value, .value = 0 } });
+				}
+				else
+				{
+					lhs = Build(begin, op);
+				}
+
+				uint32_t rhs = Build(op + 1, end);
+
+				return Add({ .token = m_tokens.tokens[op], .children = { lhs, rhs }, .child_count = 2 });
+			}
+
+		private:
+			constexpr uint32_t Add(const Node& node)
+			{
+				m_tree.nodes[m_tree.node_count] = node;
+				return m_tree.node_count++;
+			}
+
+			constexpr bool IsValid(std::size_t begin, std::size_t end) const
+			{
+				int64_t depth = 0;
+				for (std::size_t i = begin; i < end; i++)
+				{
+					if (m_tokens.tokens[i].type == TokenType::LParan)
+						depth++;
+					else if (m_tokens.tokens[i].type == TokenType::RParan && depth-- == 0)
+						return false;
+				}
+				return depth == 0;
+			}
+
+			constexpr bool IsInParenthesis(std::size_t begin, std::size_t end) const
+			{
+				if (end - begin < 2 || m_tokens.tokens[begin].type != TokenType::LParan)
+					return false;
+
+				int64_t depth = 0;
+				for (std::size_t i = begin + 1; i < end - 1; i++)
+				{
+					if (m_tokens.tokens[i].type == TokenType::LParan)
+						depth++;
+					else if (m_tokens.tokens[i].type == TokenType::RParan && depth-- == 0)
+						return false;
+				}
+				return depth == 0;
+			}
+
+			template<typename F>
+			constexpr std::size_t FindZeroDepth(std::size_t begin, std::size_t end, F&& matches) const
+			{
+				int64_t depth = 0;
+				for (std::size_t i = end; i-- > begin;)
+				{
+					TokenType type = m_tokens.tokens[i].type;
+					if (matches(type) && depth == 0)
+						return i;
+					else if (type == TokenType::RParan)
+						depth++;
+					else if (type == TokenType::LParan)
+						depth--;
+				}
+				return end;
+			}
+
+			constexpr std::size_t LastOOO(std::size_t begin, std::size_t end) const
+			{
+				constexpr auto is_comparison = [](TokenType type) {
+					return type == TokenType::Less || type == TokenType::LessEqual || type == TokenType::Greater
+						|| type == TokenType::GreaterEqual || type == TokenType::Equal || type == TokenType::NotEqual;
+				};
+
+				if (auto it = FindZeroDepth(begin, end, is_comparison); it != end)
+					return it;
+				if (auto it = FindZeroDepth(begin, end, [](TokenType type) { return type == TokenType::Add || type == TokenType::Sub; }); it != end)
+					return it;
+				if (auto it = FindZeroDepth(begin, end, [](TokenType type) { return type == TokenType::Mult || type == TokenType::Div; }); it != end)
+					return it;
+				return FindZeroDepth(begin, end, [](TokenType type) { return type == TokenType::Power; });
+			}
+
+		private:
+			const TokenList<N>&	m_tokens;
+			Tree<N>&			m_tree;
+		};
+
+		template<FixedString S, bool Definition>
+		constexpr auto Parse()
+		{
+			constexpr std::size_t N = S.view().size();
+			std::string_view data = S.view();
+
+			Parameters parameters;
+
+			// 'name(p1, ..., pn) = body', same shape Program::Process accepts
+			if constexpr (Definition)
+			{
+				std::size_t i = 0;
+				auto skip_space = [&]() { while (i < data.size() && IsSpace(data[i])) i++; };
+				auto identifier = [&]() -> std::string_view {
+					skip_space();
+					if (i >= data.size() || !IsAlpha(data[i]))
+						invalid_function_definition();
+					std::size_t start = i;
+					while (i < data.size() && (IsAlpha(data[i]) || IsDigit(data[i]) || data[i] == '_'))
+						i++;
+					return data.substr(start, i - start);
+				};
+				auto expect = [&](char c) {
+					skip_space();
+					if (i >= data.size() || data[i] != c)
+						invalid_function_definition();
+					i++;
+				};
+
+				identifier();
+				expect('(');
+				skip_space();
+				if (i < data.size() && data[i] == ')')
+					i++;
+				else
+				{
+					while (true)
+					{
+						if (parameters.count == s_max_parameters)
+							too_many_parameters();
+						parameters.names[parameters.count++] = identifier();
+						skip_space();
+						if (i < data.size() && data[i] == ',')
+						{
+							i++;
+							continue;
+						}
+						expect(')');
+						break;
+					}
+				}
+				expect('=');
+				data = data.substr(i);
+			}
+
+			auto tokens = Tokenize<N>(data, parameters);
+
+			Tree<N> tree;
+			tree.parameter_count = parameters.count;
+			tree.root = Parser<N>(tokens, tree).Build(0, tokens.size);
+			return tree;
+		}
+
+		template<FixedString S, bool Definition>
+		inline constexpr auto s_tree = Parse<S, Definition>();
+
+		template<typename T> struct IsComplex : std::false_type {};
+		template<typename T> struct IsComplex<std::complex<T>> : std::true_type {};
+
+		template<typename T>
+		constexpr auto Real(const T& value)
+		{
+			if constexpr (IsComplex<T>::value)
+				return value.real();
+			else
+				return value;
+		}
+
+		template<typename T, typename F>
+		T Componentwise(const T& value, F&& func)
+		{
+			if constexpr (IsComplex<T>::value)
+				return T(func(value.real()), func(value.imag()));
+			else
+				return func(value);
+		}
+
+		template<typename T, FixedString S, bool Definition, uint32_t I, std::size_t P>
+		constexpr T Evaluate(const std::array<T, P>& parameters)
+		{
+			constexpr const Node& node = s_tree<S, Definition>.nodes[I];
+			constexpr TokenType type = node.token.type;
+
+			if constexpr (type == TokenType::Value)
+				return T(node.token.value);
+			else if constexpr (type == TokenType::Constant)
+			{
+				constexpr Constant constant = static_cast<Constant>(node.token.index);
+				if constexpr (constant == Constant::pi)
+					return T(std::numbers::pi_v<value_type>);
+				else if constexpr (constant == Constant::e)
+					return T(std::numbers::e_v<value_type>);
+				else
+				{
+					static_assert(IsComplex<T>::value, "'i' requires a complex value type");
+					return T(0, 1);
+				}
+			}
+			else if constexpr (type == TokenType::String)
+				return parameters[node.token.index];
+			else if constexpr (type == TokenType::BuiltinFunction)
+			{
+				constexpr FunctionType function = static_cast<FunctionType>(node.token.index);
+				constexpr uint32_t count = node.child_count;
+
+				if constexpr (function == FunctionType::If)
+				{
+					static_assert(count == 3, "if takes 3 inputs");
+
+					// Only the selected branch is evaluated
+					const T condition = Evaluate<T, S, Definition, node.children[0]>(parameters);
+					if (condition != T(0))
+						return Evaluate<T, S, Definition, node.children[1]>(parameters);
+					return Evaluate<T, S, Definition, node.children[2]>(parameters);
+				}
+				else if constexpr (function == FunctionType::Log && count == 2)
+					return std::log(Evaluate<T, S, Definition, node.children[0]>(parameters)) / std::log(Evaluate<T, S, Definition, node.children[1]>(parameters));
+				else
+				{
+					static_assert(count == 1, "builtin takes 1 input");
+					const T x = Evaluate<T, S, Definition, node.children[0]>(parameters);
+
+					if constexpr (function == FunctionType::Sin)			return std::sin(x);
+					else if constexpr (function == FunctionType::ArcSin)	return std::asin(x);
+					else if constexpr (function == FunctionType::Sinh)		return std::sinh(x);
+					else if constexpr (function == FunctionType::ArcSinh)	return std::asinh(x);
+					else if constexpr (function == FunctionType::Cos)		return std::cos(x);
+					else if constexpr (function == FunctionType::ArcCos)	return std::acos(x);
+					else if constexpr (function == FunctionType::Cosh)		return std::cosh(x);
+					else if constexpr (function == FunctionType::ArcCosh)	return std::acosh(x);
+					else if constexpr (function == FunctionType::Tan)		return std::tan(x);
+					else if constexpr (function == FunctionType::ArcTan)	return std::atan(x);
+					else if constexpr (function == FunctionType::Tanh)		return std::tanh(x);
+					else if constexpr (function == FunctionType::ArcTanh)	return std::atanh(x);
+					else if constexpr (function == FunctionType::Sqrt)		return std::sqrt(x);
+					else if constexpr (function == FunctionType::Log)		return std::log(x);
+					else if constexpr (function == FunctionType::Exp)		return std::exp(x);
+					else if constexpr (function == FunctionType::Round)		return Componentwise(x, [](auto v) { return std::round(v); });
+					else if constexpr (function == FunctionType::Floor)		return Componentwise(x, [](auto v) { return std::floor(v); });
+					else if constexpr (function == FunctionType::Ceil)		return Componentwise(x, [](auto v) { return std::ceil(v); });
+					else
+						static_assert(sizeof(T) == 0, "builtin is not available at compile time");
+				}
+			}
+			else
+			{
+				static_assert(node.child_count == 2);
+				const T lhs = Evaluate<T, S, Definition, node.children[0]>(parameters);
+				const T rhs = Evaluate<T, S, Definition, node.children[1]>(parameters);
+
+				if constexpr (type == TokenType::Add)					return lhs + rhs;
+				else if constexpr (type == TokenType::Sub)				return lhs - rhs;
+				else if constexpr (type == TokenType::Mult)				return lhs * rhs;
+				else if constexpr (type == TokenType::Div)				return lhs / rhs;
+				else if constexpr (type == TokenType::Power)			return std::pow(lhs, rhs);
+				else if constexpr (type == TokenType::Less)				return T(Real(lhs) <  Real(rhs));
+				else if constexpr (type == TokenType::LessEqual)		return T(Real(lhs) <= Real(rhs));
+				else if constexpr (type == TokenType::Greater)			return T(Real(lhs) >  Real(rhs));
+				else if constexpr (type == TokenType::GreaterEqual)		return T(Real(lhs) >= Real(rhs));
+				else if constexpr (type == TokenType::Equal)			return T(lhs == rhs);
+				else if constexpr (type == TokenType::NotEqual)			return T(lhs != rhs);
+				else
+					static_assert(sizeof(T) == 0, "unsupported operator");
+			}
+		}
+
+		template<typename... Args>
+		struct CommonValueType { using type = std::common_type_t<Args...>; };
+		template<>
+		struct CommonValueType<> { using type = value_type; };
+
+		template<FixedString S, bool Definition>
+		struct Callable
+		{
+			static constexpr std::size_t parameter_count = s_tree<S, Definition>.parameter_count;
+
+			template<typename T, typename... Args>
+			constexpr T Evaluate(Args... args) const
+			{
+				static_assert(sizeof...(Args) == parameter_count, "wrong number of arguments");
+				const std::array<T, sizeof...(Args)> parameters { static_cast<T>(args)... };
+				return Detail::Evaluate<T, S, Definition, s_tree<S, Definition>.root>(parameters);
+			}
+
+			template<typename... Args>
+			constexpr auto operator()(Args... args) const
+			{
+				return Evaluate<typename CommonValueType<Args...>::type>(args...);
+			}
+		};
+
+	}
+
+	// User function definition, e.g. "f(x, y) = x * y"
+	template<FixedString S>
+	using Function = Detail::Callable<S, true>;
+
+	// Expression without parameters, e.g. "2 * pi"
+	template<FixedString S>
+	using Expression = Detail::Callable<S, false>;
+
+}
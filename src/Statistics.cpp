@@ -0,0 +1,502 @@
+#include "Statistics.h"
+
+#include "Batch.h"
+#include "FastMath.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bcalc
+{
+
+	using namespace Statistics;
+
+	// Rows evaluated together, also the rows between cancellation checks
+	static constexpr std::size_t s_block_rows = 1024;
+
+	// Smaller magnitudes are counted as zero by the sketch, their logarithms would need too many buckets
+	static constexpr value_type s_min_indexable = std::numeric_limits<double>::min();
+
+	void Moments::Add(value_type value)
+	{
+		count++;
+		const value_type delta = value - mean;
+		mean += delta / count;
+		m2 += delta * (value - mean);
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+
+	void Moments::Merge(const Moments& other)
+	{
+		if (other.count == 0)
+			return;
+		if (count == 0)
+		{
+			*this = other;
+			return;
+		}
+
+		const value_type total = static_cast<value_type>(count + other.count);
+		const value_type delta = other.mean - mean;
+		mean += delta * other.count / total;
+		m2 += other.m2 + delta * delta * count * other.count / total;
+		count += other.count;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+	}
+
+	value_type Moments::Variance() const
+	{
+		if (count < 2)
+			return 0;
+		return m2 / (count - 1);
+	}
+
+	QuantileSketch::QuantileSketch(value_type accuracy)
+		: m_gamma((1 + accuracy) / (1 - accuracy))
+		, m_log_gamma(std::log(m_gamma))
+	{}
+
+	void QuantileSketch::Store::Add(int index, uint64_t count)
+	{
+		if (counts.empty())
+			offset = index;
+		if (index < offset)
+		{
+			counts.insert(counts.begin(), offset - index, 0);
+			offset = index;
+		}
+		if (static_cast<std::size_t>(index - offset) >= counts.size())
+			counts.resize(index - offset + 1, 0);
+		counts[index - offset] += count;
+	}
+
+	int QuantileSketch::Index(value_type magnitude) const
+	{
+		return static_cast<int>(std::ceil(std::log(magnitude) / m_log_gamma));
+	}
+
+	value_type QuantileSketch::Value(int index) const
+	{
+		// Bucket 'index' holds (gamma^(index - 1), gamma^index], this is within 'accuracy' of both bounds
+		return 2 * std::pow(m_gamma, index) / (m_gamma + 1);
+	}
+
+	void QuantileSketch::Add(value_type value)
+	{
+		m_count++;
+		if (std::abs(value) < s_min_indexable)
+			m_zero++;
+		else if (value > 0)
+			m_positive.Add(Index(value), 1);
+		else
+			m_negative.Add(Index(-value), 1);
+	}
+
+	void QuantileSketch::Merge(const QuantileSketch& other)
+	{
+		for (std::size_t i = 0; i < other.m_positive.counts.size(); i++)
+			if (other.m_positive.counts[i])
+				m_positive.Add(other.m_positive.offset + static_cast<int>(i), other.m_positive.counts[i]);
+		for (std::size_t i = 0; i < other.m_negative.counts.size(); i++)
+			if (other.m_negative.counts[i])
+				m_negative.Add(other.m_negative.offset + static_cast<int>(i), other.m_negative.counts[i]);
+		m_zero += other.m_zero;
+		m_count += other.m_count;
+	}
+
+	value_type QuantileSketch::Quantile(value_type q) const
+	{
+		if (m_count == 0)
+			return std::numeric_limits<value_type>::quiet_NaN();
+
+		const value_type rank = q * (m_count - 1);
+
+		value_type result = 0;
+		uint64_t seen = 0;
+		bool found = false;
+		ForEach([&](value_type value, uint64_t count) {
+			if (found)
+				return;
+			seen += count;
+			if (seen > rank)
+			{
+				result = value;
+				found = true;
+			}
+		});
+		return result;
+	}
+
+	void Summary::Add(value_type value)
+	{
+		moments.Add(value);
+		sketch.Add(value);
+	}
+
+	void Summary::Merge(const Summary& other)
+	{
+		moments.Merge(other.moments);
+		sketch.Merge(other.sketch);
+		skipped += other.skipped;
+	}
+
+	// Rows read but not yet evaluated
+	struct Block
+	{
+		std::vector<value_type>				rows; // row major
+		std::size_t							count = 0;
+		std::vector<std::vector<double>>	columns; // for 'Batch'
+		std::vector<double>					results;
+	};
+
+	struct Fold
+	{
+		const UserFunction&	function;
+		const Batch*		batch;
+		const VariableList&	variables;
+		const FunctionList&	functions;
+
+		// Evaluates the rows of 'block' into 'out' and empties it. Returns false if the evaluation was stopped.
+		bool operator()(Block& block, Summary& out) const
+		{
+			const std::size_t arity = function.parameters.size();
+
+			// Rows the batch got a finite real result for are done, the rest are evaluated exactly
+			if (batch)
+			{
+				block.columns.resize(arity);
+				std::vector<const double*> inputs(arity);
+				for (std::size_t j = 0; j < arity; j++)
+				{
+					block.columns[j].resize(block.count);
+					for (std::size_t i = 0; i < block.count; i++)
+						block.columns[j][i] = static_cast<double>(block.rows[i * arity + j]);
+					inputs[j] = block.columns[j].data();
+				}
+
+				block.results.resize(block.count);
+				if (!batch->Evaluate(inputs.data(), block.results.data(), block.count))
+					return false;
+			}
+
+			std::vector<std::complex<value_type>> arguments(arity);
+			for (std::size_t i = 0; i < block.count; i++)
+			{
+				if (batch && !std::isnan(block.results[i]))
+				{
+					out.Add(block.results[i]);
+					continue;
+				}
+
+				for (std::size_t j = 0; j < arity; j++)
+					arguments[j] = block.rows[i * arity + j];
+
+				auto result = Invoke(function, arguments, variables, functions);
+				if (result.has_error || result.value.imag() != 0 || !std::isfinite(result.value.real()))
+				{
+					if (Cancellation::Stopped())
+						return false;
+					out.skipped++;
+					continue;
+				}
+				out.Add(result.value.real());
+			}
+
+			block.count = 0;
+			return !Cancellation::Stopped();
+		}
+	};
+
+	// Parses the leading 'arity' fields of the line [begin, end), false if one of them isn't a number
+	static bool ParseRow(const char* begin, const char* end, std::size_t arity, value_type* out)
+	{
+		auto is_blank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+		const char* current = begin;
+		for (std::size_t j = 0; j < arity; j++)
+		{
+			while (current < end && is_blank(*current))
+				current++;
+
+			auto [ptr, ec] = std::from_chars(current, end, out[j]);
+			if (ec != std::errc())
+				return false;
+			current = ptr;
+
+			while (current < end && is_blank(*current))
+				current++;
+			if (current != end && *current != ',')
+				return false;
+			if (j + 1 < arity && current++ == end)
+				return false;
+		}
+
+		return true;
+	}
+
+	// True if each of the leading 'arity' fields of the line [begin, end) holds something other than a number
+	static bool IsHeader(const char* begin, const char* end, std::size_t arity)
+	{
+		auto is_blank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+		const char* current = begin;
+		for (std::size_t j = 0; j < arity; j++)
+		{
+			if (j > 0 && current++ == end)
+				return false;
+
+			const char* field_end = static_cast<const char*>(memchr(current, ',', end - current));
+			if (!field_end)
+				field_end = end;
+
+			const char* first = current;
+			const char* last = field_end;
+			while (first < last && is_blank(*first))
+				first++;
+			while (last > first && is_blank(last[-1]))
+				last--;
+			if (first == last)
+				return false;
+
+			value_type value;
+			auto [ptr, ec] = std::from_chars(first, last, value);
+			if (ec == std::errc() && ptr == last)
+				return false;
+
+			current = field_end;
+		}
+
+		return true;
+	}
+
+	// First line starting at or after 'position'
+	static const char* LineStart(const char* position, const char* begin, const char* end)
+	{
+		if (position == begin)
+			return position;
+		const char* newline = static_cast<const char*>(memchr(position - 1, '\n', end - (position - 1)));
+		return newline ? newline + 1 : end;
+	}
+
+	static bool StreamCSV(const char* data, std::size_t size, const Fold& fold, std::vector<Summary>& summaries)
+	{
+		const std::size_t arity = fold.function.parameters.size();
+		const char* end = data + size;
+
+		// A header names every column, a first line with some numbers is a malformed row and counted as skipped
+		const char* begin = data;
+		{
+			const char* newline = static_cast<const char*>(memchr(data, '\n', size));
+			if (IsHeader(data, newline ? newline : end, arity))
+				begin = newline ? newline + 1 : end;
+		}
+
+		const std::size_t segments = summaries.size();
+		std::atomic<bool> stopped = false;
+
+		ParallelFor(segments, 1, [&](std::size_t first, std::size_t last) {
+			for (std::size_t segment = first; segment < last && !stopped; segment++)
+			{
+				const std::size_t length = end - begin;
+				const char* current = LineStart(begin + length * segment / segments, begin, end);
+				const char* segment_end = LineStart(begin + length * (segment + 1) / segments, begin, end);
+
+				Summary& summary = summaries[segment];
+				Block block;
+				block.rows.resize(arity * s_block_rows);
+
+				while (current < segment_end)
+				{
+					const char* newline = static_cast<const char*>(memchr(current, '\n', end - current));
+					const char* line_end = newline ? newline : end;
+
+					const char* content = current;
+					while (content < line_end && (*content == ' ' || *content == '\t' || *content == '\r'))
+						content++;
+
+					if (content != line_end)
+					{
+						if (!ParseRow(current, line_end, arity, block.rows.data() + block.count * arity))
+							summary.skipped++;
+						else if (++block.count == s_block_rows && !fold(block, summary))
+						{
+							stopped = true;
+							return;
+						}
+					}
+
+					current = newline ? newline + 1 : end;
+				}
+
+				if (block.count && !fold(block, summary))
+				{
+					stopped = true;
+					return;
+				}
+			}
+		});
+
+		return !stopped;
+	}
+
+	static bool StreamBinary(const char* data, std::size_t size, const Fold& fold, std::vector<Summary>& summaries)
+	{
+		const std::size_t arity = fold.function.parameters.size();
+		const std::size_t row_size = arity * sizeof(double);
+		if (size % row_size != 0)
+			return false;
+
+		const std::size_t rows = size / row_size;
+		const std::size_t segments = summaries.size();
+		std::atomic<bool> stopped = false;
+
+		ParallelFor(segments, 1, [&](std::size_t first, std::size_t last) {
+			for (std::size_t segment = first; segment < last && !stopped; segment++)
+			{
+				Summary& summary = summaries[segment];
+				Block block;
+				block.rows.resize(arity * s_block_rows);
+
+				const std::size_t row_end = rows * (segment + 1) / segments;
+				for (std::size_t row = rows * segment / segments; row < row_end; row++)
+				{
+					for (std::size_t j = 0; j < arity; j++)
+					{
+						double value;
+						memcpy(&value, data + row * row_size + j * sizeof(double), sizeof(double));
+						block.rows[block.count * arity + j] = value;
+					}
+
+					if (++block.count == s_block_rows && !fold(block, summary))
+					{
+						stopped = true;
+						return;
+					}
+				}
+
+				if (block.count && !fold(block, summary))
+				{
+					stopped = true;
+					return;
+				}
+			}
+		});
+
+		return !stopped;
+	}
+
+	bool Statistics::Stream(const std::string& path, Table::Format format, const UserFunction& function, const VariableList& variables, const FunctionList& functions, Summary& out)
+	{
+		if (function.parameters.empty())
+			return false;
+
+		int file = open(path.c_str(), O_RDONLY);
+		if (file == -1)
+			return false;
+
+		struct stat st;
+		if (fstat(file, &st) == -1)
+		{
+			close(file);
+			return false;
+		}
+
+		if (st.st_size == 0)
+		{
+			close(file);
+			out = {};
+			return true;
+		}
+
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (mapped == MAP_FAILED)
+			return false;
+		madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+
+		// Functions the batch evaluator can handle are evaluated many rows at a time in fast math mode
+		Batch* batch = FastMath::Enabled() ? Batch::Compile(function, variables, functions) : nullptr;
+		const Fold fold { function, batch, variables, functions };
+
+		// One segment of the file per thread, their summaries are merged in file order
+		std::vector<Summary> summaries(ThreadCount());
+
+		const char* data = static_cast<const char*>(mapped);
+		bool success = format == Table::Format::CSV
+			? StreamCSV(data, st.st_size, fold, summaries)
+			: StreamBinary(data, st.st_size, fold, summaries);
+
+		delete batch;
+		munmap(mapped, st.st_size);
+
+		if (!success)
+			return false;
+
+		out = {};
+		for (const Summary& summary : summaries)
+			out.Merge(summary);
+		return true;
+	}
+
+	static std::string Number(value_type value)
+	{
+		return complex_to_string(std::complex<value_type>(value));
+	}
+
+	std::string Statistics::ToString(const Summary& summary, std::size_t bins)
+	{
+		const Moments& moments = summary.moments;
+
+		std::string result = std::to_string(moments.count) + " rows, " + std::to_string(summary.skipped) + " skipped";
+		if (moments.count == 0)
+			return result;
+
+		result += "\nmean " + Number(moments.mean) + ", standard deviation " + Number(std::sqrt(moments.Variance()));
+		result += "\nmin " + Number(moments.min) + ", max " + Number(moments.max);
+
+		// The sketch only knows values to its accuracy, the extremes are exact
+		result += "\nquantiles";
+		for (int percent : { 1, 5, 25, 50, 75, 95, 99 })
+		{
+			value_type quantile = std::clamp(summary.sketch.Quantile(percent / value_type(100)), moments.min, moments.max);
+			result += (percent == 1 ? " " : ", ") + std::to_string(percent) + "% " + Number(quantile);
+		}
+
+		if (bins == 0)
+			return result;
+
+		const value_type width = (moments.max - moments.min) / bins;
+		std::vector<uint64_t> counts(width > 0 ? bins : 1, 0);
+		summary.sketch.ForEach([&](value_type value, uint64_t count) {
+			std::size_t bin = 0;
+			if (width > 0)
+			{
+				value_type position = (std::clamp(value, moments.min, moments.max) - moments.min) / width;
+				bin = std::min(static_cast<std::size_t>(position), counts.size() - 1);
+			}
+			counts[bin] += count;
+		});
+
+		result += "\nhistogram";
+		for (std::size_t i = 0; i < counts.size(); i++)
+		{
+			const value_type low = moments.min + width * i;
+			const value_type high = i + 1 == counts.size() ? moments.max : moments.min + width * (i + 1);
+			result += "\n  [" + Number(low) + ", " + Number(high) + (i + 1 == counts.size() ? "] " : ") ") + std::to_string(counts[i]);
+		}
+
+		return result;
+	}
+
+}
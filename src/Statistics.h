@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Table.h"
+#include "TokenNode.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace bcalc::Statistics
+{
+
+	// Count, mean and variance by Welford's algorithm, with extremes. Partial results of disjoint rows
+	// merge with the pairwise update of Chan et al., so rows can be folded on separate threads.
+	struct Moments
+	{
+		uint64_t	count	= 0;
+		value_type	mean	= 0;
+		value_type	m2		= 0; // sum of squared differences from the mean
+		value_type	min		= std::numeric_limits<value_type>::infinity();
+		value_type	max		= -std::numeric_limits<value_type>::infinity();
+
+		void Add(value_type value);
+		void Merge(const Moments& other);
+
+		// Sample variance, 0 for less than two values
+		value_type Variance() const;
+	};
+
+	// Quantiles with a relative error of at most 'accuracy' in constant memory per order of magnitude (DDSketch).
+	// Values are counted in buckets whose bounds grow geometrically, merging sketches adds their counts.
+	class QuantileSketch
+	{
+	public:
+		QuantileSketch(value_type accuracy = 0.01);
+
+		void Add(value_type value);
+		void Merge(const QuantileSketch& other);
+
+		uint64_t Count() const { return m_count; }
+
+		// Value of rank 'q * (count - 1)' for 'q' in [0, 1], NaN if the sketch is empty
+		value_type Quantile(value_type q) const;
+
+		// Calls 'func(value, count)' for every non-empty bucket in ascending order of value
+		template<typename F>
+		void ForEach(F&& func) const
+		{
+			for (std::size_t i = m_negative.counts.size(); i-- > 0;)
+				if (m_negative.counts[i])
+					func(-Value(m_negative.offset + static_cast<int>(i)), m_negative.counts[i]);
+			if (m_zero)
+				func(value_type(0), m_zero);
+			for (std::size_t i = 0; i < m_positive.counts.size(); i++)
+				if (m_positive.counts[i])
+					func(Value(m_positive.offset + static_cast<int>(i)), m_positive.counts[i]);
+		}
+
+	private:
+		// Counts of consecutive bucket indices starting from 'offset', grown as needed
+		struct Store
+		{
+			int						offset = 0;
+			std::vector<uint64_t>	counts;
+
+			void Add(int index, uint64_t count);
+		};
+
+		int Index(value_type magnitude) const;
+		// Value representing bucket 'index', within the relative accuracy of everything counted in it
+		value_type Value(int index) const;
+
+	private:
+		value_type	m_gamma;
+		value_type	m_log_gamma;
+		Store		m_positive;
+		Store		m_negative; // by magnitude
+		uint64_t	m_zero	= 0; // values too small to index
+		uint64_t	m_count	= 0;
+	};
+
+	struct Summary
+	{
+		Moments			moments;
+		QuantileSketch	sketch;
+		uint64_t		skipped = 0; // rows that couldn't be read or had no real result
+
+		void Add(value_type value);
+		void Merge(const Summary& other);
+	};
+
+	// Maps the columnar file at 'path' and folds 'function' of every row into 'out', the parameters of the
+	// function being bound to the leading columns. CSV rows are lines of comma separated numbers, a first
+	// line with no number in those columns is taken as a header. Binary files hold native endian doubles row after row, as written
+	// by 'Table'. The file is split between threads whose summaries are merged, and rows are evaluated in
+	// blocks, in fast math mode with 'Batch' when the function allows. Returns false if the file can't be
+	// read or the evaluation was stopped.
+	bool Stream(const std::string& path, Table::Format format, const UserFunction& function, const VariableList& variables, const FunctionList& functions, Summary& out);
+
+	// Row counts, moments, common quantiles and a histogram of 'bins' equal bins over [min, max]. The
+	// histogram is built from the sketch, values near the bounds of a bin may be counted in its neighbour.
+	std::string ToString(const Summary& summary, std::size_t bins);
+
+}
@@ -0,0 +1,126 @@
+#include "Summation.h"
+
+#include "Batch.h"
+#include "Cancellation.h"
+#include "FastMath.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <cmath>
+
+namespace bcalc
+{
+
+	using complex = std::complex<value_type>;
+
+	// Terms are processed in fixed size blocks so the result does not depend on the number of threads
+	static constexpr uint64_t s_block_size = 4096;
+
+	// Blocks in flight at once, bounds the memory of their partial results for ranges of any length
+	static constexpr uint64_t s_block_round = 1024;
+
+	// Integers up to 2^53 are exact in double
+	static constexpr int64_t s_max_exact_index = int64_t(1) << 53;
+
+	template<typename T, typename F>
+	static CalcResult Reduce(const UserFunction& function, int64_t first, int64_t last, const VariableList& variables, const FunctionList& functions, T identity, F&& combine)
+	{
+		CalcResult error { .has_error = true };
+
+		if (function.parameters.size() != 1)
+			return error;
+		if (first > last)
+			return { .value = identity.Result() };
+
+		uint64_t count = static_cast<uint64_t>(last - first) + 1;
+		uint64_t blocks = (count + s_block_size - 1) / s_block_size;
+
+		T total = identity;
+		std::vector<T> partials;
+		std::atomic<bool> failed = false;
+
+		// In fast math mode terms are evaluated a block at a time, indices have to be exact in double
+		Batch* batch = nullptr;
+		if (FastMath::Enabled() && first >= -s_max_exact_index && last <= s_max_exact_index)
+			batch = Batch::Compile(function, variables, functions);
+
+		for (uint64_t round = 0; round < blocks && !failed; round += s_block_round)
+		{
+			partials.assign(std::min(s_block_round, blocks - round), identity);
+			ParallelFor(partials.size(), 1, [&](std::size_t begin, std::size_t end) {
+				std::vector<double> indices(batch ? s_block_size : 0);
+				std::vector<double> terms(indices.size());
+				const double* inputs[] = { indices.data() };
+
+				for (std::size_t block = begin; block < end && !failed; block++)
+				{
+					// Batches don't look at the budget themselves
+					if (Cancellation::Stopped())
+					{
+						failed = true;
+						return;
+					}
+
+					uint64_t offset = (round + block) * s_block_size;
+					uint64_t size = std::min(s_block_size, count - offset);
+
+					if (batch)
+					{
+						for (uint64_t i = 0; i < size; i++)
+							indices[i] = static_cast<double>(first + static_cast<int64_t>(offset + i));
+						if (!batch->Evaluate(inputs, terms.data(), size))
+						{
+							failed = true;
+							return;
+						}
+					}
+
+					for (uint64_t i = 0; i < size; i++)
+					{
+						// Terms without a finite real result in double are evaluated exactly
+						if (batch && !std::isnan(terms[i]))
+						{
+							combine(partials[block], complex(terms[i]));
+							continue;
+						}
+
+						auto result = Invoke(function, { static_cast<value_type>(first + static_cast<int64_t>(offset + i)) }, variables, functions);
+						if (result.has_error)
+						{
+							failed = true;
+							return;
+						}
+						combine(partials[block], result.value);
+					}
+				}
+			});
+
+			for (const auto& partial : partials)
+				total.Add(partial);
+		}
+
+		delete batch;
+
+		if (failed)
+			return error;
+		return { .value = total.Result() };
+	}
+
+	struct RunningProduct
+	{
+		void Add(const RunningProduct& other) { value *= other.value; }
+		complex Result() const { return value; }
+		complex value = 1;
+	};
+
+	CalcResult Summation::Sum(const UserFunction& function, int64_t first, int64_t last, const VariableList& variables, const FunctionList& functions)
+	{
+		return Reduce(function, first, last, variables, functions, CompensatedSum(), [](CompensatedSum& sum, const complex& value) { sum.Add(value); });
+	}
+
+	CalcResult Summation::Product(const UserFunction& function, int64_t first, int64_t last, const VariableList& variables, const FunctionList& functions)
+	{
+		return Reduce(function, first, last, variables, functions, RunningProduct(), [](RunningProduct& product, const complex& value) { product.value *= value; });
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "TokenNode.h"
+
+namespace bcalc
+{
+
+	// Neumaier's compensated summation, applied separately to the real and imaginary parts.
+	class CompensatedSum
+	{
+	public:
+		void Add(std::complex<value_type> value)
+		{
+			Accumulate(m_real, m_real_compensation, value.real());
+			Accumulate(m_imag, m_imag_compensation, value.imag());
+		}
+
+		void Add(const CompensatedSum& other)
+		{
+			m_real_compensation += other.m_real_compensation;
+			m_imag_compensation += other.m_imag_compensation;
+			Add(std::complex<value_type>(other.m_real, other.m_imag));
+		}
+
+		std::complex<value_type> Result() const
+		{
+			return { m_real + m_real_compensation, m_imag + m_imag_compensation };
+		}
+
+	private:
+		static void Accumulate(value_type& sum, value_type& compensation, value_type value)
+		{
+			value_type t = sum + value;
+			if (std::abs(sum) >= std::abs(value))
+				compensation += (sum - t) + value;
+			else
+				compensation += (value - t) + sum;
+			sum = t;
+		}
+
+	private:
+		value_type m_real				= 0;
+		value_type m_real_compensation	= 0;
+		value_type m_imag				= 0;
+		value_type m_imag_compensation	= 0;
+	};
+
+}
+
+namespace bcalc::Summation
+{
+
+	// Sum of 'function(k)' for integers k in [first, last], split across threads for large ranges.
+	CalcResult Sum(const UserFunction& function, int64_t first, int64_t last, const VariableList& variables, const FunctionList& functions);
+
+	// Product of 'function(k)' for integers k in [first, last], split across threads for large ranges.
+	CalcResult Product(const UserFunction& function, int64_t first, int64_t last, const VariableList& variables, const FunctionList& functions);
+
+}
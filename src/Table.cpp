@@ -0,0 +1,173 @@
+#include "Table.h"
+
+#include "Batch.h"
+#include "FastMath.h"
+#include "Parallel.h"
+
+#include <charconv>
+#include <cmath>
+#include <future>
+#include <limits>
+
+namespace bcalc
+{
+
+	static constexpr uint64_t s_chunk_rows = 1 << 16;
+
+	struct Chunk
+	{
+		std::vector<double>	values;
+		std::string			text;
+		bool				complete = false; // false if the evaluation stopped while the chunk was evaluated
+	};
+
+	static value_type Sample(value_type a, value_type b, uint64_t count, uint64_t index)
+	{
+		if (count == 1)
+			return a;
+		return a + (b - a) * index / (count - 1);
+	}
+
+	// 'coordinates(row, arguments)' fills in the function arguments for 'row'
+	template<typename F>
+	static bool Stream(FILE* output, Table::Format format, const char* header, uint64_t rows, const UserFunction& function, const VariableList& variables, const FunctionList& functions, F&& coordinates)
+	{
+		const std::size_t arity = function.parameters.size();
+		const std::size_t columns = arity + 2;
+
+		// Chunks are evaluated on other threads, they join the evaluation of this one
+		Cancellation* cancellation = Cancellation::Current();
+
+		// Functions the batch evaluator can handle are evaluated many rows at a time in fast math mode
+		Batch* batch = FastMath::Enabled() ? Batch::Compile(function, variables, functions) : nullptr;
+
+		auto evaluate = [&](uint64_t first, Chunk& chunk)
+		{
+			Cancellation::Join join(cancellation);
+
+			uint64_t count = std::min(s_chunk_rows, rows - first);
+			chunk.values.resize(count * columns);
+
+			ParallelFor(count, 1024, [&](std::size_t begin, std::size_t end) {
+				std::vector<std::complex<value_type>> arguments(arity);
+
+				// Rows the batch got a finite real result for are done, the rest are evaluated exactly. If the batch
+				// fails every row is.
+				std::vector<double> results;
+				bool batched = false;
+				if (batch)
+				{
+					std::vector<std::vector<double>> samples(arity, std::vector<double>(end - begin));
+					std::vector<const double*> inputs(arity);
+					for (std::size_t j = 0; j < arity; j++)
+						inputs[j] = samples[j].data();
+
+					for (std::size_t i = begin; i < end; i++)
+					{
+						double* row = chunk.values.data() + i * columns;
+
+						coordinates(first + i, arguments);
+						for (std::size_t j = 0; j < arity; j++)
+							samples[j][i - begin] = row[j] = static_cast<double>(arguments[j].real());
+					}
+
+					results.resize(end - begin);
+					batched = batch->Evaluate(inputs.data(), results.data(), results.size());
+				}
+
+				for (std::size_t i = begin; i < end; i++)
+				{
+					double* row = chunk.values.data() + i * columns;
+
+					if (batched && !std::isnan(results[i - begin]))
+					{
+						row[arity + 0] = results[i - begin];
+						row[arity + 1] = 0;
+						continue;
+					}
+
+					coordinates(first + i, arguments);
+					for (std::size_t j = 0; j < arity; j++)
+						row[j] = static_cast<double>(arguments[j].real());
+
+					auto result = Invoke(function, arguments, variables, functions);
+					row[arity + 0] = result.has_error ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(result.value.real());
+					row[arity + 1] = result.has_error ? std::numeric_limits<double>::quiet_NaN() : static_cast<double>(result.value.imag());
+				}
+			});
+
+			chunk.complete = !Cancellation::Stopped();
+			if (!chunk.complete || format != Table::Format::CSV)
+				return;
+
+			chunk.text.clear();
+			char buffer[32];
+			for (std::size_t i = 0; i < chunk.values.size(); i++)
+			{
+				auto [ptr, _] = std::to_chars(buffer, buffer + sizeof(buffer), chunk.values[i]);
+				*ptr++ = (i % columns == columns - 1) ? '\n' : ',';
+				chunk.text.append(buffer, ptr);
+			}
+		};
+
+		if (format == Table::Format::CSV)
+			fputs(header, output);
+
+		Chunk chunks[2];
+		std::future<void> pending;
+		if (rows > 0)
+			pending = std::async(std::launch::async, evaluate, 0, std::ref(chunks[0]));
+
+		// Evaluate the next chunk while the current one is being written
+		for (uint64_t first = 0, index = 0; first < rows; first += s_chunk_rows, index ^= 1)
+		{
+			pending.get();
+			if (!chunks[index].complete || Cancellation::Stopped())
+			{
+				delete batch;
+				return false;
+			}
+			if (first + s_chunk_rows < rows)
+				pending = std::async(std::launch::async, evaluate, first + s_chunk_rows, std::ref(chunks[index ^ 1]));
+
+			const Chunk& chunk = chunks[index];
+			if (format == Table::Format::CSV)
+				fwrite(chunk.text.data(), 1, chunk.text.size(), output);
+			else
+				fwrite(chunk.values.data(), sizeof(double), chunk.values.size(), output);
+		}
+
+		delete batch;
+
+		fflush(output);
+		return !ferror(output);
+	}
+
+	bool Table::Write(FILE* output, Format format, const UserFunction& function, value_type a, value_type b, uint64_t samples, const VariableList& variables, const FunctionList& functions)
+	{
+		if (function.parameters.size() != 1)
+			return false;
+
+		return Stream(output, format, "x,re,im\n", samples, function, variables, functions,
+			[&](uint64_t row, std::vector<std::complex<value_type>>& arguments)
+			{
+				arguments[0] = Sample(a, b, samples, row);
+			}
+		);
+	}
+
+	bool Table::WriteGrid(FILE* output, Format format, const UserFunction& function, value_type x0, value_type x1, uint64_t nx, value_type y0, value_type y1, uint64_t ny, const VariableList& variables, const FunctionList& functions)
+	{
+		if (function.parameters.size() != 2)
+			return false;
+
+		return Stream(output, format, "x,y,re,im\n", nx * ny, function, variables, functions,
+			[&](uint64_t row, std::vector<std::complex<value_type>>& arguments)
+			{
+				arguments[0] = Sample(x0, x1, nx, row / ny);
+				arguments[1] = Sample(y0, y1, ny, row % ny);
+			}
+		);
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "TokenNode.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace bcalc::Table
+{
+
+	enum class Format
+	{
+		CSV,	// text rows with a header line
+		Binary,	// native endian doubles, row after row
+	};
+
+	// Most rows a table or grid may have, 'table()' and 'grid()' reject larger counts
+	inline constexpr uint64_t s_max_rows = uint64_t(1) << 40;
+
+	// Streams 'samples' evenly spaced rows 'x, re f(x), im f(x)' for x in [a, b] to 'output'.
+	// Rows are evaluated in chunks on a worker thread while the previous chunk is being written.
+	// Points where the function can't be evaluated are written as NaN.
+	bool Write(FILE* output, Format format, const UserFunction& function, value_type a, value_type b, uint64_t samples, const VariableList& variables, const FunctionList& functions);
+
+	// Streams rows 'x, y, re f(x, y), im f(x, y)' over an 'nx' by 'ny' grid, y changing fastest.
+	bool WriteGrid(FILE* output, Format format, const UserFunction& function, value_type x0, value_type x1, uint64_t nx, value_type y0, value_type y1, uint64_t ny, const VariableList& variables, const FunctionList& functions);
+
+}
@@ -7,9 +7,11 @@ namespace bcalc
 		: m_type(type), m_value(value)
 	{}
 
-	Token Token::CreateValue(std::complex<value_type> value)
+	Token Token::CreateValue(std::complex<value_type> value, std::string literal)
 	{
-		return Token { TokenType::Value, std::move(value) };
+		Token token { TokenType::Value, std::move(value) };
+		token.m_literal = std::move(literal);
+		return token;
 	}
 
 	Token Token::CreateString(std::string string)
@@ -34,7 +36,7 @@ namespace bcalc
 
 	std::string Token::to_string() const
 	{
-		static_assert(static_cast<int>(TokenType::Count) == 13);
+		static_assert(static_cast<int>(TokenType::Count) == 22);
 
 		switch (m_type)
 		{
@@ -48,6 +50,8 @@ namespace bcalc
 				return "Comma";
 			case TokenType::Equals:
 				return "Equals";
+			case TokenType::Bind:
+				return "Bind";
 			case TokenType::BuiltinFunction:
 				return "Function, " + s_function_to_string.at(GetBuiltinFunction());
 			case TokenType::LParan:
@@ -64,6 +68,22 @@ namespace bcalc
 				return "Sub";
 			case TokenType::Power:
 				return "Power";
+			case TokenType::Less:
+				return "Less";
+			case TokenType::LessEqual:
+				return "LessEqual";
+			case TokenType::Greater:
+				return "Greater";
+			case TokenType::GreaterEqual:
+				return "GreaterEqual";
+			case TokenType::Equal:
+				return "Equal";
+			case TokenType::NotEqual:
+				return "NotEqual";
+			case TokenType::LBracket:
+				return "LBracket";
+			case TokenType::RBracket:
+				return "RBracket";
 		}
 
 		return "";
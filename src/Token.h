@@ -2,8 +2,11 @@
 
 #include <any>
 #include <complex>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 
 namespace bcalc
 {
@@ -41,9 +44,41 @@ namespace bcalc
 		Log,
 		Exp,
 		Round, Floor, Ceil,
+		Dot, Cross, MatMul, Transpose, Inverse, Det,
+		Diff, Grad,
+		Solve, Roots,
+		Sum, Prod, Integrate,
+		Table, Grid,
+		Matrix,
+		If,
+		Rand, Randn, McMean,
 		Count
 	};
-	static const std::unordered_map<std::string, FunctionType> s_string_to_function
+
+	// Builtins whose first argument names a user function instead of a value
+	inline bool IsHigherOrder(FunctionType function)
+	{
+		switch (function)
+		{
+			case FunctionType::Diff:
+			case FunctionType::Grad:
+			case FunctionType::Solve:
+			case FunctionType::Roots:
+			case FunctionType::Sum:
+			case FunctionType::Prod:
+			case FunctionType::Integrate:
+			case FunctionType::Table:
+			case FunctionType::Grid:
+			case FunctionType::Matrix:
+			case FunctionType::McMean:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// Names recognized by the lexer, an array so they can also be looked up at compile time (see Static.h)
+	inline constexpr std::pair<std::string_view, FunctionType> s_function_names[]
 	{
 		{ "sin",     FunctionType::Sin     },
 		{ "sinh",    FunctionType::Sinh    },
@@ -73,7 +108,33 @@ namespace bcalc
 		{ "round",   FunctionType::Round   },
 		{ "floor",   FunctionType::Floor   },
 		{ "ceil",    FunctionType::Ceil    },
+
+		{ "dot",       FunctionType::Dot       },
+		{ "cross",     FunctionType::Cross     },
+		{ "matmul",    FunctionType::MatMul    },
+		{ "transpose", FunctionType::Transpose },
+		{ "inverse",   FunctionType::Inverse   },
+		{ "det",       FunctionType::Det       },
+
+		{ "diff",    FunctionType::Diff    },
+		{ "grad",    FunctionType::Grad    },
+		{ "solve",   FunctionType::Solve   },
+		{ "roots",   FunctionType::Roots   },
+
+		{ "sum",       FunctionType::Sum       },
+		{ "prod",      FunctionType::Prod      },
+		{ "integrate", FunctionType::Integrate },
+		{ "table",     FunctionType::Table     },
+		{ "grid",      FunctionType::Grid      },
+		{ "matrix",    FunctionType::Matrix    },
+
+		{ "if",        FunctionType::If        },
+
+		{ "rand",      FunctionType::Rand      },
+		{ "randn",     FunctionType::Randn     },
+		{ "mc_mean",   FunctionType::McMean    },
 	};
+	static const std::unordered_map<std::string, FunctionType> s_string_to_function(std::begin(s_function_names), std::end(s_function_names));
 	static const std::unordered_map<FunctionType, std::string> s_function_to_string
 	{
 		{ FunctionType::Sin,     "sin"     },
@@ -98,6 +159,31 @@ namespace bcalc
 		{ FunctionType::Round,   "round"   },
 		{ FunctionType::Floor,   "floor"   },
 		{ FunctionType::Ceil,    "ceil"    },
+
+		{ FunctionType::Dot,       "dot"       },
+		{ FunctionType::Cross,     "cross"     },
+		{ FunctionType::MatMul,    "matmul"    },
+		{ FunctionType::Transpose, "transpose" },
+		{ FunctionType::Inverse,   "inverse"   },
+		{ FunctionType::Det,       "det"       },
+
+		{ FunctionType::Diff,    "diff"    },
+		{ FunctionType::Grad,    "grad"    },
+		{ FunctionType::Solve,   "solve"   },
+		{ FunctionType::Roots,   "roots"   },
+
+		{ FunctionType::Sum,       "sum"       },
+		{ FunctionType::Prod,      "prod"      },
+		{ FunctionType::Integrate, "integrate" },
+		{ FunctionType::Table,     "table"     },
+		{ FunctionType::Grid,      "grid"      },
+		{ FunctionType::Matrix,    "matrix"    },
+
+		{ FunctionType::If,        "if"        },
+
+		{ FunctionType::Rand,      "rand"      },
+		{ FunctionType::Randn,     "randn"     },
+		{ FunctionType::McMean,    "mc_mean"   },
 	};
 
 	enum class Constant
@@ -107,12 +193,13 @@ namespace bcalc
 		i,
 		Count
 	};
-	static const std::unordered_map<std::string, Constant> s_string_to_constant
+	inline constexpr std::pair<std::string_view, Constant> s_constant_names[]
 	{
 		{ "pi", Constant::pi },
 		{ "e",  Constant::e  },
 		{ "i",  Constant::i  },
 	};
+	static const std::unordered_map<std::string, Constant> s_string_to_constant(std::begin(s_constant_names), std::end(s_constant_names));
 	static const std::unordered_map<Constant, std::string> s_constant_to_string
 	{
 		{ Constant::pi, "pi" },
@@ -127,6 +214,7 @@ namespace bcalc
 		String,
 		Comma,
 		Equals,
+		Bind,
 		BuiltinFunction,
 		LParan,
 		RParan,
@@ -135,25 +223,50 @@ namespace bcalc
 		Add,
 		Sub,
 		Power,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Equal,
+		NotEqual,
+		LBracket,
+		RBracket,
 		Count
 	};
-	static const std::unordered_map<char, TokenType> s_char_to_token
+	inline constexpr std::pair<char, TokenType> s_operator_chars[]
 	{
 		{ ',', TokenType::Comma  },
 		{ '=', TokenType::Equals },
 		{ '(', TokenType::LParan },
 		{ ')', TokenType::RParan },
+		{ '[', TokenType::LBracket },
+		{ ']', TokenType::RBracket },
 		{ '*', TokenType::Mult   },
 		{ '/', TokenType::Div    },
 		{ '+', TokenType::Add    },
 		{ '-', TokenType::Sub    },
 		{ '^', TokenType::Power  },
+		{ '<', TokenType::Less    },
+		{ '>', TokenType::Greater },
+	};
+	static const std::unordered_map<char, TokenType> s_char_to_token(std::begin(s_operator_chars), std::end(s_operator_chars));
+
+	// Two character operators, matched before single characters
+	inline constexpr std::pair<std::string_view, TokenType> s_operator_strings[]
+	{
+		{ "<=", TokenType::LessEqual    },
+		{ ">=", TokenType::GreaterEqual },
+		{ "==", TokenType::Equal        },
+		{ "!=", TokenType::NotEqual     },
+		{ ":=", TokenType::Bind         },
 	};
+	static const std::unordered_map<std::string, TokenType> s_string_to_token(std::begin(s_operator_strings), std::end(s_operator_strings));
 
 	class Token
 	{
 	public:
-		static Token CreateValue(std::complex<value_type> value);
+		// 'literal' is the source text of lexed numbers, used to parse them again at higher precision
+		static Token CreateValue(std::complex<value_type> value, std::string literal = {});
 		static Token CreateString(std::string string);
 		static Token CreateBuiltinFunction(FunctionType function);
 		static Token CreateConstant(Constant constant);
@@ -165,7 +278,8 @@ namespace bcalc
 		std::complex<value_type> GetValue()	const { return std::any_cast<std::complex<value_type>>(m_value); }
 		Constant GetConstant()				const { return std::any_cast<Constant>(m_value); }
 		FunctionType GetBuiltinFunction()	const { return std::any_cast<FunctionType>(m_value); }
-		std::string GetString()				const { return std::any_cast<std::string>(m_value); }
+		const std::string& GetString()		const { return std::any_cast<const std::string&>(m_value); }
+		const std::string& GetLiteral()		const { return m_literal; }
 
 	private:
 		Token(TokenType type, std::any value = std::any());
@@ -173,6 +287,7 @@ namespace bcalc
 	private:
 		TokenType	m_type	= TokenType::Count;
 		std::any 	m_value;
+		std::string	m_literal;
 	};
 
 }
\ No newline at end of file
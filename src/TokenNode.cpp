@@ -1,11 +1,20 @@
 #include "TokenNode.h"
 
+#include "Differentiate.h"
+#include "FastMath.h"
+#include "Interpreter.h"
+#include "Quadrature.h"
+#include "Random.h"
+#include "Solve.h"
+#include "Summation.h"
+
+#include <cmath>
 #include <numbers>
 
 namespace bcalc
 {
 
-	static std::complex<value_type> EvaluateConstant(Constant constant)
+	std::complex<value_type> EvaluateConstant(Constant constant)
 	{
 		static_assert(static_cast<int>(Constant::Count) == 3);
 
@@ -22,19 +31,18 @@ namespace bcalc
 		throw;
 	}
 
-	static CalcResult EvaluateFunction(FunctionType function, const std::vector<TokenNode*>& nodes, const VariableList& variables, const FunctionList& functions)
+	CalcResult ApplyFunction(FunctionType function, const std::vector<std::complex<value_type>>& inputs)
 	{
-		static_assert(static_cast<int>(FunctionType::Count) == 18);
+		static_assert(static_cast<int>(FunctionType::Count) == 38);
 
 		CalcResult error { .has_error = true };
-		
-		std::vector<std::complex<value_type>> inputs;
-		for (TokenNode* node : nodes)
+
+		// Real arguments in the accurate range of a kernel, anything else falls through to the exact path
+		if (FastMath::Enabled() && inputs.size() == 1 && inputs[0].imag() == 0 && FastMath::HasKernel(function))
 		{
-			auto result = node->approximate(variables, functions);
-			if (result.has_error)
-				return error;
-			inputs.push_back(result.value);
+			const double value = FastMath::Apply(function, static_cast<double>(inputs[0].real()));
+			if (std::isfinite(value))
+				return { .value = value };
 		}
 
 		switch (function)
@@ -78,6 +86,7 @@ namespace bcalc
 			case FunctionType::ArcTan:
 				if (inputs.size() != 1)
 					return error;
+				return { .value = std::atan(inputs[0]) };
 			case FunctionType::Tanh:
 				if (inputs.size() != 1)
 					return error;
@@ -103,29 +112,278 @@ namespace bcalc
 			case FunctionType::Round:
 				if (inputs.size() != 1)
 					return error;
-				return { .value = std::complex<value_type>(std::round(inputs[0].real()), std::round(inputs[1].imag())) };
+				return { .value = std::complex<value_type>(std::round(inputs[0].real()), std::round(inputs[0].imag())) };
 			case FunctionType::Floor:
 				if (inputs.size() != 1)
 					return error;
-				return { .value = std::complex<value_type>(std::floor(inputs[0].real()), std::floor(inputs[1].imag())) };
+				return { .value = std::complex<value_type>(std::floor(inputs[0].real()), std::floor(inputs[0].imag())) };
 			case FunctionType::Ceil:
 				if (inputs.size() != 1)
 					return error;
-				return { .value = std::complex<value_type>(std::ceil(inputs[0].real()), std::ceil(inputs[1].imag())) };
+				return { .value = std::complex<value_type>(std::ceil(inputs[0].real()), std::ceil(inputs[0].imag())) };
+			// Scalars act as 1 by 1 matrices, vectors and matrices are handled in Linear.h
+			case FunctionType::Dot:
+			case FunctionType::MatMul:
+				if (inputs.size() != 2)
+					return error;
+				return { .value = inputs[0] * inputs[1] };
+			case FunctionType::Transpose:
+			case FunctionType::Det:
+				if (inputs.size() != 1)
+					return error;
+				return { .value = inputs[0] };
+			case FunctionType::Inverse:
+				if (inputs.size() != 1 || inputs[0] == std::complex<value_type>(0))
+					return error;
+				return { .value = std::complex<value_type>(1) / inputs[0] };
+			case FunctionType::Cross:
+				return error;
+			case FunctionType::Diff:
+			case FunctionType::Grad:
+			case FunctionType::Solve:
+			case FunctionType::Roots:
+			case FunctionType::Sum:
+			case FunctionType::Prod:
+			case FunctionType::Integrate:
+			case FunctionType::Table:
+			case FunctionType::Grid:
+			case FunctionType::Matrix:
+			case FunctionType::McMean:
+				return error;
+			case FunctionType::If:
+				if (inputs.size() != 3)
+					return error;
+				return { .value = inputs[0] != std::complex<value_type>(0) ? inputs[1] : inputs[2] };
+			case FunctionType::Rand:
+				if (inputs.size() != 0)
+					return error;
+				return { .value = Random::Uniform() };
+			case FunctionType::Randn:
+				if (inputs.size() != 0)
+					return error;
+				return { .value = Random::Normal() };
+		}
+
+		return error;
+	}
+
+	CalcResult ApplyOperator(TokenType type, const std::complex<value_type>& lhs, const std::complex<value_type>& rhs)
+	{
+		switch (type)
+		{
+			case TokenType::Add:	return { .value = lhs + rhs };
+			case TokenType::Sub:	return { .value = lhs - rhs };
+			case TokenType::Mult:	return { .value = lhs * rhs };
+			case TokenType::Div:	return { .value = lhs / rhs };
+			case TokenType::Power:	return { .value = std::pow(lhs, rhs) };
+			default:
+				break;
+		}
+
+		if (auto comparison = Compare(type, lhs, rhs); comparison >= 0)
+			return { .value = comparison };
+
+		return { .has_error = true };
+	}
+
+	int Compare(TokenType type, const std::complex<value_type>& lhs, const std::complex<value_type>& rhs)
+	{
+		switch (type)
+		{
+			case TokenType::Less:			return lhs.real() <  rhs.real();
+			case TokenType::LessEqual:		return lhs.real() <= rhs.real();
+			case TokenType::Greater:		return lhs.real() >  rhs.real();
+			case TokenType::GreaterEqual:	return lhs.real() >= rhs.real();
+			case TokenType::Equal:			return lhs == rhs;
+			case TokenType::NotEqual:		return lhs != rhs;
+			default:
+				break;
+		}
+		return -1;
+	}
+
+	const UserFunction* FindFunction(const FunctionList& functions, const std::string& name, std::size_t parameter_count)
+	{
+		auto it = functions.find(name);
+		if (it == functions.end())
+			return nullptr;
+
+		auto overload_it = it->second.find(parameter_count);
+		if (overload_it == it->second.end())
+			return nullptr;
+
+		return &overload_it->second;
+	}
+
+	CalcResult Invoke(const UserFunction& function, const std::vector<std::complex<value_type>>& arguments, const VariableList& variables, const FunctionList& functions)
+	{
+		if (arguments.size() != function.parameters.size())
+			return { .has_error = true };
+
+		if (function.code)
+			return Interpreter::Execute(*function.code, arguments, variables, functions);
+
+		// Add function parameters to variables.
+		VariableList parameters = variables;
+		for (std::size_t i = 0; i < arguments.size(); i++)
+			parameters[function.parameters[i]] = arguments[i];
+
+		auto result = function.expression->approximate(parameters, functions);
+		if (result.has_error)
+			return { .has_error = true };
+		return { .value = result.value };
+	}
+
+	CalcResult ApplyHigherOrder(FunctionType function, const std::string& name, const std::vector<std::complex<value_type>>& inputs, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		switch (function)
+		{
+			case FunctionType::Diff:
+			{
+				// diff(f, x1, ..., xn): derivative with respect to the first parameter
+				const UserFunction* user_function = FindFunction(functions, name, inputs.size());
+				if (!user_function || inputs.empty())
+					return error;
+				return Differentiate::Forward(*user_function, 0, inputs, variables, functions);
+			}
+			case FunctionType::Grad:
+			{
+				// grad(f, x): derivative of a single parameter function, longer gradients are vectors (see Linear.h)
+				const UserFunction* user_function = FindFunction(functions, name, inputs.size());
+				if (!user_function || inputs.size() != 1)
+					return error;
+
+				auto gradient = Differentiate::Reverse(*user_function, inputs, variables, functions);
+				if (gradient.empty())
+					return error;
+				return { .value = gradient[0] };
+			}
+			case FunctionType::Solve:
+			{
+				// solve(f, x0): Newton's method, several starting points give a vector (see Linear.h)
+				const UserFunction* user_function = FindFunction(functions, name, 1);
+				if (!user_function || inputs.size() != 1)
+					return error;
+				return Solve::Newton(*user_function, inputs[0], variables, functions);
+			}
+			case FunctionType::Roots:
+			{
+				// roots(f, a, b[, n]): the real root in [a, b] searched over n subintervals, several are a vector (see Linear.h)
+				const UserFunction* user_function = FindFunction(functions, name, 1);
+				if (!user_function || (inputs.size() != 2 && inputs.size() != 3))
+					return error;
+
+				std::size_t intervals = 100;
+				if (inputs.size() == 3)
+				{
+					if (inputs[2].real() < 1)
+						return error;
+					intervals = static_cast<std::size_t>(inputs[2].real());
+				}
+
+				auto roots = Solve::Roots(*user_function, inputs[0].real(), inputs[1].real(), intervals, variables, functions);
+				if (roots.size() != 1)
+					return error;
+				return { .value = roots.front() };
 			}
+			case FunctionType::Sum:
+			case FunctionType::Prod:
+			{
+				// sum(f, a, b) / prod(f, a, b): over integers k in [a, b]
+				const UserFunction* user_function = FindFunction(functions, name, 1);
+				if (!user_function || inputs.size() != 2)
+					return error;
+
+				for (const auto& input : inputs)
+					if (input.imag() != 0 || input.real() != std::round(input.real()) || std::abs(input.real()) > 9e18L)
+						return error;
+
+				int64_t first = static_cast<int64_t>(inputs[0].real());
+				int64_t last = static_cast<int64_t>(inputs[1].real());
+				if (function == FunctionType::Sum)
+					return Summation::Sum(*user_function, first, last, variables, functions);
+				return Summation::Product(*user_function, first, last, variables, functions);
+			}
+			case FunctionType::Integrate:
+			{
+				// integrate(f, a, b[, tol])
+				const UserFunction* user_function = FindFunction(functions, name, 1);
+				if (!user_function || (inputs.size() != 2 && inputs.size() != 3))
+					return error;
+
+				value_type tolerance = inputs.size() == 3 ? inputs[2].real() : Quadrature::s_default_tolerance;
+				return Quadrature::Integrate(*user_function, inputs[0], inputs[1], tolerance, variables, functions);
+			}
+			default:
+				break;
+		}
 
 		return error;
 	}
 
+	static CalcResult EvaluateHigherOrder(FunctionType function, const std::vector<TokenNode*>& nodes, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (nodes.empty() || nodes[0]->GetToken().Type() != TokenType::String || !nodes[0]->GetNodes().empty())
+			return error;
+
+		std::vector<std::complex<value_type>> inputs;
+		for (std::size_t i = 1; i < nodes.size(); i++)
+		{
+			auto result = nodes[i]->approximate(variables, functions);
+			if (result.has_error)
+				return error;
+			inputs.push_back(result.value);
+		}
+
+		return ApplyHigherOrder(function, nodes[0]->GetToken().GetString(), inputs, variables, functions);
+	}
+
+	static CalcResult EvaluateFunction(FunctionType function, const std::vector<TokenNode*>& nodes, const VariableList& variables, const FunctionList& functions)
+	{
+		CalcResult error { .has_error = true };
+
+		if (IsHigherOrder(function))
+			return EvaluateHigherOrder(function, nodes, variables, functions);
+
+		// Only the selected branch of 'if' is evaluated
+		if (function == FunctionType::If)
+		{
+			if (nodes.size() != 3)
+				return error;
+			auto condition = nodes[0]->approximate(variables, functions);
+			if (condition.has_error)
+				return error;
+			return nodes[condition.value != std::complex<value_type>(0) ? 1 : 2]->approximate(variables, functions);
+		}
+
+		std::vector<std::complex<value_type>> inputs;
+		for (TokenNode* node : nodes)
+		{
+			auto result = node->approximate(variables, functions);
+			if (result.has_error)
+				return error;
+			inputs.push_back(result.value);
+		}
+
+		return ApplyFunction(function, inputs);
+	}
+
 	TokenNode::TokenNode(Token token, std::vector<TokenNode*> nodes)
 		: m_nodes(std::move(nodes))
-		, m_token(token)
+		, m_token(std::move(token))
 	{}
 
 	CalcResult TokenNode::approximate(const VariableList& variables, const FunctionList& functions) const
 	{
 		CalcResult error { .has_error = true };
 
+		if (!Cancellation::Checkpoint())
+			return error;
+
 		if (m_token.Type() == TokenType::Value)
 			return { .value = m_token.GetValue() };
 
@@ -137,30 +395,18 @@ namespace bcalc
 			if (auto it = variables.find(m_token.GetString()); it != variables.end())
 				return { .value = it->second };
 
-			if (auto it = functions.find(m_token.GetString()); it != functions.end())
+			if (const UserFunction* function = FindFunction(functions, m_token.GetString(), m_nodes.size()))
 			{
-				const auto& func_overloads = it->second;
-
-				auto overload_it = func_overloads.find(m_nodes.size());
-				if (overload_it == func_overloads.end())
-					return error;
-
-				const auto& overload = overload_it->second;
-
-				// Add function parameters to variables.
-				VariableList parameters = variables;
-				for (std::size_t i = 0; i < m_nodes.size(); i++)
+				std::vector<std::complex<value_type>> arguments;
+				for (TokenNode* node : m_nodes)
 				{
-					auto result = m_nodes[i]->approximate(variables, functions);
+					auto result = node->approximate(variables, functions);
 					if (result.has_error)
 						return error;
-					parameters[overload.parameters[i]] = result.value;
+					arguments.push_back(result.value);
 				}
 
-				auto result = overload.expression->approximate(parameters, functions);
-				if (result.has_error)
-					return error;
-				return { .value = result.value };
+				return Invoke(*function, arguments, variables, functions);
 			}
 
 			return error;
@@ -178,16 +424,15 @@ namespace bcalc
 		if (lhs.has_error || rhs.has_error)
 			return error;
 
-		switch (m_token.Type())
-		{
-			case TokenType::Add:	return { .value = lhs.value + rhs.value };
-			case TokenType::Sub:	return { .value = lhs.value - rhs.value };
-			case TokenType::Mult:	return { .value = lhs.value * rhs.value };
-			case TokenType::Div:	return { .value = lhs.value / rhs.value };
-			case TokenType::Power:	return { .value = std::pow(lhs.value, rhs.value) };
-		}
+		return ApplyOperator(m_token.Type(), lhs.value, rhs.value);
+	}
 
-		return error;
+	void TokenNode::CollectIdentifiers(std::unordered_set<std::string>& identifiers) const
+	{
+		if (m_token.Type() == TokenType::String)
+			identifiers.insert(m_token.GetString());
+		for (TokenNode* node : m_nodes)
+			node->CollectIdentifiers(identifiers);
 	}
 
 	std::string TokenNode::to_string(uint64_t indent) const
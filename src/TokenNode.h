@@ -1,29 +1,55 @@
 #pragma once
 
+#include "Cancellation.h"
 #include "Token.h"
 
+#include <unordered_set>
 #include <vector>
 
 namespace bcalc
 {
 	class TokenNode;
+	struct Bytecode;
 
 	struct CalcResult
 	{
 		bool has_error = false;
 		bool has_value = true; // only used in return value of 'Program::Process()'
+		StopReason stop = StopReason::None; // only used in return value of 'Program::Process()'
 		std::complex<value_type> value = 0;
+		std::string text; // only used in return value of 'Program::Process()', formatted multi-precision or matrix result
 	};
 
 	struct UserFunction
 	{
 		std::vector<std::string> parameters;
 		TokenNode* expression;
+		Bytecode* code = nullptr; // compiled 'expression', used for calls when present
 	};
 
 	using VariableList = std::unordered_map<std::string, std::complex<value_type>>;
 	using FunctionList = std::unordered_map<std::string, std::unordered_map<std::size_t, UserFunction>>;
 
+	std::complex<value_type> EvaluateConstant(Constant constant);
+	CalcResult ApplyFunction(FunctionType function, const std::vector<std::complex<value_type>>& inputs);
+
+	// Applies an arithmetic or comparison operator.
+	CalcResult ApplyOperator(TokenType type, const std::complex<value_type>& lhs, const std::complex<value_type>& rhs);
+
+	// Returns 1 or 0 for comparison tokens, -1 if 'type' is not a comparison.
+	// Ordering compares real parts, equality compares the whole complex value.
+	int Compare(TokenType type, const std::complex<value_type>& lhs, const std::complex<value_type>& rhs);
+
+	// Returns the overload of 'name' taking 'parameter_count' parameters or nullptr if there is none.
+	const UserFunction* FindFunction(const FunctionList& functions, const std::string& name, std::size_t parameter_count);
+
+	// Applies a builtin operating on user functions to the function 'name' and the values of its other arguments.
+	// The function sees 'variables' and its own parameters only.
+	CalcResult ApplyHigherOrder(FunctionType function, const std::string& name, const std::vector<std::complex<value_type>>& inputs, const VariableList& variables, const FunctionList& functions);
+
+	// Evaluates 'function' with 'arguments' bound to its parameters.
+	CalcResult Invoke(const UserFunction& function, const std::vector<std::complex<value_type>>& arguments, const VariableList& variables, const FunctionList& functions);
+
 	class TokenNode
 	{
 	public:
@@ -36,6 +62,12 @@ namespace bcalc
 
 		CalcResult approximate(const VariableList& variables, const FunctionList& functions) const;
 
+		const Token& GetToken()						const { return m_token; }
+		const std::vector<TokenNode*>& GetNodes()	const { return m_nodes; }
+
+		// Collects names of all variables and user functions referenced by this tree.
+		void CollectIdentifiers(std::unordered_set<std::string>& identifiers) const;
+
 		std::string to_string(uint64_t indent = 0) const;
 
 	private:
@@ -0,0 +1,14 @@
+#pragma once
+
+// Included first by files with array loops written to vectorize. Vectorization isn't on by default at -O2, and
+// comparisons that may trap on NaN keep selects from being vectorized, so the options below apply to the rest of
+// the including file. Functions marked with 'BCALC_VECTOR_TARGETS' are compiled for each of the listed CPUs and
+// picked by the CPU on first call.
+//
+// Both are GCC features for x86, other compilers and architectures build the same code without them.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#pragma GCC optimize("tree-vectorize", "vect-cost-model=dynamic", "no-trapping-math", "no-math-errno")
+#define BCALC_VECTOR_TARGETS __attribute__((target_clones("default", "arch=haswell", "arch=skylake-avx512")))
+#else
+#define BCALC_VECTOR_TARGETS
+#endif
@@ -0,0 +1,438 @@
+#include "Workspace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bcalc
+{
+
+	// Token types, builtins and constants are stored by number, 's_version' has to change with them
+	static_assert(static_cast<int>(TokenType::Count) == 22);
+	static_assert(static_cast<int>(FunctionType::Count) == 38);
+	static_assert(static_cast<int>(Constant::Count) == 3);
+
+	static constexpr char s_magic[8] = { 'b', 'c', 'a', 'l', 'c', 'w', 's', '\0' };
+	static constexpr uint32_t s_version = 4;
+
+	// Bytes of a value that hold it, the x87 format of 64 digits is 10 bytes padded to 12 or 16. The padding is
+	// never written, it holds whatever was in memory and would make saving the same session give different files.
+	static constexpr std::size_t s_value_bytes = std::numeric_limits<value_type>::digits == 64 ? 10 : sizeof(value_type);
+
+	// Trees nested deeper than this are treated as damage rather than read recursively
+	static constexpr std::size_t s_max_depth = 1 << 12;
+
+	// File layout, all integers native endian:
+	//   header
+	//   u32 count, then per variable:	string name, value re, value im
+	//   u32 count, then per matrix:	string name, u32 rows, u32 columns, values re, im in row major order
+	//   u32 count, then per function:	string name, u32 count, strings parameters, tree
+	//   u32 count, then per binding:	string name, tree
+	// A string is its u32 length and bytes. A tree is its nodes in preorder, each node being u8 token type,
+	// the payload of the type (value re, value im and string literal / u8 constant / string name /
+	// u8 builtin) and u32 number of children.
+	struct Header
+	{
+		char		magic[8];
+		uint32_t	version;
+		uint32_t	value_size; // 's_value_bytes', long double differs between platforms
+	};
+
+	class Writer
+	{
+	public:
+		template<typename T>
+		void Put(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			m_data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void PutString(std::string_view string)
+		{
+			Put(static_cast<uint32_t>(string.size()));
+			m_data.append(string);
+		}
+
+		void PutValue(const std::complex<value_type>& value)
+		{
+			for (const value_type part : { value.real(), value.imag() })
+				m_data.append(reinterpret_cast<const char*>(&part), s_value_bytes);
+		}
+
+		void PutTree(const TokenNode* node)
+		{
+			const Token& token = node->GetToken();
+			Put(static_cast<uint8_t>(token.Type()));
+
+			switch (token.Type())
+			{
+				case TokenType::Value:
+					PutValue(token.GetValue());
+					PutString(token.GetLiteral());
+					break;
+				case TokenType::Constant:
+					Put(static_cast<uint8_t>(token.GetConstant()));
+					break;
+				case TokenType::String:
+					PutString(token.GetString());
+					break;
+				case TokenType::BuiltinFunction:
+					Put(static_cast<uint8_t>(token.GetBuiltinFunction()));
+					break;
+				default:
+					break;
+			}
+
+			Put(static_cast<uint32_t>(node->GetNodes().size()));
+			for (const TokenNode* child : node->GetNodes())
+				PutTree(child);
+		}
+
+		const std::string& Data() const { return m_data; }
+
+	private:
+		std::string m_data;
+	};
+
+	// Reads from the mapped file, every read is bounds checked
+	class Reader
+	{
+	public:
+		Reader(const char* data, std::size_t size)
+			: m_current(data)
+			, m_end(data + size)
+		{}
+
+		template<typename T>
+		bool Get(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			if (static_cast<std::size_t>(m_end - m_current) < sizeof(T))
+				return false;
+			memcpy(&value, m_current, sizeof(T));
+			m_current += sizeof(T);
+			return true;
+		}
+
+		bool GetString(std::string& string)
+		{
+			uint32_t size;
+			if (!Get(size) || static_cast<std::size_t>(m_end - m_current) < size)
+				return false;
+			string.assign(m_current, size);
+			m_current += size;
+			return true;
+		}
+
+		bool GetValue(std::complex<value_type>& value)
+		{
+			if (static_cast<std::size_t>(m_end - m_current) < 2 * s_value_bytes)
+				return false;
+			value_type real = 0, imag = 0;
+			memcpy(&real, m_current, s_value_bytes);
+			memcpy(&imag, m_current + s_value_bytes, s_value_bytes);
+			m_current += 2 * s_value_bytes;
+			value = { real, imag };
+			return true;
+		}
+
+		// A damaged size can't allocate more than the file holds
+		bool HasValues(uint64_t count) const
+		{
+			return count <= static_cast<std::size_t>(m_end - m_current) / (2 * s_value_bytes);
+		}
+
+		// Returns nullptr if the tree is damaged
+		TokenNode* GetTree(std::size_t depth = 0)
+		{
+			uint8_t type;
+			if (depth >= s_max_depth || !Get(type))
+				return nullptr;
+
+			std::optional<Token> token;
+			switch (static_cast<TokenType>(type))
+			{
+				case TokenType::Value:
+				{
+					std::complex<value_type> value;
+					std::string literal;
+					if (!GetValue(value) || !GetString(literal))
+						return nullptr;
+					token = Token::CreateValue(value, std::move(literal));
+					break;
+				}
+				case TokenType::Constant:
+				{
+					uint8_t constant;
+					if (!Get(constant) || constant >= static_cast<uint8_t>(Constant::Count))
+						return nullptr;
+					token = Token::CreateConstant(static_cast<Constant>(constant));
+					break;
+				}
+				case TokenType::String:
+				{
+					std::string name;
+					if (!GetString(name) || name.empty())
+						return nullptr;
+					token = Token::CreateString(std::move(name));
+					break;
+				}
+				case TokenType::BuiltinFunction:
+				{
+					uint8_t function;
+					if (!Get(function) || function >= static_cast<uint8_t>(FunctionType::Count))
+						return nullptr;
+					token = Token::CreateBuiltinFunction(static_cast<FunctionType>(function));
+					break;
+				}
+				// Punctuation never appears in trees
+				case TokenType::Comma:
+				case TokenType::Equals:
+				case TokenType::Bind:
+				case TokenType::LParan:
+				case TokenType::RParan:
+				case TokenType::RBracket:
+					return nullptr;
+				default:
+					if (type >= static_cast<uint8_t>(TokenType::Count))
+						return nullptr;
+					token = Token::Create(static_cast<TokenType>(type));
+					break;
+			}
+
+			uint32_t count;
+			if (!Get(count))
+				return nullptr;
+
+			// Every child takes at least 5 bytes, a damaged count can't reserve more than the file holds
+			std::vector<TokenNode*> nodes;
+			nodes.reserve(std::min<std::size_t>(count, (m_end - m_current) / 5));
+			for (uint32_t i = 0; i < count; i++)
+			{
+				TokenNode* child = GetTree(depth + 1);
+				if (!child)
+				{
+					for (TokenNode* node : nodes)
+						delete node;
+					return nullptr;
+				}
+				nodes.push_back(child);
+			}
+
+			return new TokenNode(std::move(*token), std::move(nodes));
+		}
+
+		bool AtEnd() const { return m_current == m_end; }
+
+	private:
+		const char* m_current;
+		const char* m_end;
+	};
+
+	void Workspace::Free(Definitions& definitions)
+	{
+		for (auto& function : definitions.functions)
+			delete function.expression;
+		for (auto& binding : definitions.bindings)
+			delete binding.expression;
+		definitions = {};
+	}
+
+	static bool Read(Reader& reader, Workspace::Definitions& out)
+	{
+		Header header;
+		if (!reader.Get(header) || memcmp(header.magic, s_magic, sizeof(s_magic)) != 0)
+			return false;
+		if (header.version != s_version || header.value_size != s_value_bytes)
+			return false;
+
+		uint32_t count;
+
+		if (!reader.Get(count))
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			std::string name;
+			std::complex<value_type> value;
+			if (!reader.GetString(name) || !reader.GetValue(value))
+				return false;
+			out.variables[std::move(name)] = value;
+		}
+
+		if (!reader.Get(count))
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			std::string name;
+			uint32_t rows, columns;
+			if (!reader.GetString(name) || !reader.Get(rows) || !reader.Get(columns))
+				return false;
+			if (rows == 0 || columns == 0 || !reader.HasValues(static_cast<uint64_t>(rows) * columns))
+				return false;
+
+			Linear::Matrix matrix(rows, columns);
+			for (std::size_t j = 0; j < matrix.Size(); j++)
+				if (!reader.GetValue(matrix.Data()[j]))
+					return false;
+			out.matrices[std::move(name)] = std::move(matrix);
+		}
+
+		if (!reader.Get(count))
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Workspace::Definitions::Function function { .expression = nullptr };
+
+			uint32_t parameter_count;
+			if (!reader.GetString(function.name) || !reader.Get(parameter_count))
+				return false;
+			for (uint32_t j = 0; j < parameter_count; j++)
+				if (!reader.GetString(function.parameters.emplace_back()))
+					return false;
+
+			if (!(function.expression = reader.GetTree()))
+				return false;
+			out.functions.push_back(std::move(function));
+		}
+
+		if (!reader.Get(count))
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Workspace::Definitions::Binding binding { .expression = nullptr };
+			if (!reader.GetString(binding.name) || !(binding.expression = reader.GetTree()))
+				return false;
+			out.bindings.push_back(std::move(binding));
+		}
+
+		return reader.AtEnd();
+	}
+
+	// Entries of an unordered map by key, their order in the map depends on the history of the session
+	template<typename Map>
+	static std::vector<const typename Map::value_type*> Sorted(const Map& map)
+	{
+		std::vector<const typename Map::value_type*> result;
+		result.reserve(map.size());
+		for (const auto& entry : map)
+			result.push_back(&entry);
+		std::sort(result.begin(), result.end(), [](const auto* lhs, const auto* rhs) { return lhs->first < rhs->first; });
+		return result;
+	}
+
+	bool Workspace::Save(const std::string& path, const VariableList& variables, const Linear::MatrixList& matrices, const FunctionList& functions, const std::unordered_map<std::string, TokenNode*>& bindings)
+	{
+		Writer writer;
+
+		Header header { .version = s_version, .value_size = s_value_bytes };
+		memcpy(header.magic, s_magic, sizeof(s_magic));
+		writer.Put(header);
+
+		writer.Put(static_cast<uint32_t>(variables.size()));
+		// Sorted so saving the same definitions always gives the same file
+		for (const auto* entry : Sorted(variables))
+		{
+			const auto& [name, value] = *entry;
+			writer.PutString(name);
+			writer.PutValue(value);
+		}
+
+		writer.Put(static_cast<uint32_t>(matrices.size()));
+		for (const auto* entry : Sorted(matrices))
+		{
+			const auto& [name, matrix] = *entry;
+			writer.PutString(name);
+			writer.Put(static_cast<uint32_t>(matrix.Rows()));
+			writer.Put(static_cast<uint32_t>(matrix.Columns()));
+			for (std::size_t i = 0; i < matrix.Size(); i++)
+				writer.PutValue(matrix.Data()[i]);
+		}
+
+		uint32_t function_count = 0;
+		for (const auto& [_, overloads] : functions)
+			function_count += overloads.size();
+		writer.Put(function_count);
+		for (const auto* entry : Sorted(functions))
+		{
+			const auto& [name, overloads] = *entry;
+			for (const auto* overload : Sorted(overloads))
+			{
+				const UserFunction& function = overload->second;
+				writer.PutString(name);
+				writer.Put(static_cast<uint32_t>(function.parameters.size()));
+				for (const auto& parameter : function.parameters)
+					writer.PutString(parameter);
+				writer.PutTree(function.expression);
+			}
+		}
+
+		writer.Put(static_cast<uint32_t>(bindings.size()));
+		for (const auto* entry : Sorted(bindings))
+		{
+			const auto& [name, expression] = *entry;
+			writer.PutString(name);
+			writer.PutTree(expression);
+		}
+
+		// Written next to the target and renamed over it, a failed save leaves the old workspace intact
+		const std::string temporary = path + ".tmp";
+		FILE* file = fopen(temporary.c_str(), "wb");
+		if (!file)
+			return false;
+
+		const std::string& data = writer.Data();
+		bool success = fwrite(data.data(), 1, data.size(), file) == data.size();
+		success = fclose(file) == 0 && success;
+
+		if (!success || rename(temporary.c_str(), path.c_str()) != 0)
+		{
+			remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool Workspace::Load(const std::string& path, Definitions& out)
+	{
+		int file = open(path.c_str(), O_RDONLY);
+		if (file == -1)
+			return false;
+
+		struct stat st;
+		if (fstat(file, &st) == -1 || st.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (mapped == MAP_FAILED)
+			return false;
+
+		Definitions definitions;
+		Reader reader(static_cast<const char*>(mapped), st.st_size);
+		bool success = Read(reader, definitions);
+		munmap(mapped, st.st_size);
+
+		if (!success)
+		{
+			Workspace::Free(definitions);
+			return false;
+		}
+
+		out = std::move(definitions);
+		return true;
+	}
+
+}
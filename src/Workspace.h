@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Linear.h"
+#include "TokenNode.h"
+
+#include <string>
+#include <vector>
+
+namespace bcalc::Workspace
+{
+
+	// Definitions read from a workspace file. Expressions are owned by the receiver of 'Load()'.
+	struct Definitions
+	{
+		struct Function
+		{
+			std::string					name;
+			std::vector<std::string>	parameters;
+			TokenNode*					expression;
+		};
+
+		struct Binding
+		{
+			std::string	name;
+			TokenNode*	expression;
+		};
+
+		VariableList			variables;
+		Linear::MatrixList		matrices;
+		std::vector<Function>	functions;
+		std::vector<Binding>	bindings;
+	};
+
+	// Writes variables, matrices, every overload of every function and the expressions of reactive bindings to 'path'.
+	// Expressions are stored as token trees, so loading needs no lexing or parsing. The file holds no pointers
+	// and values are the bytes of native endian long doubles without padding, so it can be used on any machine with
+	// the same long double.
+	bool Save(const std::string& path, const VariableList& variables, const Linear::MatrixList& matrices, const FunctionList& functions, const std::unordered_map<std::string, TokenNode*>& bindings);
+
+	// Maps 'path' and reads its definitions. Returns false without filling 'out' if the file can't be read,
+	// is of another version or is damaged.
+	bool Load(const std::string& path, Definitions& out);
+
+	// Deletes the expressions of 'definitions'
+	void Free(Definitions& definitions);
+
+}
@@ -1,12 +1,46 @@
+#include "History.h"
+#include "Preview.h"
 #include "Program.h"
 
+#include <csignal>
 #include <cstdio>
 #include <cstring>
 
+#include <future>
 #include <sstream>
 
 #include <ncurses.h>
 
+static constexpr int s_key_search = 'R' & 0x1F;
+static constexpr int s_key_cancel = 'G' & 0x1F;
+
+// How often the TUI checks for a finished preview while no keys are pressed
+static constexpr int s_preview_poll_ms = 30;
+// How often the elapsed time of a running evaluation is redrawn, evaluations finishing sooner show none
+static constexpr int s_progress_interval_ms = 100;
+
+// Results of expression lines kept in batch mode, generated inputs often repeat lines
+static constexpr std::size_t s_default_cache_entries = 1 << 16;
+
+// Set by Ctrl-C, cancels the running evaluation or discards the line being typed
+static std::atomic<bool> s_interrupted = false;
+
+static void OnInterrupt(int)
+{
+	s_interrupted = true;
+}
+
+const char* ErrorMessage(const bcalc::CalcResult& result)
+{
+	switch (result.stop)
+	{
+		case bcalc::StopReason::Cancelled:	return "Cancelled";
+		case bcalc::StopReason::Timeout:	return "Timed out";
+		case bcalc::StopReason::NodeLimit:	return "Node limit reached";
+		default:							return "Invalid input";
+	}
+}
+
 int GetChar()
 {
 	int c = getch();
@@ -20,6 +54,9 @@ int GetChar()
 	if (c == 127)
 		return KEY_BACKSPACE;
 
+	if (c == s_key_search || c == s_key_cancel)
+		return c;
+
 	if (c != 27)
 		return ERR;
 
@@ -40,7 +77,61 @@ int GetChar()
 	return ERR;
 }
 
-int ProgramLoop()
+// Assignments and bindings are not echoed in CLI mode, '=' of comparison operators doesn't count
+bool IsAssignment(std::string_view expr)
+{
+	for (std::size_t i = 0; i < expr.size(); i++)
+	{
+		if (expr[i] != '=')
+			continue;
+		if (i > 0 && strchr("<>=!", expr[i - 1]))
+			continue;
+		if (i + 1 < expr.size() && expr[i + 1] == '=')
+		{
+			i++;
+			continue;
+		}
+		return true;
+	}
+	return false;
+}
+
+// Input line that repaints only the part that changed since it was last drawn
+class LineView
+{
+public:
+	void Reset(int y)
+	{
+		m_y = y;
+		m_drawn.clear();
+	}
+
+	int Line() const { return m_y; }
+
+	void Draw(std::string_view text, std::size_t cursor)
+	{
+		std::size_t common = 0;
+		while (common < text.size() && common < m_drawn.size() && text[common] == m_drawn[common])
+			common++;
+
+		if (common < text.size() || common < m_drawn.size())
+		{
+			move(m_y, common);
+			addnstr(text.data() + common, text.size() - common);
+			if (text.size() < m_drawn.size())
+				clrtoeol();
+			m_drawn.assign(text);
+		}
+
+		move(m_y, cursor);
+	}
+
+private:
+	int			m_y = 0;
+	std::string	m_drawn;
+};
+
+int ProgramLoop(bcalc::Program& program)
 {
 	WINDOW* window = initscr();
 	if (!window || noecho() == ERR)
@@ -48,63 +139,159 @@ int ProgramLoop()
 		fprintf(stderr, "Could not initialize ncurses.\n");
 		return 1;
 	}
+	timeout(s_preview_poll_ms);
 
-	std::vector<std::string> inputs;
-	
-	bcalc::Program program;
+	bcalc::History history;
+	if (const char* home = getenv("HOME"))
+		history.Open(std::string(home) + "/.bcalc_history");
+
+	program.SetCancelFlag(&s_interrupted);
+	std::signal(SIGINT, OnInterrupt);
+
+	bcalc::Preview preview(program);
+
+	LineView view;
+	LineView preview_view;
 
 	while (true)
 	{
-		std::vector<std::string> copy = inputs;
-		std::size_t index = copy.size();
+		std::size_t index = history.Size();
 		std::size_t pos = 0;
-		copy.push_back("");
+		view.Reset(getcury(window));
+		preview_view.Reset(getcury(window) + 1);
+
+		// Line the shown preview belongs to
+		std::string previewed;
+
+		// Reverse incremental search state
+		bool searching = false;
+		bool failed = false;
+		std::string query;
+		std::size_t match = history.Size();
+
+		auto find = [&](std::size_t before)
+		{
+			std::size_t found = history.Search(query, before);
+			failed = found == history.Size();
+			if (!failed)
+				match = found;
+		};
 
 		while (true)
 		{
 			int c = GetChar();
 
-			if (c == KEY_ENTER)
+			// Ctrl-C at the prompt leaves the search or discards the line instead of ending the session
+			if (s_interrupted.exchange(false))
+			{
+				if (!searching)
+				{
+					index = history.Size();
+					history.Edit(index).clear();
+					pos = 0;
+				}
+				searching = false;
+			}
+			else if (c == ERR)
+				;
+			else if (searching)
 			{
+				if (c == s_key_search)
+					find(match);
+				else if (isprint(c))
+				{
+					query.push_back(c);
+					find(std::min(match + 1, history.Size()));
+				}
+				else if (c == KEY_BACKSPACE)
+				{
+					if (!query.empty())
+						query.pop_back();
+					match = history.Size();
+					find(history.Size());
+				}
+				else
+				{
+					// Any other key leaves the search, cancel keeps the original line
+					searching = false;
+					if (c != s_key_cancel && match < history.Size())
+					{
+						index = match;
+						pos = history.Get(index).size();
+					}
+					if (c == KEY_ENTER)
+					{
+						preview_view.Draw("", 0);
+						view.Draw(history.Get(index), pos);
+						move(getcury(window) + 1, 0);
+						break;
+					}
+				}
+			}
+			else if (c == KEY_ENTER)
+			{
+				preview_view.Draw("", 0);
+				view.Draw(history.Get(index), pos);
 				move(getcury(window) + 1, 0);
 				break;
 			}
-
-			if (isprint(c))
+			else if (c == s_key_search)
 			{
-				copy[index].insert(pos++, 1, c);
+				searching = true;
+				failed = false;
+				query.clear();
+				match = history.Size();
+			}
+			else if (isprint(c))
+			{
+				history.Edit(index).insert(pos++, 1, c);
 			}
 			else if (c == KEY_BACKSPACE)
 			{
 				if (pos > 0)
-					copy[index].erase(--pos, 1);
+					history.Edit(index).erase(--pos, 1);
 			}
 			else if (c == KEY_UP || c == KEY_DOWN)
 			{
 				if (c == KEY_UP && index > 0)
 					index--;
-				else if (c == KEY_DOWN && index < copy.size() - 1)
+				else if (c == KEY_DOWN && index < history.Size())
 					index++;
 				else
 					continue;
-				pos = copy[index].size();
+				pos = history.Get(index).size();
 			}
 			else if (c == KEY_LEFT || c == KEY_RIGHT)
 			{
 				if (c == KEY_LEFT && pos > 0)
 					pos--;
-				else if (c == KEY_RIGHT && pos < copy[index].size())
+				else if (c == KEY_RIGHT && pos < history.Get(index).size())
 					pos++;
 			}
 
-			int y = getcury(window);
+			// Preview of the line Enter would submit, drawn first so the cursor ends up on the input line
+			std::string_view line = history.Get(searching && match < history.Size() ? match : index);
+			if (line != previewed)
+			{
+				previewed = line;
+				preview.Update(line);
+			}
+			if (std::string text; preview.Poll(text) && preview_view.Line() < LINES)
+				preview_view.Draw(text.empty() ? std::string() : " = " + text, 0);
 
-			deleteln();
-			mvaddstr(y, 0, copy[index].c_str());
-			move(y, pos);
+			if (searching)
+			{
+				std::string prompt = std::string(failed ? "(failed reverse-i-search)`" : "(reverse-i-search)`") + query;
+				std::string_view found = match < history.Size() ? history.Get(match) : std::string_view();
+				view.Draw(prompt + "': " + std::string(found), prompt.size());
+			}
+			else
+				view.Draw(history.Get(index), pos);
 		}
 
-		const std::string& input = copy[index];
+		// Copied, the overlay it may live in is discarded below
+		const std::string input(history.Get(index));
+		history.DiscardEdits();
 
 		if (input.empty())
 			continue;
@@ -119,14 +306,36 @@ int ProgramLoop()
 			continue;
 		}
 
-		auto result = program.Process(input);
+		// Evaluated on another thread so the elapsed time can be shown, keys typed meanwhile stay buffered
+		s_interrupted = false;
+		auto pending = std::async(std::launch::async, [&]()
+		{
+			auto lock = preview.LockProgram();
+			return program.Process(input);
+		});
+
+		LineView status;
+		status.Reset(getcury(window));
+		auto start = std::chrono::steady_clock::now();
+		while (pending.wait_for(std::chrono::milliseconds(s_progress_interval_ms)) != std::future_status::ready)
+		{
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "computing... %.1f s (Ctrl-C to cancel)", elapsed.count());
+			status.Draw(buffer, 0);
+			refresh();
+		}
+		status.Draw("", 0);
+
+		auto result = pending.get();
+		s_interrupted = false;
+
 		if (result.has_error)
-			printw("Invalid input\n");	
+			printw("%s\n", ErrorMessage(result));
 		else if (result.has_value)
-			printw(" = %s\n", bcalc::complex_to_string(result.value).c_str());
+			printw(" = %s\n", result.text.empty() ? bcalc::complex_to_string(result.value).c_str() : result.text.c_str());
 
-		index++;
-		inputs.push_back(input);
+		history.Add(input);
 	}
 
 	if (endwin() == ERR)
@@ -140,15 +349,73 @@ int ProgramLoop()
 
 int main(int argc, char** argv)
 {
-	if (argc == 1)
-		return ProgramLoop();
+	bcalc::Program program;
+
+	std::string output_path = "-";
+	auto output_format = bcalc::Table::Format::CSV;
+
+	// Applies to every expression separately, so one slow expression doesn't stall the rest
+	bcalc::Budget budget;
+
+	std::size_t cache_entries = s_default_cache_entries;
+	bool cache_stats = false;
 
 	std::string input_str;
 	for (int i = 1; i < argc; i++)
-		input_str += argv[i];
+	{
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output_path = argv[++i];
+		else if (strcmp(argv[i], "--binary") == 0)
+			output_format = bcalc::Table::Format::Binary;
+		else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc)
+		{
+			if (!program.SetPrecision(argv[++i]))
+			{
+				fprintf(stderr, "Invalid precision '%s'\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+			budget.timeout = std::chrono::milliseconds(strtoull(argv[++i], nullptr, 10));
+		else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc)
+			budget.max_nodes = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+			cache_entries = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--cache-stats") == 0)
+			cache_stats = true;
+		else if (strcmp(argv[i], "--fast-math") == 0)
+			program.SetFastMath(true);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			program.SetSeed(strtoull(argv[++i], nullptr, 10));
+		else if (strcmp(argv[i], "--workspace") == 0 && i + 1 < argc)
+		{
+			if (!program.LoadWorkspace(argv[++i]))
+			{
+				fprintf(stderr, "Could not load workspace '%s'\n", argv[i]);
+				return 1;
+			}
+		}
+		else
+			input_str += argv[i];
+	}
 	std::string_view input = input_str;
 
-	bcalc::Program program;
+	program.SetBudget(budget);
+
+	// Tables would corrupt the screen, in TUI mode they go nowhere unless redirected to a file
+	if (input.empty() && output_path == "-")
+		program.SetTableOutput(nullptr, output_format);
+	else if (!program.OpenTableOutput(output_path, output_format))
+	{
+		fprintf(stderr, "Could not open '%s'\n", output_path.c_str());
+		return 1;
+	}
+
+	// Without expressions the TUI is started
+	if (input.empty())
+		return ProgramLoop(program);
+
+	program.SetResultCacheCapacity(cache_entries);
 
 	std::size_t s = 0;
 	while (true)
@@ -158,14 +425,24 @@ int main(int argc, char** argv)
 		auto expr = input.substr(s, e - s);
 		auto result = program.Process(expr);
 		if (result.has_error)
-			printf("Invalid input\n");
-		else if (result.has_value && expr.find('=') == std::string_view::npos)
-			printf(" = %s\n", bcalc::complex_to_string(result.value).c_str());
+			printf("%s\n", ErrorMessage(result));
+		else if (result.has_value && !IsAssignment(expr))
+			printf(" = %s\n", result.text.empty() ? bcalc::complex_to_string(result.value).c_str() : result.text.c_str());
 
 		if (e == std::string_view::npos)
 			break;
 		s = e + 1;
 	}
 
+	if (cache_stats)
+	{
+		const auto& stats = program.ResultCacheStats();
+		const uint64_t lookups = stats.hits + stats.misses;
+		fprintf(stderr, "Result cache: %llu hits, %llu misses (%llu stale), %llu evictions, %.1f%% hit rate\n",
+			static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+			static_cast<unsigned long long>(stats.stale), static_cast<unsigned long long>(stats.evictions),
+			lookups ? 100.0 * stats.hits / lookups : 0.0);
+	}
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Measures the error of every FastMath kernel against the long double 'std' functions over the ranges listed
+// in FastMath.h, through the scalar, array and sine-cosine entry points. Exits with 1 if an error exceeds
+// the bound of the table there or a kernel gives NaN inside its range.
+
+#include "FastMath.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace bcalc;
+
+static constexpr std::size_t s_samples = 2'000'000;
+
+enum class Distribution
+{
+	Uniform,		// uniform in [low, high]
+	LogUniform,		// positive normal numbers with a uniform exponent
+	SignedLog,		// either sign, magnitude 2^e for e uniform in [low, high]
+};
+
+struct Range
+{
+	Distribution	distribution;
+	double			low;
+	double			high;
+	double			bound; // ulp
+};
+
+struct Kernel
+{
+	const char*		name;
+	FunctionType	function;
+	long double		(*reference)(long double);
+	Range			ranges[2]; // double, float
+};
+
+// The table of FastMath.h, a kernel change that needs a larger bound has to change both
+static const Kernel s_kernels[] {
+	{ "sin",  FunctionType::Sin,  [](long double x) { return std::sin(x); },  { { Distribution::Uniform, -1e5, 1e5, 2.5 },   { Distribution::Uniform, -8192, 8192, 1.6 } } },
+	{ "cos",  FunctionType::Cos,  [](long double x) { return std::cos(x); },  { { Distribution::Uniform, -1e5, 1e5, 2.5 },   { Distribution::Uniform, -8192, 8192, 1.6 } } },
+	{ "tan",  FunctionType::Tan,  [](long double x) { return std::tan(x); },  { { Distribution::Uniform, -1e5, 1e5, 3.8 },   { Distribution::Uniform, -8192, 8192, 3.2 } } },
+	{ "exp",  FunctionType::Exp,  [](long double x) { return std::exp(x); },  { { Distribution::Uniform, -707, 709, 1.0 },   { Distribution::Uniform, -86, 88, 1.0 } } },
+	{ "log",  FunctionType::Log,  [](long double x) { return std::log(x); },  { { Distribution::LogUniform, 0, 0, 0.9 },     { Distribution::LogUniform, 0, 0, 1.6 } } },
+	{ "sqrt", FunctionType::Sqrt, [](long double x) { return std::sqrt(x); }, { { Distribution::LogUniform, 0, 0, 0.5 },     { Distribution::LogUniform, 0, 0, 0.5 } } },
+	{ "sinh", FunctionType::Sinh, [](long double x) { return std::sinh(x); }, { { Distribution::Uniform, -707, 707, 1.7 },   { Distribution::Uniform, -86, 86, 1.6 } } },
+	{ "cosh", FunctionType::Cosh, [](long double x) { return std::cosh(x); }, { { Distribution::Uniform, -707, 707, 1.7 },   { Distribution::Uniform, -86, 86, 1.6 } } },
+	{ "tanh", FunctionType::Tanh, [](long double x) { return std::tanh(x); }, { { Distribution::SignedLog, -40, 10, 2.7 },   { Distribution::SignedLog, -40, 10, 2.7 } } },
+};
+
+template<typename T>
+static std::vector<T> Arguments(const Range& range, std::mt19937_64& engine)
+{
+	std::uniform_real_distribution<double> uniform(range.low, range.high);
+	std::uniform_real_distribution<double> fraction(1, 2);
+	std::uniform_int_distribution<int> exponent(std::numeric_limits<T>::min_exponent - 1, std::numeric_limits<T>::max_exponent - 2);
+	std::uniform_real_distribution<double> power(range.low, range.high);
+
+	std::vector<T> result(s_samples);
+	for (T& x : result)
+	{
+		switch (range.distribution)
+		{
+			case Distribution::Uniform:		x = static_cast<T>(uniform(engine)); break;
+			case Distribution::LogUniform:	x = static_cast<T>(std::ldexp(fraction(engine), exponent(engine))); break;
+			case Distribution::SignedLog:	x = static_cast<T>((engine() & 1 ? -1 : 1) * std::exp2(power(engine))); break;
+		}
+	}
+	return result;
+}
+
+// Error of 'value' in units in the last place of T at 'reference'
+template<typename T>
+static long double Ulp(T value, long double reference)
+{
+	if (std::isnan(value))
+		return std::numeric_limits<long double>::infinity();
+	if (reference == 0)
+		return value == 0 ? 0 : std::numeric_limits<long double>::infinity();
+	const int exponent = std::max(std::ilogb(reference), std::numeric_limits<T>::min_exponent - 1);
+	return std::abs(value - reference) / std::ldexp(1.0L, exponent - (std::numeric_limits<T>::digits - 1));
+}
+
+template<typename T>
+static bool Validate(const Kernel& kernel, const Range& range, std::mt19937_64& engine)
+{
+	const std::vector<T> in = Arguments<T>(range, engine);
+
+	std::vector<T> array(in.size());
+	FastMath::Apply(kernel.function, in.data(), array.data(), in.size());
+
+	// Sine and cosine are also computed together
+	std::vector<T> sin(in.size()), cos(in.size());
+	const bool sincos = kernel.function == FunctionType::Sin || kernel.function == FunctionType::Cos;
+	if (sincos)
+		FastMath::SinCos(in.data(), sin.data(), cos.data(), in.size());
+
+	long double worst = 0;
+	T worst_argument = 0;
+	for (std::size_t i = 0; i < in.size(); i++)
+	{
+		const long double reference = kernel.reference(in[i]);
+		long double error = std::max(Ulp(FastMath::Apply(kernel.function, in[i]), reference), Ulp(array[i], reference));
+		if (sincos)
+			error = std::max(error, Ulp(kernel.function == FunctionType::Sin ? sin[i] : cos[i], reference));
+		if (error > worst)
+		{
+			worst = error;
+			worst_argument = in[i];
+		}
+	}
+
+	const bool passed = worst <= range.bound;
+	std::printf("%-5s %-6s %6.3Lf ulp (bound %.1f) at %.17g%s\n", kernel.name, sizeof(T) == sizeof(double) ? "double" : "float",
+		worst, range.bound, static_cast<double>(worst_argument), passed ? "" : "  EXCEEDED");
+	return passed;
+}
+
+int main()
+{
+	std::mt19937_64 engine(1);
+
+	int failures = 0;
+	for (const Kernel& kernel : s_kernels)
+	{
+		failures += !Validate<double>(kernel, kernel.ranges[0], engine);
+		failures += !Validate<float>(kernel, kernel.ranges[1], engine);
+	}
+
+	std::printf("%d of %zu bounds exceeded\n", failures, 2 * std::size(s_kernels));
+	return failures > 0;
+}
@@ -0,0 +1,183 @@
+// Regression checks of Program::Process for inputs that used to crash or give wrong results.
+// Exits with 1 if any check fails.
+
+#include "History.h"
+#include "Program.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace bcalc;
+
+static int s_checks = 0;
+static int s_failures = 0;
+
+static void Check(bool passed, const char* what)
+{
+	s_checks++;
+	if (!passed)
+	{
+		std::printf("failed: %s\n", what);
+		s_failures++;
+	}
+}
+
+// Ranges far too long to finish stop at the budget instead of allocating per block up front
+static void LongSums()
+{
+	Program program;
+	program.Process("f(x) = x^2 - 2");
+
+	program.SetBudget({ .max_nodes = 1'000'000 });
+	CalcResult result = program.Process("sum(f, 1, 1e15)");
+	Check(result.has_error && result.stop == StopReason::NodeLimit, "sum(f, 1, 1e15) stops at the node limit");
+
+	program.SetBudget({ .timeout = std::chrono::milliseconds(200) });
+	program.SetFastMath(true);
+	result = program.Process("sum(f, 1, 1e17)");
+	Check(result.has_error && result.stop == StopReason::Timeout, "fast math sum(f, 1, 1e17) stops at the timeout");
+	program.SetFastMath(false);
+
+	program.SetBudget({});
+	program.Process("g(x) = x - 2");
+	result = program.Process("sum(g, 1, 5e6)");
+	Check(!result.has_error && result.value == std::complex<value_type>(12500002500000.0L - 1e7L), "sum(g, 1, 5e6) over several rounds");
+}
+
+static std::string ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+// Saving the same definitions gives the same file, whatever was evaluated before
+static void WorkspaceBytes()
+{
+	const char* definitions[] = { "x = 1.5 + 2i", "m = [[1, 2], [3, 4]]", "f(t) = t^2 + 0.1", "y := x * 2", "2 + 2" };
+	const std::string directory = std::filesystem::temp_directory_path().string();
+	const std::string paths[] = { directory + "/bcalc_test_1.ws", directory + "/bcalc_test_2.ws" };
+
+	for (const std::string& path : paths)
+	{
+		Program program;
+		if (&path == &paths[1])
+			program.Process("sin(1) * 2 + sqrt(-3) / log(7, 2)");
+		for (const char* definition : definitions)
+			program.Process(definition);
+		Check(program.SaveWorkspace(path), "workspace is saved");
+	}
+
+	const std::string first = ReadFile(paths[0]);
+	Check(!first.empty() && first == ReadFile(paths[1]), "workspaces of the same definitions are identical");
+
+	Program program;
+	Check(program.LoadWorkspace(paths[0]), "workspace is loaded");
+	Check(program.Process("y").value == std::complex<value_type>(3, 4), "loaded binding keeps its value");
+
+	for (const std::string& path : paths)
+		std::filesystem::remove(path);
+}
+
+// Counts that are too large or not finite are rejected before any row is written
+static void TableCounts()
+{
+	Program program;
+	FILE* output = std::tmpfile();
+	program.SetTableOutput(output, Table::Format::CSV);
+	program.Process("f(x) = x^2");
+	program.Process("g(x, y) = x * y");
+
+	Check(!program.Process("table(f, 0, 1, 3)").has_error, "table of 3 rows");
+	Check(program.Process("table(f, 0, 1, 1e300)").has_error, "table of 1e300 rows is rejected");
+	Check(program.Process("table(f, 0, 1, 0/0)").has_error, "table of NaN rows is rejected");
+	Check(program.Process("grid(g, 0, 1, 1e7, 0, 1, 1e7)").has_error, "grid of 1e14 rows is rejected");
+	Check(program.Process("grid(g, 0, 1, 2^40, 0, 1, 2^40)").has_error, "grid whose row count overflows is rejected");
+
+	// Only whole chunks of 2^16 rows of 3 doubles are written before the timeout
+	FILE* binary = std::tmpfile();
+	program.SetTableOutput(binary, Table::Format::Binary);
+	program.SetBudget({ .timeout = std::chrono::milliseconds(100) });
+	program.SetFastMath(true);
+	CalcResult result = program.Process("table(f, 0, 1, 1e11)");
+	Check(result.has_error && result.stop == StopReason::Timeout, "table of 1e11 rows stops at the timeout");
+	Check(std::ftell(binary) % ((1 << 16) * 3 * sizeof(double)) == 0, "only whole chunks are written");
+	std::fclose(binary);
+
+	std::fclose(output);
+}
+
+// ':precision' and '--precision' share one validation, exact quotients stay exact
+static void Precision()
+{
+	Program program;
+	Check(!program.SetPrecision("1000000000"), "precision of a billion digits is rejected");
+	Check(program.Process(":precision 1000000000").has_error, ":precision of a billion digits is rejected");
+	Check(!program.SetPrecision("30x") && program.Digits() == 0, "malformed precision changes nothing");
+
+	Check(program.SetPrecision("30"), "precision of 30 digits");
+	Check(program.Process("10/5 == 2").value == std::complex<value_type>(1), "10/5 == 2 at 30 digits");
+	Check(program.Process("0.25*4 == 1").value == std::complex<value_type>(1), "0.25*4 == 1 at 30 digits");
+	Check(program.Process("round(2.5)").value == std::complex<value_type>(3), "round(2.5) at 30 digits");
+	Check(program.SetPrecision("off") && program.Digits() == 0, "precision off");
+}
+
+// Only a first line without numbers is a header, a partly numeric one is a skipped row
+static void StatisticsHeader()
+{
+	const std::string path = std::filesystem::temp_directory_path().string() + "/bcalc_test.csv";
+	auto stats = [&](const char* contents)
+	{
+		std::ofstream(path, std::ios::binary) << contents;
+		Program program;
+		return program.Process(":stats " + path + " csv x,y x + y").text;
+	};
+
+	Check(stats("x, y\n1, 2\n3, 4\n").starts_with("2 rows, 0 skipped"), "header of names is not a row");
+	Check(stats("x, 2\n1, 2\n3, 4\n").starts_with("2 rows, 1 skipped"), "first line with a number is a skipped row");
+	Check(stats("1e, y\n1, 2\n3, 4\n").starts_with("2 rows, 0 skipped"), "partly numeric names are a header");
+	Check(stats("5, 6\n1, 2\n3, 4\n").starts_with("3 rows, 0 skipped"), "first line of numbers is a row");
+
+	std::filesystem::remove(path);
+}
+
+// The history file keeps only the newest entries once it has too many
+static void HistoryLimit()
+{
+	const std::string path = std::filesystem::temp_directory_path().string() + "/bcalc_test_history";
+	{
+		std::ofstream file(path, std::ios::binary);
+		for (int i = 0; i < 10005; i++)
+			file << i << " + 1\n";
+	}
+
+	{
+		History history;
+		Check(history.Open(path) && history.Size() == 10000 && history.Get(0) == "5 + 1", "history is cut to the newest 10000 entries");
+		Check(history.Search("10004 +", history.Size()) == 9999, "cut history is searchable");
+		history.Add("2 + 2");
+	}
+
+	History history;
+	Check(history.Open(path) && history.Size() == 10000 && history.Get(9999) == "2 + 2" && history.Get(0) == "6 + 1", "rewritten history is appended to");
+	const std::string contents = ReadFile(path);
+	Check(std::count(contents.begin(), contents.end(), '\n') == 10000, "history file is rewritten");
+
+	std::filesystem::remove(path);
+}
+
+int main()
+{
+	LongSums();
+	WorkspaceBytes();
+	TableCounts();
+	Precision();
+	StatisticsHeader();
+	HistoryLimit();
+
+	std::printf("%d of %d checks failed\n", s_failures, s_checks);
+	return s_failures > 0;
+}
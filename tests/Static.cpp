@@ -0,0 +1,148 @@
+// Checks that the compile time front end of Static.h agrees with Program::Process.
+// Builds only if the constexpr checks hold, exits with 1 if any runtime comparison differs.
+
+#include "Program.h"
+#include "Static.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+using bcalc::value_type;
+using namespace bcalc::Static;
+
+// Literals must round like std::from_chars, which the compiler's own literals also do
+static_assert(Expression<"0.1">{}.Evaluate<value_type>() == 0.1L);
+static_assert(Expression<"2.5e-3">{}.Evaluate<value_type>() == 2.5e-3L);
+static_assert(Expression<"123456789012345678901234567890">{}.Evaluate<value_type>() == 123456789012345678901234567890.0L);
+static_assert(Expression<"0.12345678901234567890123456789">{}.Evaluate<value_type>() == 0.12345678901234567890123456789L);
+static_assert(Expression<"18446744073709551615">{}.Evaluate<value_type>() == 18446744073709551615.0L);
+static_assert(Expression<"9007199254740993">{}.Evaluate<value_type>() == 9007199254740993.0L);
+static_assert(Expression<"1e300">{}.Evaluate<value_type>() == 1e300L);
+static_assert(Expression<"1e-300">{}.Evaluate<value_type>() == 1e-300L);
+static_assert(Expression<"4.9406564584124654e-324">{}.Evaluate<value_type>() == 4.9406564584124654e-324L);
+
+// Precedence and arithmetic
+static_assert(Expression<"1 + 2 * 3">{}.Evaluate<value_type>() == 7);
+static_assert(Expression<"(1 + 2) * 3">{}.Evaluate<value_type>() == 9);
+static_assert(Expression<"-2 * 3 - 4 / 8">{}.Evaluate<value_type>() == -6.5L);
+static_assert(Expression<"1 < 2">{}.Evaluate<value_type>() == 1);
+static_assert(Expression<"3 == 3.0">{}.Evaluate<value_type>() == 1);
+static_assert(Function<"f(x, y) = x * y - y / x">{}(2.0L, 3.0L) == 4.5L);
+static_assert(Expression<"-2^2 - (-2)^2">{}.Evaluate<value_type>() == -8);
+static_assert(Expression<"2^3^2">{}.Evaluate<value_type>() == 64); // left associative like Parser
+static_assert(Function<"g(x_1, rate2, z_) = x_1 rate2 - 2z_">{}(2.0L, 3.0L, 0.5L) == 5);
+static_assert(Function<"h(t) = if(t >= 0, t, -t) + (t != 0)">{}(-2.0L) == 3);
+
+struct Entry
+{
+	const char*						input;
+	std::complex<value_type>		value;
+	bool							exact;
+};
+
+// The compiler may evaluate builtins of constant arguments itself, their last bits can differ from the library
+#define EXACT(input) Entry { input, Expression<input>{}.Evaluate<std::complex<value_type>>(), true }
+#define BUILTIN(input) Entry { input, Expression<input>{}.Evaluate<std::complex<value_type>>(), false }
+
+// Every operator, every builtin available at compile time under each of its names, constants, implicit
+// multiplication and the literal forms of the lexer
+static const Entry s_expressions[] {
+	// Literals and implicit multiplication
+	EXACT("0.1 + 0.2"),
+	EXACT("123456789012345678901234567890 / 7"),
+	EXACT("3.14159265358979323846264338327950288e-5"),
+	EXACT("1.5E+3 - 2e-2 + 0.000125"),
+	EXACT("3i + 2.5i * 2 - 1e3i"),
+	EXACT("2pi - 3e + 4i"),
+	EXACT("2 sqrt(2) + 3 pi i"),
+
+	// Operators, precedence and unary minus
+	EXACT("1 + 2 * 3 - 4 / 5"),
+	EXACT("(1 + 2) * (3 - 4) / 5"),
+	EXACT("-2^2 - (3)^2 + (-3)"),
+	EXACT("(-2)^2 - (-2)^3"),
+	EXACT("-(1 - 3) * (-sqrt(4)) - sqrt(9)"),
+	EXACT("2^3^2"),
+	EXACT("i * i + 2 * i / (1 - i)"),
+	EXACT("(1 < 2) + (2 < 1) + (1 > 2) + (2 > 1)"),
+	EXACT("(1 <= 1) + (2 <= 1) + (1 >= 2) + (2 >= 2)"),
+	EXACT("(2 == 2) + (2 == 3) + (1 != 2) + (i != i)"),
+	EXACT("(1 + i < 2) + (3 > 2 - i)"),
+	EXACT("if(2 > 1, 10, 20) + if(1 >= 2, 1, 2)"),
+	EXACT("if(0, 1, if(1, 2, 3))"),
+
+	// Builtins
+	EXACT("sqrt(2) + sqrt(-4) + sqrt(i)"),
+	EXACT("round(2.5) + floor(-1.5) + ceil(1.2)"),
+	EXACT("round(-2.5 + 1.5i) + floor(1.5 - 0.5i) + ceil(-0.5 + 2.1i)"),
+	BUILTIN("2^10 - 3^0.5 + 2^(-0.5i)"),
+	BUILTIN("(-8)^(1/3)"),
+	BUILTIN("i^i"),
+	BUILTIN("log(8, 2) + log(100, 10) + log(-1, 2)"),
+	BUILTIN("log(2) + log(-2) + exp(1 + i)"),
+	BUILTIN("e^(i * pi)"),
+	BUILTIN("sin(1) + cos(2) * tan(0.5)"),
+	BUILTIN("sin(1 + i) - cos(2 - i) / tan(i)"),
+	BUILTIN("asin(0.3) + acos(0.3) + atan(3)"),
+	BUILTIN("arcsin(0.3) + arccos(0.3) + arctan(3)"),
+	BUILTIN("asin(2) + acos(-2) + atan(2i)"),
+	BUILTIN("sinh(1) - cosh(1) + tanh(0.25)"),
+	BUILTIN("sinh(i) + cosh(1 - i) + tanh(2i)"),
+	BUILTIN("asinh(2) + acosh(2) + atanh(0.5)"),
+	BUILTIN("arcsinh(2) + arccosh(2) + arctanh(0.5)"),
+	BUILTIN("acosh(0.5) + atanh(2)"),
+	BUILTIN("exp(2) * log(10)"),
+};
+
+#undef EXACT
+#undef BUILTIN
+
+static bool Same(value_type a, value_type b, bool exact)
+{
+	if (std::isnan(a) || std::isnan(b))
+		return std::isnan(a) && std::isnan(b);
+	if (exact)
+		return a == b;
+	return std::abs(a - b) <= 8 * std::numeric_limits<value_type>::epsilon() * std::max<value_type>(std::abs(a), 1);
+}
+
+int main()
+{
+	bcalc::Program program;
+	int failures = 0;
+
+	auto check = [&](const char* input, std::complex<value_type> expected, bool exact)
+	{
+		bcalc::CalcResult result = program.Process(input);
+		if (result.has_error || !Same(result.value.real(), expected.real(), exact) || !Same(result.value.imag(), expected.imag(), exact))
+		{
+			std::printf("%s: static %.21Lg%+.21Lgi, runtime %.21Lg%+.21Lgi\n", input,
+				expected.real(), expected.imag(), result.value.real(), result.value.imag());
+			failures++;
+		}
+	};
+
+	for (const Entry& entry : s_expressions)
+		check(entry.input, entry.value, entry.exact);
+
+	// User functions, nested calls and identifier forms
+	constexpr Function<"f(x, y) = x * y + sin(x) / y"> f;
+	program.Process("f(x, y) = x * y + sin(x) / y");
+	check("f(1.5, 2)", f.Evaluate<std::complex<value_type>>(1.5L, 2.0L), false);
+	check("f(-3, 0.25)", f.Evaluate<std::complex<value_type>>(-3.0L, 0.25L), false);
+	check("f(f(1, 2), f(2i, 3))", f(f(std::complex<value_type>(1), std::complex<value_type>(2)), f(std::complex<value_type>(0, 2), std::complex<value_type>(3))), false);
+
+	constexpr Function<"g(x_1, rate2, z_) = -x_1^2 + rate2 z_ - (-rate2)^3 / 2x_1"> g;
+	program.Process("g(x_1, rate2, z_) = -x_1^2 + rate2 z_ - (-rate2)^3 / 2x_1");
+	check("g(1.5, -2, 3)", g.Evaluate<std::complex<value_type>>(1.5L, -2.0L, 3.0L), true);
+	check("g(i, 2, 1 - i)", g(std::complex<value_type>(0, 1), std::complex<value_type>(2), std::complex<value_type>(1, -1)), true);
+
+	constexpr Function<"h(t) = if(t < 0, -t, t^2) + if(t == 1, 1, 0)"> h;
+	program.Process("h(t) = if(t < 0, -t, t^2) + if(t == 1, 1, 0)");
+	check("h(-3) + h(1) + h(2)", h.Evaluate<std::complex<value_type>>(-3.0L) + h.Evaluate<std::complex<value_type>>(1.0L) + h.Evaluate<std::complex<value_type>>(2.0L), false);
+
+	std::printf("%d of %zu comparisons differ\n", failures, std::size(s_expressions) + 6);
+	return failures > 0;
+}